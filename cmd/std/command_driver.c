@@ -13,12 +13,14 @@ inherit "/lib/commands";
 inherit "/std/callout";
 
 #include <files.h>
+#include <macros.h>
 #include <std.h>
 
 /*
  * Prototype.
  */
 public mapping query_cmdlist();
+static int notify_soul_index();
 
 /*
  * Global variable.
@@ -26,6 +28,7 @@ public mapping query_cmdlist();
  * cmdlist   - the list of verbs and functions.
  */
 static mapping cmdlist = query_cmdlist();
+static int index_notified = notify_soul_index();
 
 /*
  * Function name: query_cmdlist
@@ -41,6 +44,25 @@ query_cmdlist()
     return ([ ]);
 }
 
+/*
+ * Function name: notify_soul_index
+ * Description  : Tell the verb index that the verbs of this soul may have
+ *                changed. Clones are never used as souls, so they need not
+ *                bother.
+ * Returns      : int 1/0 - notified or not.
+ */
+static int
+notify_soul_index()
+{
+    if (IS_CLONE)
+    {
+        return 0;
+    }
+
+    SOUL_INDEX->invalidate_soul(file_name(this_object()));
+    return 1;
+}
+
 /*
  * Function name: update_commands
  * Description  : This function is called from the spell object when a
@@ -50,6 +72,7 @@ public void
 update_commands()
 {
     cmdlist = query_cmdlist();
+    notify_soul_index();
 }
 
 /* 
@@ -17,6 +17,7 @@
  * - Goto
  * - More
  * - Move
+ * - Profile
  * - Reload
  * - Set
  * - Tail
@@ -34,6 +35,7 @@ inherit "/cmd/std/tracer_tool_base";
 #include <files.h>
 #include <language.h>
 #include <macros.h>
+#include <profile.h>
 #include <std.h>
 #include <stdproperties.h>
 
@@ -110,6 +112,8 @@ query_cmdlist()
              "More"     : "More",
              "Move"     : "Move",
 
+             "Profile"  : "Profile",
+
 	     "Reload"	: "Reload",
 
              "Set"      : "Set",
@@ -1155,6 +1159,132 @@ Move(string str)
     return 1;
 }
 
+/*
+ * Profile - profile programs with the profiler of the mudlib.
+ *
+ * Syntax   : Profile start <program/directory> [...] [<seconds>]
+ *            Profile stop
+ *            Profile status
+ *            Profile [report] [cost/calls/average] [<num>]
+ *            Profile csv <file>
+ *            Profile folded <file>
+ * Arguments: <program/directory> - the programs to profile.
+ *            <seconds> - the duration of the profile, default 60.
+ *            <num>     - the number of lines of the report, default 20.
+ *            <file>    - the file to export the results to.
+ * Default  : 'report cost 20'
+ */
+int
+Profile(string str)
+{
+    string *args;
+    string order = PROFILE_SORT_COST;
+    string error, text, file;
+    int    num = 20;
+    int    seconds, index;
+
+    CHECK_SO_WIZ;
+
+    args = (strlen(str) ? explode(str, " ") - ({ "" }) : ({ "report" }));
+    switch(args[0])
+    {
+    case "start":
+        if (sizeof(args) < 2)
+        {
+            notify_fail("Syntax: Profile start <program/directory> [...] " +
+                "[<seconds>]\n");
+            return 0;
+        }
+        args = args[1..];
+        if (sscanf(args[-1], "%d", seconds) && (sizeof(args) > 1))
+        {
+            args = args[..-2];
+        }
+        else
+        {
+            seconds = 0;
+        }
+        for (index = 0; index < sizeof(args); index++)
+        {
+            args[index] = FTPATH(this_interactive()->query_path() + "/",
+                args[index]);
+        }
+        if (strlen(error = PROFILER->start_profile(args, seconds)))
+        {
+            notify_fail(error);
+            return 0;
+        }
+        write(PROFILER->query_status());
+        return 1;
+
+    case "stop":
+        if (!PROFILER->stop_profile())
+        {
+            notify_fail("No profile is running.\n");
+            return 0;
+        }
+        write(PROFILER->query_status());
+        return 1;
+
+    case "status":
+        write(PROFILER->query_status());
+        return 1;
+
+    case "csv":
+    case "folded":
+        if (sizeof(args) != 2)
+        {
+            notify_fail("Syntax: Profile " + args[0] + " <file>\n");
+            return 0;
+        }
+        file = FTPATH(this_interactive()->query_path() + "/", args[1]);
+        text = ((args[0] == "csv") ? PROFILER->report_csv() :
+            PROFILER->report_folded());
+        rm(file);
+        if (!write_file(file, text))
+        {
+            notify_fail("Cannot write to " + file + ".\n");
+            return 0;
+        }
+        write("Wrote " + sizeof(explode(text, "\n")) + " lines to " + file +
+            ".\n");
+        return 1;
+
+    case "report":
+        args = args[1..];
+        break;
+    }
+
+    foreach(string arg: args)
+    {
+        if (sscanf(arg, "%d", num))
+        {
+            continue;
+        }
+        if (!IN_ARRAY(arg, ({ PROFILE_SORT_COST, PROFILE_SORT_CALLS,
+            PROFILE_SORT_AVERAGE })))
+        {
+            notify_fail("Syntax: Profile [report] [cost/calls/average] " +
+                "[<num>]\n");
+            return 0;
+        }
+        order = arg;
+    }
+
+    write(PROFILER->query_status() + "\n");
+    write(sprintf("%10s %10s %10s  %-8s %s\n", "Calls", "Cost",
+        "Average", "Type", "Function"));
+    foreach(mixed row: PROFILER->query_report(order, num))
+    {
+        write(sprintf("%10d %10d %10.1f  %-8s %s->%s\n",
+            row[PROFILE_CALLS], row[PROFILE_COST],
+            (itof(row[PROFILE_COST]) / itof(max(1, row[PROFILE_CALLS]))),
+            row[PROFILE_SOURCE], row[PROFILE_PROGRAM],
+            row[PROFILE_FUNCTION]));
+    }
+    return 1;
+}
+
 /*
  * Reload - Reload an object
  *
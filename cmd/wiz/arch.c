@@ -4,6 +4,7 @@
  * This object holds the commands reserved for archwizards.
  * The following commands are supported:
  *
+ * - accesscache
  * - account
  * - all_spells
  * - arch
@@ -83,6 +84,7 @@ nomask mapping
 query_cmdlist()
 {
     return ([
+             "accesscache":"accesscache",
              "account":"account",
              "all_spells":"all_spells",
              "arch":"arch",
@@ -127,6 +129,40 @@ query_cmdlist()
  * same order as in the function name list.
  * **************************************************************************/
 
+/* **************************************************************************
+ * accesscache - show the use of the file access cache of the master.
+ */
+nomask int
+accesscache(string str)
+{
+    mapping stats;
+    int total;
+
+    CHECK_SO_ARCH;
+
+    if (strlen(str) && (str != "clear"))
+    {
+        notify_fail("Syntax: accesscache [clear]\n");
+        return 0;
+    }
+
+    stats = SECURITY->query_access_stats(str == "clear");
+    total = stats["hits"] + stats["misses"];
+
+    write(sprintf("Decisions cached : %6d for %d euids\n", stats["entries"],
+        stats["euids"]));
+    write(sprintf("Hits             : %6d (%d%%)\n", stats["hits"],
+        (total ? ((stats["hits"] * 100) / total) : 0)));
+    write(sprintf("Misses           : %6d\n", stats["misses"]));
+    write(sprintf("Invalidations    : %6d\n", stats["forgets"]));
+    write(sprintf("Flushed when full: %6d\n", stats["flushes"]));
+    if (str == "clear")
+    {
+        write("The cache has been emptied.\n");
+    }
+    return 1;
+}
+
 /* **************************************************************************
  * account - list the GoG account of a player.
  */
@@ -3,19 +3,27 @@
  *
  * This module functions as a cache on disk reads. If you need to re-read
  * some information each time a player uses a particular tool or feature,
- * a read cache may be very handy. What it does is store the last <size>
- * different read files in memory and if you query information that already
- * is in the cache, a cpu-intensive disk read will be avoided! Note that
- * this has its best results if the individual data files are relatively
- * small.
+ * a read cache may be very handy. What it does is store the recently read
+ * files in memory and if you query information that already is in the
+ * cache, a cpu-intensive disk read will be avoided! Note that this has its
+ * best results if the individual data files are relatively small.
  *
- * The default size of the cache is 10 data files. If you think more
- * different files need to be accessible at the same time, you may extend
- * the cache size to a maximum of 25. To do this, call the following
- * function from your create_whatever() function.
+ * The files are kept by the central cache, CACHE_CENTRAL, which is shared
+ * by all objects using this module. It is limited by the number of bytes
+ * of all files rather than by the number of files per object. The old way
+ * of setting the number of files is still accepted, but has no effect.
  *
  *     void set_cache_size(int size)
  *
+ * Saving can be delayed. With write-behind, save_cache() only keeps the data
+ * in this object and the file is written after <delay> seconds, so a file
+ * that is saved often is written only once in a while. The shared cache is
+ * only updated once the file is written. If you use this, make sure
+ * you call flush_cache() from your remove_object() so nothing is lost.
+ *
+ *     void set_cache_write_behind(float delay)
+ *     void flush_cache()
+ *
  * Read caching is only possible when replacing the efuns save_map() and
  * restore_map(). It is not possible to cache on objects that are restored
  * via the efun restore_object(). However, all objects that function on
@@ -37,7 +45,8 @@
  * returns the filenames of all data files currently in the cache, the second
  * will return whether or not a particular data file is in the cache and the
  * third can be used to remove a certain data file from the cache. Finally,
- * you may want to flush the cache and remove all files from it.
+ * you may want to flush the cache and remove all files from it. The cache
+ * is shared, so these only concern the files this object may read.
  *
  *     string *query_cache()
  *     int in_cache(string filename)
@@ -54,6 +63,8 @@
 #pragma save_binary
 #pragma strict_types
 
+#include <files.h>
+
 #define DEFAULT_CACHE 10
 #define MINIMUM_CACHE 10
 #define MAXIMUM_CACHE 25
@@ -61,18 +72,19 @@
 /*
  * These global variables are private and static. They will not be saved
  * and are invisible to inheriting objects.
+ *
+ * cache_pending - ([ filename : data ]) the saves that were delayed.
  */
-static private mapping  cache_map   = ([ ]);
-static private string  *cache_order = ({ });
-static private int      cache_size  = DEFAULT_CACHE;
-static private int      cache_tries = 0;
-static private int      cache_hits  = 0;
+static private int      cache_size    = DEFAULT_CACHE;
+static private mapping  cache_pending = ([ ]);
+static private float    cache_delay   = 0.0;
+static private int      cache_alarm   = 0;
 
 /*
  * Function name: set_cache_size
- * Description  : With this function you can set the cache size. It is
- *                defaulted to 10 and values ranging from 10 to 25 will
- *                be accepted.
+ * Description  : This used to set the number of files in the cache of this
+ *                object. The cache is shared and limited in bytes now, so
+ *                the value is only remembered.
  * Arguments    : int size - the size of the cache.
  */
 nomask static void
@@ -96,6 +108,63 @@ query_cache_size()
     return cache_size;
 }
 
+/*
+ * Function name: set_cache_write_behind
+ * Description  : With this function you can delay the saving of files with
+ *                save_cache(). When the delay is 0.0, files are written at
+ *                once, which is the default.
+ * Arguments    : float delay - the delay in seconds.
+ */
+nomask static void
+set_cache_write_behind(float delay)
+{
+    cache_delay = ((delay > 0.0) ? delay : 0.0);
+}
+
+/*
+ * Function name: write_cache
+ * Description  : Writes a file to disk and, if that succeeded, puts the
+ *                data in the shared cache.
+ * Arguments    : mapping data     - the data to save.
+ *                string  filename - the filename to save to, without ".o".
+ */
+nomask static void
+write_cache(mapping data, string filename)
+{
+    if (catch(save_map(data, filename)) ||
+	(file_size(filename + ".o") < 0))
+    {
+	/* The file on disk is not what we meant it to be anymore. */
+	CACHE_CENTRAL->invalidate(filename);
+	return;
+    }
+
+    CACHE_CENTRAL->store_data(filename, secure_var(data),
+	file_size(filename + ".o"), file_time(filename + ".o"), 1);
+}
+
+/*
+ * Function name: flush_cache
+ * Description  : Writes all files of which the saving was delayed.
+ */
+nomask static void
+flush_cache()
+{
+    mapping pending = cache_pending;
+
+    cache_pending = ([ ]);
+    if (cache_alarm)
+    {
+	remove_alarm(cache_alarm);
+	cache_alarm = 0;
+    }
+
+    foreach(string filename, mapping data: pending)
+    {
+	write_cache(data, filename);
+    }
+}
+
 /*
  * Function name: in_cache
  * Description  : Call this function to find out whether the contents of a
@@ -106,7 +175,10 @@ query_cache_size()
 nomask static int
 in_cache(string filename)
 {
-    return (member_array(filename, cache_order) > -1);
+    sscanf(filename, "%s.o", filename);
+
+    return (mappingp(cache_pending[filename]) ||
+	CACHE_CENTRAL->query_cached(filename));
 }
 
 /*
@@ -125,52 +197,31 @@ nomask static mapping
 read_cache(string filename)
 {
     mapping data;
-    int     pos;
-
-    /* Count the number of tries to the cache. */
-    cache_tries++;
 
     /* Remove the trailing ".o" if it is added to the path. */
     sscanf(filename, "%s.o", filename);
 
+    /* A save that is still pending is the most recent information. */
+    if (mappingp(data = cache_pending[filename]))
+	return secure_var(data);
+
     /* See whether the information with that name is already in the
      * cache. Yes, HIT, no load == cpu saved!
      */
-    if ((pos = member_array(filename, cache_order)) > -1)
-    {
-	/* Count the number of hits in the cache. */
-	cache_hits++;
-
-	/* If the requested information is not on the top of the cache,
-	 * put it on top.
-	 */
-	if (pos > 0)
-	    cache_order = ({ filename }) + cache_order[..(pos - 1)] +
-		cache_order[(pos + 1)..];
-
-	/* Return the cached information, that is... a copy of it. */
-	return secure_var(cache_map[filename]);
-    }
+    if (mappingp(data = CACHE_CENTRAL->query_data(filename)))
+	return secure_var(data);
 
     /* The information is apparently not in the cache. Read the file from
-     * disk. In case of an error, return the empty mapping. This will
-     * probably not happen because even if you try to restore a non-existant
-     * mapping, the efun restore_map will return an empty mapping. *duh*
+     * disk. In case of an error, return the empty mapping, but don't cache
+     * it, as we may not have been allowed to read the file.
      */
     if (catch(data = restore_map(filename)) ||
 	!mappingp(data))
-	data = ([ ]);
-
-    /* If the cache is too large, reduce its size. */
-    while((pos = sizeof(cache_order)) >= cache_size)
-    {
-	m_delkey(cache_map, cache_order[pos - 1]);
-	cache_order = cache_order[..(pos - 2)];
-    }
+	return ([ ]);
 
     /* Add the read information to the cache. */
-    cache_order = ({ filename }) + cache_order;
-    cache_map[filename] = data;
+    CACHE_CENTRAL->store_data(filename, data, file_size(filename + ".o"),
+	file_time(filename + ".o"), 0);
 
     /* Return the read information, that is... a copy of it. */
     return secure_var(data);
@@ -182,11 +233,8 @@ read_cache(string filename)
  *                only the information on disk should be changed, but the
  *                information in the cache should be altered too. The
  *                arguments to this function are exactly the same as to
- *                the efun save_map(). This function does NOT cache on the
- *                save, i.e. when the data is not in the cache when it is
- *                saved, it will not be added to the cache. However, in
- *                practice I don't think a file will ever be saved without
- *                being in the cache.
+ *                the efun save_map(). With write-behind, the information
+ *                is only written after the delay.
  * Arguments    : mapping data     - the data to save.
  *                string  filename - the filename to save to.
  */
@@ -196,12 +244,19 @@ save_cache(mapping data, string filename)
     /* Remove the trailing ".o" if there is one. */
     sscanf(filename, "%s.o", filename);
 
-    /* If the entry is in the cache, update it. */
-    if (in_cache(filename))
-    	cache_map[filename] = secure_var(data);
+    if (cache_delay > 0.0)
+    {
+	/* Only we see the data until it is written. The shared cache holds
+	 * what is on disk, which is about to change. */
+	cache_pending[filename] = secure_var(data);
+	CACHE_CENTRAL->invalidate(filename);
+	if (!cache_alarm)
+	    cache_alarm = set_alarm(cache_delay, 0.0, flush_cache);
+	return;
+    }
 
     /* Save the information as usual. */
-    save_map(data, filename);
+    write_cache(data, filename);
 }
 
 /*
@@ -222,12 +277,9 @@ rm_cache(string filename)
     /* Remove the trailing ".o" if there is one. */
     sscanf(filename, "%s.o", filename);
 
-    /* If the information is in the cache, remove it from the cache. */
-    if (member_array(filename, cache_order) > -1)
-    {
-    	cache_order -= ({ filename });
-    	m_delkey(cache_map, filename);
-    }
+    /* A delayed save would bring the file back. */
+    m_delkey(cache_pending, filename);
+    CACHE_CENTRAL->invalidate(filename);
 
     /* Remove the file as usual. */
     return rm(filename + ".o");
@@ -240,8 +292,8 @@ rm_cache(string filename)
  *                in which this is necessary is if you want to rename a
  *                data file that is in the cache, for there is no cache
  *                version of the efun rename() because of implementational
- *                difficulties. There is no return function because it will
- *                always succeed.
+ *                difficulties. A delayed save of the file is written first.
+ *                There is no return function because it will always succeed.
  * Arguments    : string filename - the filename to remove.
  */
 nomask static int
@@ -250,25 +302,26 @@ remove_from_cache(string filename)
     /* Remove the trailing ".o" if there is one. */
     sscanf(filename, "%s.o", filename);
 
-    /* If the information is in the cache, remove it from the cache. */
-    if (member_array(filename, cache_order) > -1)
+    if (mappingp(cache_pending[filename]))
     {
-    	cache_order -= ({ filename });
-    	m_delkey(cache_map, filename);
+	catch(save_map(cache_pending[filename], filename));
+	m_delkey(cache_pending, filename);
     }
+
+    CACHE_CENTRAL->invalidate(filename);
 }
 
 /*
  * Function name: reset_cache
- * Description  : This function will flush the cache and remove all data
- *                files from it. This will save memory, but has no other
- *                effects. The cache size will not be reset.
+ * Description  : This function will flush the cache and remove the data
+ *                files this program put in it for our effective user id.
+ *                Delayed saves are written first.
  */
 nomask static void
 reset_cache()
 {
-    cache_map   = ([ ]);
-    cache_order = ({ });
+    flush_cache();
+    CACHE_CENTRAL->forget_reader();
 }
 
 /*
@@ -283,7 +336,7 @@ reset_cache()
 nomask static string *
 query_cache()
 {
-    return secure_var(cache_order);
+    return CACHE_CENTRAL->query_files();
 }
 
 /*
@@ -294,6 +347,9 @@ query_cache()
 nomask public void
 cache_report()
 {
-    write(sprintf("Cache tries %6d\nCache hits  %6d\nHit ratio   %6d%%\n",
-	cache_tries, cache_hits, ((cache_hits * 100) / cache_tries)));
+    int *stats = CACHE_CENTRAL->query_client_stats(this_object());
+
+    write(sprintf("Cache tries %6d\nCache hits  %6d\nHit ratio   %6d%%\n" +
+	"Evictions   %6d\n", stats[0], stats[1],
+	(stats[0] ? ((stats[1] * 100) / stats[0]) : 0), stats[3]));
 }
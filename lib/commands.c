@@ -54,6 +54,54 @@ say_gmcp(string verb, string text, object *oblist = 0)
     objs->gmcp_comms_vbfc(verb, text);
 }
 
+/*
+ * Function name: render_add
+ * Description  : Adds an onlooker to the group of people who get the same
+ *                message, so the message is only sent once to each group.
+ * Arguments    : mapping groups - ([ text : ([ name : ({ onlookers }) ]) ])
+ *                string text - the message the onlooker gets.
+ *                string name - the name of the actor for GMCP.
+ *                object player - the onlooker.
+ */
+static void
+render_add(mapping groups, string text, string name, object player)
+{
+    if (!mappingp(groups[text]))
+    {
+        groups[text] = ([ name : ({ player }) ]);
+    }
+    else if (!pointerp(groups[text][name]))
+    {
+        groups[text][name] = ({ player });
+    }
+    else
+    {
+        groups[text][name] += ({ player });
+    }
+}
+
+/*
+ * Function name: render_send
+ * Description  : Sends the messages to the groups of onlookers.
+ * Arguments    : mapping groups - the groups, see render_add().
+ *                string gmcp_verb - the gmcp verb, if any.
+ */
+static void
+render_send(mapping groups, string gmcp_verb)
+{
+    foreach(string text, mapping names: groups)
+    {
+        foreach(string name, object *players: names)
+        {
+            players->catch_tell(text + "\n");
+            if (gmcp_verb)
+            {
+                players->gmcp_comms(gmcp_verb, name, text);
+            }
+        }
+    }
+}
+
 /*
  * Function name: desc_vbfc
  * Description  : This function takes an object and returns the macro QTNAME
@@ -215,6 +263,7 @@ target(string str, object *oblist, string adverb = "", int cmd_attr = 0,
     int poss;
     object *players, *all_oblist;
     string name, text;
+    mapping groups = ([ ]);
 
     /* Sanity check. */
     if (!sizeof(oblist))
@@ -248,22 +297,18 @@ target(string str, object *oblist, string adverb = "", int cmd_attr = 0,
     /* Give only a hook to NPC's. */
     players = FILTER_PLAYERS(oblist);
 
-    /* Tell the message to players. */
-    if (sizeof(players))
+    /* Tell the message to players. For GMCP, don't bother with the
+     * possessive form of the name.
+     */
+    foreach(object player: players)
     {
-	foreach(object player: players)
-	{
-	    /* Do a direct call to allow for shawing. */
-	    name = this_player()->query_The_name(player);
-	    text = (poss ? this_player()->query_The_possessive_name(player) : name) + str;
-	    player->catch_tell(text + "\n");
-	    if (gmcp_verb)
-	    {
-	        /* Don't bother with possessive form. */
-	        player->gmcp_comms(gmcp_verb, name, text);
-	    }
-	}
+        /* Do a direct call to allow for shadowing. */
+        name = this_player()->query_The_name(player);
+        text = (poss ? this_player()->query_The_possessive_name(player) :
+            name) + str;
+        render_add(groups, text, name, player);
     }
+    render_send(groups, gmcp_verb);
 
     oblist->emote_hook(query_verb(), this_player(), adverb, all_oblist,
 	cmd_attr, 1);
@@ -308,6 +353,7 @@ all(string str, string adverb = "", int cmd_attr = 0, string gmcp_verb = 0)
     int poss;
     object *oblist, *players;
     string name, text;
+    mapping groups = ([ ]);
 
     if (str[..1] == "'s")
     {
@@ -327,20 +373,15 @@ all(string str, string adverb = "", int cmd_attr = 0, string gmcp_verb = 0)
     players = FILTER_PLAYERS(oblist);
 
     /* Tell the message to players. */
-    if (sizeof(players))
+    foreach(object player: players)
     {
-	foreach(object player: players)
-	{
-	    /* Do a direct call to allow for shadowing. */
-	    name = this_player()->query_The_name(player);
-	    text = (poss ? this_player()->query_The_possessive_name(player) : name) + str;
-	    player->catch_tell(text + "\n");
-	    if (gmcp_verb)
-	    {
-	        player->gmcp_comms(gmcp_verb, name, text);
-	    }	    
-	}
+        /* Do a direct call to allow for shadowing. */
+        name = this_player()->query_The_name(player);
+        text = (poss ? this_player()->query_The_possessive_name(player) :
+            name) + str;
+        render_add(groups, text, name, player);
     }
+    render_send(groups, gmcp_verb);
 
     oblist->emote_hook(query_verb(), this_player(), adverb, 0, cmd_attr, 0);
     this_player()->emote_hook_actor(query_verb(), oblist);
@@ -394,8 +435,10 @@ all2act(string str, object *oblist, string str1, string adverb = "",
     int cmd_attr = 0, string gmcp_verb = 0)
 {
     int    a_poss, o_poss;
-    string name, text;
+    string name, text, seen, dead;
     object *livings, *players;
+    mapping groups = ([ ]);
+    mapping dead_texts;
 
     /* Sanity check. */
     if (!sizeof(oblist))
@@ -430,30 +473,49 @@ all2act(string str, object *oblist, string str1, string adverb = "",
     if (!strlen(str1))
 	str1 = ".";
 
+    /* When the objects look the same to everyone, they are described only
+     * once for all onlookers who see the same of them.
+     */
+    if (!living(oblist[0]) &&
+        (sizeof(COMPOSITE_STABLE(oblist)) == sizeof(oblist)))
+    {
+        dead_texts = ([ ]);
+    }
+
     players = FILTER_PLAYERS(livings);
-    if (sizeof(players))
+    foreach(object player: players)
     {
-        foreach(object player: players)
-	{
-	    text = capitalize(desc_poss_live(this_player(), player, a_poss) + str + " ");
-	    if (living(oblist[0]))
-	    {
-		text += COMPOSITE_WORDS(map(oblist, &desc_poss_live(, player, o_poss))) + str1;
-	    }
-	    else
-	    {
-	        text += (o_poss ? COMPOSITE_WORDS(map(oblist, &desc_pos_short(, player))) :
-	            FO_COMPOSITE_DEAD(oblist, player)) + str1;
-	    }
-	
-	    player->catch_tell(text + "\n");
-	    if (gmcp_verb)
-	    {
-	        name = this_player()->query_The_name(player);
-		player->gmcp_comms(gmcp_verb, name, text);
-	    }
-	}
+        text = capitalize(desc_poss_live(this_player(), player, a_poss) + str +
+            " ");
+        if (living(oblist[0]))
+        {
+            text += COMPOSITE_WORDS(map(oblist,
+                &desc_poss_live(, player, o_poss))) + str1;
+        }
+        else
+        {
+            if (mappingp(dead_texts))
+            {
+                seen = (o_poss ? "" : implode(map(filter(oblist,
+                    &->check_seen(player)), file_name), ","));
+            }
+            if (!mappingp(dead_texts) || !stringp(dead = dead_texts[seen]))
+            {
+                dead = (o_poss ?
+                    COMPOSITE_WORDS(map(oblist, &desc_pos_short(, player))) :
+                    FO_COMPOSITE_DEAD(oblist, player));
+                if (mappingp(dead_texts))
+                {
+                    dead_texts[seen] = dead;
+                }
+            }
+            text += dead + str1;
+        }
+
+        name = (gmcp_verb ? this_player()->query_The_name(player) : "");
+        render_add(groups, text, name, player);
     }
+    render_send(groups, gmcp_verb);
 
     livings->emote_hook_onlooker(query_verb(), this_player(), adverb, oblist,
 	cmd_attr);
@@ -396,6 +396,36 @@ shop_hook_list_no_match(string str)
     notify_fail("We have no '" + str + "' in stock.\n");
 }
 
+/*
+ * Function name: shop_hook_list_no_page
+ * Description:   Called if player asked for a page of the list that does
+ *		  not exist
+ * Arguments:	  str  - The string he asked for, or 0 for all
+ *		  page - The page he asked for
+ * Returns:	  0
+ */
+int
+shop_hook_list_no_page(string str, int page)
+{
+    notify_fail("There is no page " + page + " of that list.\n");
+}
+
+/*
+ * Function name: shop_hook_list_page
+ * Description:   Called after a page of the list has been shown, when the
+ *		  list does not fit on one page
+ * Arguments:	  str   - The string he asked for, or 0 for all
+ *		  page  - The page shown
+ *		  pages - The number of pages
+ */
+void
+shop_hook_list_page(string str, int page, int pages)
+{
+    write("Page " + page + " of " + pages + "." + ((page < pages) ?
+        (" Use 'list " + (strlen(str) ? (str + " ") : "") + "page " +
+        (page + 1) + "' to see more.\n") : "\n"));
+}
+
 /*
  * Function name: shop_hook_fail_storeroom
  * Description  : This function is called when a player tries to enter
@@ -627,7 +657,9 @@ do_read(string str)
 "    value     - will value an item you carry before you decide to sell it.\n" +
 "    show      - appraise one of the items in stock before you buy it.\n" +
 "    list      - will list the items in stock, 'list armours' and 'list\n" +
-"                weapons' are valid commands, or ie. 'list swords'.\n");
+"                weapons' are valid commands, or ie. 'list swords'.\n" +
+"                Long lists are shown in pages, use ie. 'list page 2' or\n" +
+"                'list weapons page 2' to see the next page.\n");
     return 1;
 }
 
@@ -871,13 +903,23 @@ buy_it(object *items, string str2, string str3)
  * Description:   Maskable function that by default calls the macro
  *                FIND_STR_IN_OBJECT. Allows a shop to define its own
  *                mechanism for how to get objects from the storeroom.
+ *                When the storeroom keeps an index of its items (see
+ *                /lib/store_support.c), the items with the name that is
+ *                asked for are parsed first. When none of them matches,
+ *                the whole storeroom is parsed.
  */
 public object *
 find_str_in_object(string str, object obj)
 {
-    object * items;
-    items = FIND_STR_IN_OBJECT(str, obj);
-    return items;
+    object *items = obj->query_store_named(str);
+
+    if (sizeof(items) &&
+        sizeof(items = FIND_STR_IN_ARR(str, items)))
+    {
+        return items;
+    }
+
+    return FIND_STR_IN_OBJECT(str, obj);
 }
 
 /*
@@ -1005,17 +1047,20 @@ do_value(string str)
 
 /*
  * Function name:   do_list
- * Description:     Provide a list of objects in the store room
+ * Description:     Provide a list of objects in the store room. The list is
+ *                  shown in pages of MAXLIST items.
  * Returns:         0 if not recognised
  *                  1 otherwise
- * Arguments: 	    str - the name of the objects to search for
+ * Arguments: 	    str - the name of the objects to search for, possibly
+ *                        followed by "page <number>"
  */
 int
 do_list(string str)
 {
-    object *items;
+    object *items, *index;
     object store_object;
-    int i, max, price, *arr;
+    string what;
+    int i, max, page, pages, price;
 
     ASSIGN_AND_VALIDATE_STORE_OBJECT(store_object);
 
@@ -1027,32 +1072,69 @@ do_list(string str)
 	return 0;
     }
 
+    /* See whether the player wants a certain page. */
+    page = 1;
+    if (str && (sscanf(str, "page %d", page) == 1))
+    {
+        str = 0;
+    }
+    else if (str && (sscanf(str, "%s page %d", what, page) == 2))
+    {
+        str = what;
+    }
+
+    /* The store room may know its weapons and armours already. */
     if (str == "weapons")
     {
-        items = filter(items, weapon_filter);
+        if ((function_exists("weapon_filter", this_object()) !=
+            SHOP_LIBRARY) ||
+            !pointerp(index = store_object->query_store_index("type:weapons")))
+        {
+            index = filter(items, weapon_filter);
+        }
+        items = index;
     }
     else if (str == "armours")
     {
-        items = filter(items, armour_filter);
+        if ((function_exists("armour_filter", this_object()) !=
+            SHOP_LIBRARY) ||
+            !pointerp(index = store_object->query_store_index("type:armours")))
+        {
+            index = filter(items, armour_filter);
+        }
+        items = index;
     }
     else if (str)
     {
-	items = FIND_STR_IN_ARR(str, items);
+        index = store_object->query_store_named(str);
+        if (!sizeof(index) ||
+            !sizeof(index = FIND_STR_IN_ARR(str, index)))
+        {
+            index = FIND_STR_IN_ARR(str, items);
+        }
+        items = index;
     }
 
     if (sizeof(items) < 1)
 	return shop_hook_list_no_match(str);
- 
-    max = MIN(MAXLIST, sizeof(items));
-    for (i = 0; i < max; i++)
+
+    pages = (sizeof(items) + MAXLIST - 1) / MAXLIST;
+    if ((page < 1) || (page > pages))
+    {
+        return shop_hook_list_no_page(str, page);
+    }
+
+    i = (page - 1) * MAXLIST;
+    max = MIN(page * MAXLIST, sizeof(items));
+    for (; i < max; i++)
     {
 	price = query_buy_price(items[i]);
 	shop_hook_list_object(items[i], price);
     }
 
-    if (max < sizeof(items))
+    if (pages > 1)
     {
-	write("Truncated...\n");
+        shop_hook_list_page(str, page, pages);
     }
 
     return 1;
@@ -1067,7 +1149,7 @@ do_list(string str)
 int
 do_show(string str)
 {
-    object *items;
+    object *items, *index;
     object store_object;
 
     ASSIGN_AND_VALIDATE_STORE_OBJECT(store_object);
@@ -1080,7 +1162,13 @@ do_show(string str)
 	return 0;
     }
 
-    items = FIND_STR_IN_ARR(str, items);
+    index = store_object->query_store_named(str);
+    if (!sizeof(index) ||
+        !sizeof(index = FIND_STR_IN_ARR(str, index)))
+    {
+        index = FIND_STR_IN_ARR(str, items);
+    }
+    items = index;
 
     if (sizeof(items) < 1)
     {
@@ -27,6 +27,11 @@
  *   {
  *       reset_store();
  *   }
+ *
+ * The store keeps an index of its items by master file, long description,
+ * type and name, so the shop does not have to parse the whole inventory for
+ * every request. The index follows the inventory of the store by itself,
+ * also when items are bought or destructed.
  */
 
 #pragma save_binary
@@ -34,6 +39,7 @@
 
 #include <files.h>
 #include <filter_funs.h>
+#include <language.h>
 #include <macros.h>
 
 /*
@@ -51,6 +57,15 @@ static int     stock_alarm_id = 0;
 static object *remove_list    = ({ });
 static mixed   default_stock  = ({ });
 
+/*
+ * store_index - ([ key : ({ items }) ]) with the keys "file:<master file>",
+ *               "long:<long description>", "type:weapons", "type:armours"
+ *               and "name:<name>" for every singular and plural name.
+ * store_keys  - ([ item : ({ keys }) ]) the keys of each item in the index.
+ */
+static mapping store_index    = ([ ]);
+static mapping store_keys     = ([ ]);
+
 /*
  * Function name: set_max_items
  * Description  : Set the maximum number of items allowed in this store. This
@@ -122,6 +137,167 @@ set_max_values(int items, int identical)
     set_max_identical(identical);
 }
 
+/*
+ * Function name: store_add_index
+ * Description  : Adds an item to the index of the store.
+ * Arguments    : object obj - the item.
+ */
+static void
+store_add_index(object obj)
+{
+    string *keys;
+    string *names;
+
+    keys = ({ "file:" + MASTER_OB(obj), "long:" + obj->long() });
+
+    if (IS_WEAPON_OBJECT(obj))
+    {
+        keys += ({ "type:weapons" });
+    }
+    else if (IS_ARMOUR_OBJECT(obj))
+    {
+        keys += ({ "type:armours" });
+    }
+
+    /* These are the names parse_command() knows the item by. */
+    names = obj->parse_command_id_list();
+    names = (pointerp(names) ? names : ({ }));
+    foreach(string name: names)
+    {
+        keys += ({ "name:" + name, "name:" + LANG_PWORD(name) });
+    }
+    names = obj->parse_command_plural_id_list();
+    names = (pointerp(names) ? names : ({ }));
+    foreach(string name: names)
+    {
+        keys += ({ "name:" + name });
+    }
+
+    store_keys[obj] = keys;
+    foreach(string key: keys)
+    {
+        store_index[key] = (pointerp(store_index[key]) ?
+            ((store_index[key] - ({ 0, obj })) + ({ obj })) : ({ obj }));
+    }
+}
+
+/*
+ * Function name: store_remove_index
+ * Description  : Removes an item from the index of the store.
+ * Arguments    : object obj - the item.
+ */
+static void
+store_remove_index(object obj)
+{
+    if (!pointerp(store_keys[obj]))
+    {
+        return;
+    }
+
+    foreach(string key: store_keys[obj])
+    {
+        store_index[key] -= ({ obj });
+        if (!sizeof(store_index[key]))
+        {
+            m_delkey(store_index, key);
+        }
+    }
+
+    m_delkey(store_keys, obj);
+}
+
+/*
+ * Function name: store_check_index
+ * Description  : Brings the index up to date with the inventory of the
+ *                store. Items that left are removed and items that entered
+ *                are added. When an item was destructed, the index is made
+ *                again.
+ * Returns      : object * - the items in the store.
+ */
+static object *
+store_check_index()
+{
+    object *inv = FILTER_DEAD(all_inventory(this_object()));
+    object *indexed = m_indices(store_keys);
+
+    if (IN_ARRAY(0, indexed))
+    {
+        store_index = ([ ]);
+        store_keys = ([ ]);
+        indexed = ({ });
+    }
+
+    foreach(object obj: indexed - inv)
+    {
+        store_remove_index(obj);
+    }
+    foreach(object obj: inv - indexed)
+    {
+        store_add_index(obj);
+    }
+
+    return inv;
+}
+
+/*
+ * Function name: query_store_index
+ * Description  : Finds the items in the store under a key of the index.
+ * Arguments    : string key - the key, e.g. "type:weapons" or "file:" plus
+ *                    the master file of the items.
+ * Returns      : object * - the items, in the order of the inventory.
+ */
+public object *
+query_store_index(string key)
+{
+    object *inv = store_check_index();
+
+    return (pointerp(store_index[key]) ? (inv & store_index[key]) : ({ }));
+}
+
+/*
+ * Function name: query_store_named
+ * Description  : Finds the items in the store that may answer to a
+ *                description like "two steel swords" or "sword 2", by the
+ *                name in it. The description must still be parsed.
+ * Arguments    : string str - the description.
+ * Returns      : object * - the items with the name, or 0 if no item in
+ *                    the store has it.
+ */
+public object *
+query_store_named(string str)
+{
+    string *words;
+    string name;
+    object *inv;
+
+    if (!strlen(str))
+    {
+        return 0;
+    }
+
+    words = explode(lower_case(str), " ") - ({ "" });
+    if (!sizeof(words))
+    {
+        return 0;
+    }
+
+    /* Skip the number in "sword 2". */
+    name = words[sizeof(words) - 1];
+    if ((sizeof(words) > 1) && atoi(name))
+    {
+        name = words[sizeof(words) - 2];
+    }
+
+    name = "name:" + name;
+    inv = store_check_index();
+    if (!pointerp(store_index[name]))
+    {
+        return 0;
+    }
+
+    return (inv & store_index[name]);
+}
+
 /*
  * Function name: store_remove_items
  * Description  : Called with a little delay to actually remove items from
@@ -133,6 +309,10 @@ store_remove_items()
     /* Only remove items that are actually in this store still. */
     remove_list &= all_inventory(this_object());
 
+    foreach(object item: remove_list)
+    {
+        store_remove_index(item);
+    }
     remove_list->remove_object();
 
     remove_list = ({ });
@@ -163,14 +343,20 @@ store_update(object obj)
         obj->extinguish_me();
     }
 
-    inv = FILTER_DEAD(all_inventory(this_object()) - ({ obj }) - remove_list);
+    inv = store_check_index() - ({ obj }) - remove_list;
+
+    /* The item may have changed since it was indexed, e.g. a torch that
+     * was put out, so index it afresh.
+     */
+    store_remove_index(obj);
+    store_add_index(obj);
 
     if (max_identical)
     {
         /* We find two items identical if their long descriptions are
-         * identical.
+         * identical. The index knows them by the long description.
          */
-        identical = filter(inv, &operator(==)(obj->long()) @ &->long());
+        identical = inv & store_index[store_keys[obj][1]];
         if (sizeof(identical) >= max_identical)
         {
             remove_list += identical[..(sizeof(identical) - max_identical)];
@@ -267,11 +453,14 @@ reset_store()
     int size  = sizeof(default_stock);
     int total;
     int counted;
-    object *inv;
+    object *npcs;
+
+    /* The index only holds items. Stock such as pets or mounts is counted
+     * among the livings, though players are never stock.
+     */
+    npcs = FILTER_LIVE(all_inventory(this_object()));
+    npcs -= FILTER_PLAYERS(npcs);
 
-    inv = all_inventory();
-    inv -= FILTER_PLAYERS(inv);
-    
     /* For each of the items in the default stock, check the amount of items
      * in stock and clone new items if necessary.
      */
@@ -280,9 +469,13 @@ reset_store()
         total = ((default_stock[index + 1] == 1) ? default_stock[index + 1] :
             (default_stock[index + 1] - 1 + random(3)));
 
-        counted = sizeof(filter(inv, &operator(==)(default_stock[index]) @
-                             &extract(, 0, (strlen(default_stock[index]) - 1)) @
-                             file_name));
+        counted = sizeof(query_store_index("file:" + default_stock[index]));
+        if (sizeof(npcs))
+        {
+            counted += sizeof(filter(npcs,
+                &operator(==)(default_stock[index]) @ &extract(, 0,
+                (strlen(default_stock[index]) - 1)) @ file_name));
+        }
         
         while(++counted <= total)
         {
@@ -267,6 +267,9 @@ start_shutdown(string reason, int delay, string shutter)
     shutdown_delay   = delay;
     shutdown_manual  = (shutter != ROOT_UID);
 
+    /* Save all players right away rather than waiting for their turns. */
+    AUTOSAVE_SCHEDULER->save_all();
+
     if (!shutdown_delay)
     {
 	shutdown_now();
@@ -0,0 +1,409 @@
+/*
+ * /secure/log_central.c
+ *
+ * This object buffers the lines written with log_file() and log_syslog().
+ * Rather than creating the directories, checking the cycle size and writing
+ * to disk for every line, the simul_efun hands the lines to us. They are
+ * kept per log file and written in one go when FLUSH_DELAY seconds have
+ * passed, when the buffer of a file grows beyond FLUSH_SIZE bytes, or when
+ * the game is shut down.
+ *
+ * The rules are the same as those of log_file(). The lines are written with
+ * the euid of the owner of the log, the directories of the log are created
+ * when they do not exist, and a log is moved to <log>.old when it is larger
+ * than its cycle size. The cycle size is checked before every write, so a
+ * log may grow at most one buffer beyond its cycle size.
+ *
+ * The directories known to exist are remembered, so they are only checked
+ * again when a write fails. For every log we count the lines and bytes
+ * written, in total and in the last minute, so noisy logs can be found
+ * with stat_object().
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma no_shadow
+#pragma strict_types
+
+#include <files.h>
+#include <macros.h>
+#include <std.h>
+
+/* The delay in seconds before buffered lines are written. */
+#define FLUSH_DELAY    (5.0)
+
+/* The number of bytes of a log we buffer before writing it right away. */
+#define FLUSH_SIZE     (8192)
+
+/* Indices into the buffers. */
+#define BUF_EUID       (0)
+#define BUF_DIR        (1)
+#define BUF_CYCLE      (2)
+#define BUF_LINES      (3)
+#define BUF_BYTES      (4)
+
+/* Indices into the rates. */
+#define RATE_LINES     (0)
+#define RATE_BYTES     (1)
+#define RATE_MINUTE    (2)
+#define RATE_NOW       (3)
+#define RATE_LAST      (4)
+
+/*
+ * Global variables.
+ *
+ * buffers - ([ file : ({ euid, dir, cycle size, *lines, bytes }) ])
+ * dirs    - ([ dir : 1 ]) the directories that are known to exist.
+ * rates   - ([ file : ({ lines, bytes, minute, lines this minute,
+ *                        lines last minute }) ])
+ */
+private static mapping buffers = ([ ]);
+private static mapping dirs = ([ ]);
+private static mapping rates = ([ ]);
+private static int     flush_alarm;
+
+/*
+ * Statistics.
+ */
+private static int     stat_start;
+private static int     stat_lines;
+private static int     stat_writes;
+private static int     stat_rotations;
+private static int     stat_mkdirs;
+private static int     stat_failures;
+
+/*
+ * Prototypes.
+ */
+public void flush_all();
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    stat_start = time();
+}
+
+/*
+ * Function name: remove_object
+ * Description  : Write all buffered lines before we are destructed.
+ */
+public void
+remove_object()
+{
+    flush_all();
+    destruct();
+}
+
+/*
+ * Function name: make_dir
+ * Description  : Makes sure the directory of a log exists, creating the
+ *                missing parts of the path. Must be called with the euid of
+ *                the owner of the log.
+ * Arguments    : string dir - the directory.
+ * Returns      : int 1/0 - the directory exists or not.
+ */
+static int
+make_dir(string dir)
+{
+    string *split;
+    string path = "";
+
+    if (dirs[dir])
+    {
+        return 1;
+    }
+
+    if (file_size(dir) != -2)
+    {
+        split = explode(dir + "/", "/");
+        foreach(string part: split)
+        {
+            path += "/" + part;
+            if (file_size(path) == -1)
+            {
+                mkdir(path);
+                stat_mkdirs++;
+            }
+            else if (file_size(path) > 0)
+            {
+                return 0;
+            }
+        }
+    }
+
+    dirs[dir] = 1;
+    return 1;
+}
+
+/*
+ * Function name: flush_file
+ * Description  : Writes the buffered lines of a log to disk.
+ * Arguments    : string file - the log.
+ */
+static void
+flush_file(string file)
+{
+    mixed  buffer = buffers[file];
+    string text;
+
+    m_delkey(buffers, file);
+    if (!pointerp(buffer))
+    {
+        return;
+    }
+
+    text = implode(buffer[BUF_LINES], "");
+    seteuid(buffer[BUF_EUID]);
+
+    if (!make_dir(buffer[BUF_DIR]))
+    {
+        stat_failures++;
+        seteuid(getuid());
+        return;
+    }
+
+    /* If we have a positive cycle size, enforce it. */
+    if ((buffer[BUF_CYCLE] > 0) &&
+        (file_size(file) > buffer[BUF_CYCLE]))
+    {
+        rename(file, file + ".old");
+        stat_rotations++;
+    }
+
+    /* The directory may have been removed since we last saw it. */
+    if (!write_file(file, text))
+    {
+        m_delkey(dirs, buffer[BUF_DIR]);
+        if (!make_dir(buffer[BUF_DIR]) ||
+            !write_file(file, text))
+        {
+            stat_failures++;
+        }
+    }
+
+    stat_writes++;
+    seteuid(getuid());
+}
+
+/*
+ * Function name: flush_all
+ * Description  : Writes the buffered lines of all logs to disk. It is
+ *                called from the alarm, and from the master when the game
+ *                is shut down. Anyone may call it, as it is harmless.
+ */
+public void
+flush_all()
+{
+    remove_alarm(flush_alarm);
+    flush_alarm = 0;
+
+    foreach(string file: m_indexes(buffers))
+    {
+        flush_file(file);
+    }
+}
+
+/*
+ * Function name: roll_rate
+ * Description  : Starts counting a new minute for a log when the previous
+ *                one passed.
+ * Arguments    : mixed rate - the rate of the log.
+ */
+static void
+roll_rate(mixed rate)
+{
+    int minute = time() / 60;
+
+    if (rate[RATE_MINUTE] != minute)
+    {
+        /* Only the minute right before this one counts as the last. */
+        rate[RATE_LAST] = ((rate[RATE_MINUTE] == (minute - 1)) ?
+            rate[RATE_NOW] : 0);
+        rate[RATE_MINUTE] = minute;
+        rate[RATE_NOW] = 0;
+    }
+}
+
+/*
+ * Function name: count_line
+ * Description  : Counts a line for the rate of a log.
+ * Arguments    : string file - the log.
+ *                int bytes - the length of the line.
+ */
+static void
+count_line(string file, int bytes)
+{
+    mixed rate = rates[file];
+
+    if (!pointerp(rate))
+    {
+        rate = ({ 0, 0, time() / 60, 0, 0 });
+        rates[file] = rate;
+    }
+
+    roll_rate(rate);
+    rate[RATE_LINES]++;
+    rate[RATE_BYTES] += bytes;
+    rate[RATE_NOW]++;
+    stat_lines++;
+}
+
+/*
+ * Function name: buffer_log
+ * Description  : Called from log_file() to add a line to a log.
+ * Arguments    : string euid - the owner of the log.
+ *                string dir - the directory of the log.
+ *                string file - the path of the log.
+ *                string text - the text to add.
+ *                int cyclesize - the cycle size of the log, or <= 0 for
+ *                    none.
+ * Returns      : int 1/0 - buffered, or not allowed.
+ */
+public int
+buffer_log(string euid, string dir, string file, string text, int cyclesize)
+{
+    mixed buffer;
+
+    if (previous_object() != find_object(SIMUL_EFUN))
+    {
+        return 0;
+    }
+
+    count_line(file, strlen(text));
+
+    buffer = buffers[file];
+    if (!pointerp(buffer) ||
+        (buffer[BUF_EUID] != euid) ||
+        (buffer[BUF_CYCLE] != cyclesize))
+    {
+        flush_file(file);
+        buffer = ({ euid, dir, cyclesize, ({ }), 0 });
+        buffers[file] = buffer;
+    }
+
+    buffer[BUF_LINES] += ({ text });
+    buffer[BUF_BYTES] += strlen(text);
+
+    if (buffer[BUF_BYTES] > FLUSH_SIZE)
+    {
+        flush_file(file);
+    }
+    else if (!flush_alarm)
+    {
+        flush_alarm = set_alarm(FLUSH_DELAY, 0.0, flush_all);
+    }
+
+    return 1;
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the statistics of the log writer.
+ * Returns      : mapping - the statistics, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    return ([
+        "buffered"  : m_sizeof(buffers),
+        "dirs"      : m_sizeof(dirs),
+        "logs"      : m_sizeof(rates),
+        "lines"     : stat_lines,
+        "writes"    : stat_writes,
+        "rotations" : stat_rotations,
+        "mkdirs"    : stat_mkdirs,
+        "failures"  : stat_failures,
+        "since"     : stat_start,
+        ]);
+}
+
+/*
+ * Function name: query_rate
+ * Description  : Find out how many lines were written to a log.
+ * Arguments    : string file - the path of the log.
+ * Returns      : int * - ({ lines, bytes, lines this minute, lines last
+ *                    minute }), or 0 if nothing was logged.
+ */
+public int *
+query_rate(string file)
+{
+    mixed rate = rates[file];
+
+    if (!pointerp(rate))
+    {
+        return 0;
+    }
+
+    roll_rate(rate);
+
+    return ({ rate[RATE_LINES], rate[RATE_BYTES], rate[RATE_NOW],
+        rate[RATE_LAST] });
+}
+
+/*
+ * Function name: sort_rate
+ * Description  : Sorts the logs with the most lines in the last minute
+ *                first, and then the most lines in total.
+ * Arguments    : mapping current - ([ file : ({ rate }) ]).
+ *                string a, b - the logs to compare.
+ * Returns      : int - -1, 0 or 1.
+ */
+static int
+sort_rate(mapping current, string a, string b)
+{
+    int diff = (current[b][3] - current[a][3]);
+
+    if (!diff)
+    {
+        diff = (current[b][0] - current[a][0]);
+    }
+
+    return ((diff > 0) ? 1 : ((diff < 0) ? -1 : 0));
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the use of the log writer when a wizard stats it,
+ *                with the logs that are written most often.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    mapping current = ([ ]);
+    string *files;
+    string str;
+
+    str = sprintf("Log writer since %s\n", ctime(stat_start)) +
+        sprintf("Lines     : %8d    Writes   : %d    Buffered : %d\n",
+            stat_lines, stat_writes, m_sizeof(buffers)) +
+        sprintf("Rotations : %8d    Mkdirs   : %d    Failures : %d\n",
+            stat_rotations, stat_mkdirs, stat_failures);
+
+    foreach(string file: m_indexes(rates))
+    {
+        current[file] = query_rate(file);
+    }
+    if (!m_sizeof(current))
+    {
+        return str;
+    }
+
+    str += sprintf("\n%8s %8s %8s %10s  %s\n", "Lines", "Now", "Last",
+        "Bytes", "Log");
+    files = sort_array(m_indexes(current), &sort_rate(current));
+    foreach(string file: files[..19])
+    {
+        str += sprintf("%8d %8d %8d %10d  %s\n", current[file][0],
+            current[file][2], current[file][3], current[file][1], file);
+    }
+
+    return str;
+}
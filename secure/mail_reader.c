@@ -347,14 +347,14 @@ save_mail(mapping mail, string name)
 
 /*
  * Function name: restore_message
- * Description  : Restore an individual message from disk.
+ * Description  : Restore an individual message from the mail store.
  * Arguments    : int date - the time of the message.
  * Returns      : mapping  - the message restored.
  */
 static mapping
 restore_message(int date)
 {
-    mapping message = restore_map(FILE_NAME_MESSAGE(date, HASH_SIZE));
+    mapping message = MAIL_STORE->restore_message(date);
 
     /* This should not happen, but somehow the message can be destructed.
      * An empty (error containing) message is returned.
@@ -369,21 +369,14 @@ restore_message(int date)
 
 /*
  * Function name: save_message
- * Description  : Save the individual message to disk.
+ * Description  : Save the individual message in the mail store.
  * Arguments    : mapping message - the message.
  *                int     date    - the current time to save.
  * Returns      : int     1/0     - success/failure. */
 static int
 save_message(mapping message, int date)
 {
-    string file = FILE_NAME_MESSAGE(date, HASH_SIZE);
-
-    save_map(message, file);
-
-    if (file_size(file + ".o") <= 0)
-        return 0;
-
-    return 1;
+    return MAIL_STORE->save_message(message, date);
 }
 
 
@@ -2054,7 +2047,7 @@ send_mail(string name)
      * the same time (matching seconds). When that happens, we go for the
      * next available second.
      */
-    while(file_size(FILE_NAME_MESSAGE(send_time, HASH_SIZE) + ".o") > 0)
+    while(MAIL_STORE->query_message_exists(send_time))
         send_time++;
 
     /* Construct the mail-message and save it. */
@@ -2646,8 +2639,7 @@ erase()
          */
         if (strlen(message[MSG_ADDRESS]) == 0)
         {
-            rm(FILE_NAME_MESSAGE(pMessages[to_del][MAIL_DATE], HASH_SIZE) +
-                ".o");
+            MAIL_STORE->delete_message(pMessages[to_del][MAIL_DATE]);
 #ifdef DEBUG
             WRITE("DEBUG: Deleting message and removing file: " +
                 del_arr[index] + ".\n");
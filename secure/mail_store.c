@@ -0,0 +1,629 @@
+/*
+ * /secure/mail_store.c
+ *
+ * This object keeps the mail messages of the game. Rather than a file per
+ * message, the messages are appended to segment files, each segment holding
+ * the messages of one week. The index of a segment holds the offset and
+ * length of the body of every message and the fields that may change, so
+ * reading a message costs a single read_bytes() once the index is loaded.
+ * See <mail.h> for the format of the segments.
+ *
+ * Since a single message is often read by many players, for instance when
+ * it was sent to a whole domain, the messages that were read most recently
+ * are kept in a cache shared by all mail readers.
+ *
+ * Message files in the old format (a file per message in the hashed
+ * directories) are still read. A message is moved into its segment when it
+ * is saved again, or when "mailadmin convert" runs.
+ *
+ * Only the mail reader and the master may use this object:
+ *
+ *    mapping restore_message(int date)
+ *    int     save_message(mapping message, int date)
+ *    void    delete_message(int date)
+ *    int     query_message_exists(int date)
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma resident
+#pragma save_binary
+#pragma strict_types
+
+#include <files.h>
+#include <macros.h>
+#include <mail.h>
+#include <std.h>
+
+/* The number of messages and segment indices kept in memory. */
+#define MAX_CACHED_MESSAGES (250)
+#define MAX_CACHED_SEGMENTS ( 16)
+
+/* Don't bother to compact a segment when it wastes less than this. */
+#define MIN_COMPACT_BYTES   (50000)
+
+/* The file with the counters, and the time to wait before saving it. */
+#define STORE_SAVE_FILE     (MSG_DIR + "store")
+#define STORE_SAVE_DELAY    (30.0)
+
+/* The counters that are saved. */
+#define STAT_MESSAGES       "messages"
+#define STAT_RECIPIENTS     "recipients"
+#define STAT_BYTES          "bytes"
+#define STAT_DEAD           "dead"
+#define STAT_SEGMENTS       "segments"
+#define STAT_CONVERTED      "converted"
+
+/*
+ * Global variables.
+ *
+ * messages      - ([ date : message ]) the messages in the cache.
+ * message_order - the dates in the cache, least recently used first.
+ * segments      - ([ segment : index ]) the loaded segment indices.
+ * segment_order - the loaded segments, least recently used first.
+ * counters      - the counters that are saved, see STAT_*.
+ */
+private static mapping messages = ([ ]);
+private static int     *message_order = ({ });
+private static mapping segments = ([ ]);
+private static int     *segment_order = ({ });
+private static mapping counters;
+private static int     save_alarm;
+
+/*
+ * Statistics since the object was loaded.
+ */
+private static int     stat_start;
+private static int     stat_reads;
+private static int     stat_hits;
+private static int     stat_legacy;
+private static int     stat_writes;
+private static int     stat_deletes;
+private static int     stat_compactions;
+
+/*
+ * Function name: create
+ * Description  : Constructor. Restore the counters.
+ */
+nomask void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    counters = restore_map(STORE_SAVE_FILE);
+    if (!mappingp(counters))
+    {
+        counters = ([ ]);
+    }
+
+    stat_start = time();
+}
+
+/*
+ * Function name: valid_caller
+ * Description  : Only the mail reader and the master may handle messages.
+ * Returns      : int 1/0 - true if previous_object() may call us.
+ */
+static int
+valid_caller()
+{
+    return ((MASTER_OB(previous_object()) == MAIL_READER) ||
+        (previous_object() == find_object(SECURITY)));
+}
+
+/*
+ * Function name: save_counters
+ * Description  : Saves the counters, called from an alarm.
+ */
+static void
+save_counters()
+{
+    save_alarm = 0;
+    save_map(counters, STORE_SAVE_FILE);
+}
+
+/*
+ * Function name: add_counter
+ * Description  : Changes a counter and makes sure it will be saved.
+ * Arguments    : string name - the name of the counter.
+ *                int value - the value to add.
+ */
+static void
+add_counter(string name, int value)
+{
+    counters[name] += value;
+
+    if (!save_alarm)
+    {
+        save_alarm = set_alarm(STORE_SAVE_DELAY, 0.0, save_counters);
+    }
+}
+
+/*
+ * Function name: load_segment
+ * Description  : Finds the index of a segment, loading it when necessary.
+ * Arguments    : int segment - the number of the segment.
+ * Returns      : mapping - the index, see <mail.h>.
+ */
+static mapping
+load_segment(int segment)
+{
+    mapping index = segments[segment];
+
+    if (mappingp(index))
+    {
+        segment_order = (segment_order - ({ segment })) + ({ segment });
+        return index;
+    }
+
+    index = restore_map(FILE_NAME_SEGMENT_INDEX(segment));
+    if (!mappingp(index) ||
+        !mappingp(index[SEGMENT_MESSAGES]))
+    {
+        index = ([ SEGMENT_MESSAGES : ([ ]), SEGMENT_DEAD : 0 ]);
+    }
+
+    if (sizeof(segment_order) >= MAX_CACHED_SEGMENTS)
+    {
+        m_delkey(segments, segment_order[0]);
+        segment_order = segment_order[1..];
+    }
+
+    segments[segment] = index;
+    segment_order += ({ segment });
+    return index;
+}
+
+/*
+ * Function name: save_segment
+ * Description  : Saves the index of a segment. When the segment has no
+ *                messages left, its files are removed.
+ * Arguments    : int segment - the number of the segment.
+ */
+static void
+save_segment(int segment)
+{
+    mapping index = segments[segment];
+
+    if (m_sizeof(index[SEGMENT_MESSAGES]))
+    {
+        save_map(index, FILE_NAME_SEGMENT_INDEX(segment));
+        return;
+    }
+
+    add_counter(STAT_DEAD, -index[SEGMENT_DEAD]);
+    add_counter(STAT_SEGMENTS, -1);
+    rm(FILE_NAME_SEGMENT_DATA(segment));
+    rm(FILE_NAME_SEGMENT_INDEX(segment) + ".o");
+
+    m_delkey(segments, segment);
+    segment_order -= ({ segment });
+}
+
+/*
+ * Function name: compact_segment
+ * Description  : Rewrites the data file of a segment without the bodies of
+ *                deleted messages. If anything fails, the old file remains.
+ * Arguments    : int segment - the number of the segment.
+ */
+static void
+compact_segment(int segment)
+{
+    mapping index = segments[segment];
+    string  data = FILE_NAME_SEGMENT_DATA(segment);
+    string  temp = data + ".new";
+    string  body;
+    int     offset;
+
+    rm(temp);
+    foreach(int date, mixed entry: index[SEGMENT_MESSAGES])
+    {
+        body = (entry[SEG_LENGTH] ?
+            read_bytes(data, entry[SEG_OFFSET], entry[SEG_LENGTH]) : "");
+        if (!stringp(body) ||
+            (strlen(body) && !write_file(temp, body)))
+        {
+            rm(temp);
+            return;
+        }
+    }
+
+    rm(data);
+    rename(temp, data);
+
+    foreach(int date, mixed entry: index[SEGMENT_MESSAGES])
+    {
+        entry[SEG_OFFSET] = offset;
+        offset += entry[SEG_LENGTH];
+    }
+
+    add_counter(STAT_DEAD, -index[SEGMENT_DEAD]);
+    index[SEGMENT_DEAD] = 0;
+    stat_compactions++;
+}
+
+/*
+ * Function name: cache_message
+ * Description  : Puts a message in the shared cache.
+ * Arguments    : int date - the time of the message.
+ *                mapping message - the message.
+ */
+static void
+cache_message(int date, mapping message)
+{
+    if (!mappingp(messages[date]) &&
+        (sizeof(message_order) >= MAX_CACHED_MESSAGES))
+    {
+        m_delkey(messages, message_order[0]);
+        message_order = message_order[1..];
+    }
+
+    messages[date] = message;
+    message_order = (message_order - ({ date })) + ({ date });
+}
+
+/*
+ * Function name: uncache_message
+ * Description  : Removes a message from the shared cache.
+ * Arguments    : int date - the time of the message.
+ */
+static void
+uncache_message(int date)
+{
+    m_delkey(messages, date);
+    message_order -= ({ date });
+}
+
+/*
+ * Function name: restore_legacy
+ * Description  : Restores a message from a file in the old format.
+ * Arguments    : int date - the time of the message.
+ * Returns      : mapping - the message, or 0 if there is none.
+ */
+static mapping
+restore_legacy(int date)
+{
+    mapping message;
+
+    catch(message = restore_map(FILE_NAME_MESSAGE(date, HASH_SIZE)));
+    if (!mappingp(message) ||
+        (m_sizeof(message) != M_SIZEOF_MSG))
+    {
+        return 0;
+    }
+
+    stat_legacy++;
+    return message;
+}
+
+/*
+ * Function name: restore_message
+ * Description  : Restores an individual message. The caller gets a copy,
+ *                so it may change the message freely.
+ * Arguments    : int date - the time of the message.
+ * Returns      : mapping - the message, or 0 if there is no such message.
+ */
+public mapping
+restore_message(int date)
+{
+    mapping message;
+    mixed   entry;
+    string  body;
+    int     segment = MAIL_SEGMENT(date);
+
+    if (!valid_caller())
+    {
+        return 0;
+    }
+
+    stat_reads++;
+    if (mappingp(message = messages[date]))
+    {
+        stat_hits++;
+        message_order = (message_order - ({ date })) + ({ date });
+        return ([ ]) + message;
+    }
+
+    entry = load_segment(segment)[SEGMENT_MESSAGES][date];
+    if (pointerp(entry))
+    {
+        body = (entry[SEG_LENGTH] ? read_bytes(FILE_NAME_SEGMENT_DATA(segment),
+            entry[SEG_OFFSET], entry[SEG_LENGTH]) : "");
+        if (!stringp(body))
+        {
+            return 0;
+        }
+
+        message = ([ MSG_TO      : entry[SEG_TO],
+                     MSG_CC      : entry[SEG_CC],
+                     MSG_ADDRESS : entry[SEG_ADDRESS],
+                     MSG_BODY    : body ]);
+    }
+    else if (!mappingp(message = restore_legacy(date)))
+    {
+        return 0;
+    }
+
+    cache_message(date, message);
+    return ([ ]) + message;
+}
+
+/*
+ * Function name: query_message_exists
+ * Description  : Find out whether there is a message with a certain time.
+ * Arguments    : int date - the time of the message.
+ * Returns      : int 1/0 - true if the message exists.
+ */
+public int
+query_message_exists(int date)
+{
+    return (mappingp(messages[date]) ||
+        pointerp(load_segment(MAIL_SEGMENT(date))[SEGMENT_MESSAGES][date]) ||
+        (file_size(FILE_NAME_MESSAGE(date, HASH_SIZE) + ".o") > 0));
+}
+
+/*
+ * Function name: delete_message
+ * Description  : Deletes a message. Call this when the last addressee
+ *                deleted the message from his/her mailbox.
+ * Arguments    : int date - the time of the message.
+ */
+public void
+delete_message(int date)
+{
+    int     segment = MAIL_SEGMENT(date);
+    mapping index;
+    mixed   entry;
+    int     live;
+
+    if (!valid_caller())
+    {
+        return;
+    }
+
+    uncache_message(date);
+    rm(FILE_NAME_MESSAGE(date, HASH_SIZE) + ".o");
+
+    index = load_segment(segment);
+    if (!pointerp(entry = index[SEGMENT_MESSAGES][date]))
+    {
+        return;
+    }
+
+    m_delkey(index[SEGMENT_MESSAGES], date);
+    index[SEGMENT_DEAD] += entry[SEG_LENGTH];
+    add_counter(STAT_MESSAGES, -1);
+    add_counter(STAT_RECIPIENTS, -sizeof(explode(entry[SEG_ADDRESS], ",")));
+    add_counter(STAT_BYTES, -entry[SEG_LENGTH]);
+    add_counter(STAT_DEAD, entry[SEG_LENGTH]);
+    stat_deletes++;
+
+    if (index[SEGMENT_DEAD] >= MIN_COMPACT_BYTES)
+    {
+        foreach(int when, mixed item: index[SEGMENT_MESSAGES])
+        {
+            live += item[SEG_LENGTH];
+        }
+
+        if (index[SEGMENT_DEAD] > live)
+        {
+            compact_segment(segment);
+        }
+    }
+
+    save_segment(segment);
+}
+
+/*
+ * Function name: save_message
+ * Description  : Saves an individual message. A new message is appended to
+ *                its segment. For an existing message only the addressees
+ *                are updated, as the rest of a message never changes.
+ *                A message without addressees is deleted.
+ * Arguments    : mapping message - the message.
+ *                int date - the time of the message.
+ * Returns      : int 1/0 - success/failure.
+ */
+public int
+save_message(mapping message, int date)
+{
+    int     segment = MAIL_SEGMENT(date);
+    string  data = FILE_NAME_SEGMENT_DATA(segment);
+    mapping index;
+    mixed   entry;
+    int     offset;
+
+    if (!valid_caller() ||
+        !mappingp(message))
+    {
+        return 0;
+    }
+
+    if (!strlen(message[MSG_ADDRESS]))
+    {
+        delete_message(date);
+        return 1;
+    }
+
+    index = load_segment(segment);
+    if (pointerp(entry = index[SEGMENT_MESSAGES][date]))
+    {
+        add_counter(STAT_RECIPIENTS,
+            sizeof(explode(message[MSG_ADDRESS], ",")) -
+            sizeof(explode(entry[SEG_ADDRESS], ",")));
+        entry[SEG_ADDRESS] = message[MSG_ADDRESS];
+    }
+    else
+    {
+        if ((offset = file_size(data)) < 0)
+        {
+            offset = 0;
+            add_counter(STAT_SEGMENTS, 1);
+        }
+
+        if (strlen(message[MSG_BODY]) &&
+            !write_file(data, message[MSG_BODY]))
+        {
+            return 0;
+        }
+
+        index[SEGMENT_MESSAGES][date] = ({ offset, strlen(message[MSG_BODY]),
+            message[MSG_TO], message[MSG_CC], message[MSG_ADDRESS] });
+        add_counter(STAT_MESSAGES, 1);
+        add_counter(STAT_RECIPIENTS,
+            sizeof(explode(message[MSG_ADDRESS], ",")));
+        add_counter(STAT_BYTES, strlen(message[MSG_BODY]));
+    }
+
+    save_segment(segment);
+    if (file_size(FILE_NAME_SEGMENT_INDEX(segment) + ".o") <= 0)
+    {
+        return 0;
+    }
+
+    /* The message now lives in its segment. */
+    rm(FILE_NAME_MESSAGE(date, HASH_SIZE) + ".o");
+
+    if (mappingp(messages[date]))
+    {
+        cache_message(date, ([ ]) + message);
+    }
+
+    stat_writes++;
+    return 1;
+}
+
+/*
+ * Function name: convert_message
+ * Description  : Moves a message in the old format into its segment.
+ * Arguments    : int date - the time of the message.
+ * Returns      : int 1/0 - converted/not converted.
+ */
+public int
+convert_message(int date)
+{
+    mapping message;
+
+    if ((previous_object() != find_object(SECURITY)) ||
+        !mappingp(message = restore_legacy(date)))
+    {
+        return 0;
+    }
+
+    /* The message was converted before. Only remove the old file. */
+    if (pointerp(load_segment(MAIL_SEGMENT(date))[SEGMENT_MESSAGES][date]))
+    {
+        rm(FILE_NAME_MESSAGE(date, HASH_SIZE) + ".o");
+        return 0;
+    }
+
+    return save_message(message, date);
+}
+
+/*
+ * Function name: set_converted
+ * Description  : Called from the master when all messages in the old format
+ *                have been converted.
+ */
+public void
+set_converted()
+{
+    if (previous_object() == find_object(SECURITY))
+    {
+        counters[STAT_CONVERTED] = time();
+        add_counter(STAT_CONVERTED, 0);
+    }
+}
+
+/*
+ * Function name: query_converted
+ * Description  : Find out when all messages were converted.
+ * Returns      : int - the time of the conversion, or 0.
+ */
+public int
+query_converted()
+{
+    return counters[STAT_CONVERTED];
+}
+
+/*
+ * Function name: query_segments
+ * Description  : Returns the numbers of all segments with messages.
+ * Returns      : int * - the segment numbers, sorted.
+ */
+public int *
+query_segments()
+{
+    return sort_array(map(get_dir(MSG_DIR + "i*.o"),
+        &atoi() @ &extract(, 1, -3)) - ({ 0 }));
+}
+
+/*
+ * Function name: query_segment_messages
+ * Description  : Returns the times of the messages in a segment.
+ * Arguments    : int segment - the number of the segment.
+ * Returns      : int * - the times of the messages.
+ */
+public int *
+query_segment_messages(int segment)
+{
+    if (!valid_caller())
+    {
+        return ({ });
+    }
+
+    return m_indexes(load_segment(segment)[SEGMENT_MESSAGES]);
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the counters of the store.
+ * Returns      : mapping - the counters, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    return ([
+        "messages"     : counters[STAT_MESSAGES],
+        "recipients"   : counters[STAT_RECIPIENTS],
+        "bytes"        : counters[STAT_BYTES],
+        "dead"         : counters[STAT_DEAD],
+        "segments"     : counters[STAT_SEGMENTS],
+        "converted"    : counters[STAT_CONVERTED],
+        "cached"       : m_sizeof(messages),
+        "loaded"       : m_sizeof(segments),
+        "reads"        : stat_reads,
+        "hits"         : stat_hits,
+        "legacy"       : stat_legacy,
+        "writes"       : stat_writes,
+        "deletes"      : stat_deletes,
+        "compactions"  : stat_compactions,
+        "since"        : stat_start,
+        ]);
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Gives the state of the store when a wizard stats it.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    mapping stats = query_stats();
+
+    return sprintf("Mail store since %s\n", ctime(stats["since"])) +
+        sprintf("Messages   : %8d    Recipients : %d\n", stats["messages"],
+            stats["recipients"]) +
+        sprintf("Segments   : %8d    Loaded     : %d\n", stats["segments"],
+            stats["loaded"]) +
+        sprintf("Bytes      : %8d    Unused     : %d\n", stats["bytes"],
+            stats["dead"]) +
+        sprintf("Reads      : %8d    Cache hits : %d (%d cached)\n",
+            stats["reads"], stats["hits"], stats["cached"]) +
+        sprintf("Writes     : %8d    Deletes    : %d    Old format : %d\n",
+            stats["writes"], stats["deletes"], stats["legacy"]) +
+        sprintf("Compactions: %8d    Converted  : %s\n", stats["compactions"],
+            (stats["converted"] ? ctime(stats["converted"]) : "no"));
+}
@@ -47,6 +47,17 @@
 #define DEBUG_BLOCKED    ( ({ }) )
 #define RESET_TIME (900.0) /* 15 minutes */
 
+/* The deferred preload files are loaded this many per alarm. */
+#define DEFERRED_CHUNK (5)
+#define DEFERRED_DELAY (1.0)
+
+/* The maximum number of file access decisions kept in the cache. */
+#define ACCESS_CACHE_SIZE (5000)
+
+/* Indices into the boot times. */
+#define BOOT_COST     (0)
+#define BOOT_DEFERRED (1)
+
 /* All prototypes have been placed in /secure/master.h */
 #include "/secure/master.h"
 
@@ -80,6 +91,27 @@ private static string  udp_manager;
 private static int     uptime_limit;
 private static string  mudlib_version;
 private static int     game_start_time;
+private static int     boot_start;
+private static int     boot_end;
+private static mapping boot_times = ([ ]);
+private static string  *boot_deferred = ({ });
+
+/*
+ * The cache of file access decisions. Decisions are kept per euid and
+ * directory, for reading ("r") and writing ("w") apart. The value is 1 for
+ * allowed and -1 for disallowed. access_paths tells whether a domain or
+ * wizard has given out path sanctions, as those may apply to a single file.
+ *
+ * access_cache = ([ (string) euid : ([ (string) op + dir : 1 / -1 ]) ])
+ * access_paths = ([ (string) giver : 1 / -1 ])
+ */
+private static mapping access_cache = ([ ]);
+private static mapping access_paths = ([ ]);
+private static int     access_size;
+private static int     access_hits;
+private static int     access_misses;
+private static int     access_forgets;
+private static int     access_flushes;
 
 /*
  * Function name: create
@@ -478,50 +510,222 @@ valid_seteuid(object ob, string str)
 }
 
 /*
- * Function name: valid_write
- * Description  : Checks whether a certain user has the right to write a
- *                particular file.
- * Arguments    : string path  - the path name of the file to be write.
- *                mixed writer - the name or object of the writer.
- *                string func  - the calling function.
- * Returns      : int 1/0 - allowed/disallowed.
+ * Function name: access_key
+ * Description  : Finds the index of a file access decision in the cache.
+ *                Only decisions that are the same for all files in a
+ *                directory are cached. That excludes files too close to
+ *                the top of a domain or wizard directory, the team and
+ *                restrictlog directories, and domains or wizards that have
+ *                given out path sanctions.
+ * Arguments    : string *dirs - the parts of the path of the file.
+ *                string op - "r" for reading or "w" for writing.
+ * Returns      : string - the index, or 0 if the decision is not cached.
  */
-int
-valid_write(string file, mixed writer, string func)
+static string
+access_key(string *dirs, string op)
 {
-    string *dirs, *wpath;
-    string dname;
-    string wname;
-    string subdir;
-    string dir;
-    int size;
+    int size = sizeof(dirs);
 
-    if (objectp(writer))
+    switch(dirs[0])
     {
-	wpath = explode(file_name(writer), "/") - ({ "" });
-        writer = geteuid(writer);
+    case "d":
+        if ((size < 5) ||
+            ((dirs[1] == BASE_DOMAIN) && (dirs[2] == "ateam")) ||
+            ((size < 6) && (dirs[3] == "restrictlog")))
+        {
+            return 0;
+        }
+        break;
+
+    case "w":
+        if (size < 5)
+        {
+            return 0;
+        }
+        break;
+
+    case "syslog":
+        if (size < 4)
+        {
+            return 0;
+        }
+        break;
+
+    default:
+        return 0;
     }
 
-    /* Root may do as he please. */
-    if (writer == ROOT_UID)
+    if (!access_paths[dirs[1]])
     {
-        return 1;
+        access_paths[dirs[1]] = (has_path_sanctions(dirs[1]) ? 1 : -1);
+    }
+    if (access_paths[dirs[1]] > 0)
+    {
+        return 0;
     }
 
-    /* Keepers and arches may do as they please. */
-    if (query_wiz_rank(writer) >= WIZ_ARCH)
+    return op + implode(dirs[..-2], "/");
+}
+
+/*
+ * Function name: cache_access
+ * Description  : Adds a file access decision to the cache. When the cache
+ *                is full, it is emptied.
+ * Arguments    : string euid - the euid that wants access.
+ *                string key - the index, see access_key().
+ *                int result - 1/0 - allowed/disallowed.
+ * Returns      : int - the result.
+ */
+static int
+cache_access(string euid, string key, int result)
+{
+    if (++access_size > ACCESS_CACHE_SIZE)
     {
-        return 1;
+        access_cache = ([ ]);
+        access_size = 1;
+        access_flushes++;
     }
 
-    /* Anonymous objects cannot do anything. */
-    if (!strlen(writer))
+    if (!mappingp(access_cache[euid]))
     {
-        return 0;
+        access_cache[euid] = ([ ]);
     }
+    access_cache[euid][key] = (result ? 1 : -1);
 
-    dirs = explode(file, "/") - ({ "" });
-    size = sizeof(dirs);
+    return result;
+}
+
+/*
+ * Function name: forget_access
+ * Description  : Removes file access decisions from the cache when the
+ *                rights of someone change. Without arguments, the whole
+ *                cache is emptied.
+ * Arguments    : string euid - forget the decisions for this euid.
+ *                string path - forget the decisions for all files below
+ *                    this path, e.g. "d/Domain" or "w/wizard".
+ */
+static varargs void
+forget_access(string euid, string path)
+{
+    int len;
+
+    access_forgets++;
+
+    if (!stringp(euid) && !stringp(path))
+    {
+        access_cache = ([ ]);
+        access_paths = ([ ]);
+        access_size = 0;
+        return;
+    }
+
+    if (mappingp(access_cache[euid]))
+    {
+        access_size -= m_sizeof(access_cache[euid]);
+        m_delkey(access_cache, euid);
+    }
+
+    if (!strlen(path))
+    {
+        return;
+    }
+
+    len = strlen(path);
+    foreach(string name, mapping keys: access_cache)
+    {
+        foreach(string key: m_indices(keys))
+        {
+            if ((key[1..len] == path) &&
+                ((strlen(key) == (len + 1)) || (key[len + 1] == '/')))
+            {
+                m_delkey(keys, key);
+                access_size--;
+            }
+        }
+    }
+}
+
+/*
+ * Function name: forget_sanction_access
+ * Description  : Removes the file access decisions that depend on the
+ *                sanctions of a domain or wizard.
+ * Arguments    : string giver - the domain or wizard giving sanctions.
+ */
+static void
+forget_sanction_access(string giver)
+{
+    m_delkey(access_paths, giver);
+    forget_access(0, "d/" + giver);
+    forget_access(0, "w/" + giver);
+}
+
+/*
+ * Function name: forget_domain_access
+ * Description  : Removes the file access decisions of the Lord and steward
+ *                of a domain, as they depend on who holds those offices.
+ * Arguments    : string dname - the domain.
+ */
+static void
+forget_domain_access(string dname)
+{
+    if (!strlen(dname) ||
+        !sizeof(m_domains[dname]))
+    {
+        return;
+    }
+
+    forget_access(m_domains[dname][FOB_DOM_LORD]);
+    forget_access(m_domains[dname][FOB_DOM_STEWARD]);
+}
+
+/*
+ * Function name: query_access_stats
+ * Description  : Returns the statistics of the file access cache. It may
+ *                only be called from the arch soul.
+ * Arguments    : int clear - if true, also empty the cache.
+ * Returns      : mapping - the statistics, indexed by name.
+ */
+public varargs mapping
+query_access_stats(int clear)
+{
+    if (!CALL_BY(WIZ_CMD_ARCH))
+    {
+        return ([ ]);
+    }
+
+    if (clear)
+    {
+        forget_access();
+    }
+
+    return ([
+        "entries" : access_size,
+        "euids"   : m_sizeof(access_cache),
+        "hits"    : access_hits,
+        "misses"  : access_misses,
+        "forgets" : access_forgets,
+        "flushes" : access_flushes,
+        ]);
+}
+
+/*
+ * Function name: write_access
+ * Description  : Decides whether someone may write a file. Called from
+ *                valid_write().
+ * Arguments    : string *dirs - the parts of the path of the file.
+ *                string writer - the euid of the writer.
+ *                string *wpath - the parts of the filename of the writer,
+ *                    if it is an object.
+ * Returns      : int 1/0 - allowed/disallowed.
+ */
+static int
+write_access(string *dirs, string writer, string *wpath)
+{
+    string dname;
+    string wname;
+    string subdir;
+    string dir;
+    int size = sizeof(dirs);
 
     switch(dirs[0])
     {
@@ -673,56 +877,81 @@ valid_write(string file, mixed writer, string func)
 }
 
 /*
- * Function name: valid_read
- * Description  : Checks if a certain user has the right to read a file.
- * Arguments    : string path  - path name of the file to be read.
- *                mixed reader - the object or name of the reader.
+ * Function name: valid_write
+ * Description  : Checks whether a certain user has the right to write a
+ *                particular file.
+ * Arguments    : string path  - the path name of the file to be write.
+ *                mixed writer - the name or object of the writer.
  *                string func  - the calling function.
  * Returns      : int 1/0 - allowed/disallowed.
  */
 int
-valid_read(string file, mixed reader, string func)
+valid_write(string file, mixed writer, string func)
 {
-    string *dirs, *rpath;
-    string dname;
-    string wname;
-    string subdir;
-    string dir;
-    int size;
-
-    /* Everyone is allowed to see the time or size of a file. */
-    if ((func == "file_time") ||
-        (func == "file_size"))
-    {
-        return 1;
-    }
+    string *dirs, *wpath;
+    string key;
+    int result;
 
-    if (objectp(reader))
+    if (objectp(writer))
     {
-        rpath = explode(file_name(reader), "/") - ({ "" });
-        reader = geteuid(reader);
+	wpath = explode(file_name(writer), "/") - ({ "" });
+        writer = geteuid(writer);
     }
 
-    /* Allow read in / */
-    if (file == "/")
+    /* Root may do as he please. */
+    if (writer == ROOT_UID)
     {
         return 1;
     }
 
-    /* Root and archwizards and keepers may do as they please. */
-    if ((reader == ROOT_UID) || (query_wiz_rank(reader) >= WIZ_ARCH))
+    /* Keepers and arches may do as they please. */
+    if (query_wiz_rank(writer) >= WIZ_ARCH)
     {
         return 1;
     }
 
     /* Anonymous objects cannot do anything. */
-    if (!stringp(reader) || !strlen(reader))
+    if (!strlen(writer))
     {
         return 0;
     }
 
     dirs = explode(file, "/") - ({ "" });
-    size = sizeof(dirs);
+
+    /* See whether we made this decision before. */
+    if (!stringp(key = access_key(dirs, "w")))
+    {
+        return write_access(dirs, writer, wpath);
+    }
+    if (mappingp(access_cache[writer]) &&
+        (result = access_cache[writer][key]))
+    {
+        access_hits++;
+        return (result > 0);
+    }
+
+    access_misses++;
+    return cache_access(writer, key, write_access(dirs, writer, wpath));
+}
+
+/*
+ * Function name: read_access
+ * Description  : Decides whether someone may read a file. Called from
+ *                valid_read().
+ * Arguments    : string *dirs - the parts of the path of the file.
+ *                string reader - the euid of the reader.
+ *                string *rpath - the parts of the filename of the reader,
+ *                    if it is an object.
+ * Returns      : int 1/0 - allowed/disallowed.
+ */
+static int
+read_access(string *dirs, string reader, string *rpath)
+{
+    string dname;
+    string wname;
+    string subdir;
+    string dir;
+    int size = sizeof(dirs);
 
     switch(dirs[0])
     {
@@ -936,6 +1165,70 @@ valid_read(string file, mixed reader, string func)
     return 0;
 }
 
+/*
+ * Function name: valid_read
+ * Description  : Checks if a certain user has the right to read a file.
+ * Arguments    : string path  - path name of the file to be read.
+ *                mixed reader - the object or name of the reader.
+ *                string func  - the calling function.
+ * Returns      : int 1/0 - allowed/disallowed.
+ */
+int
+valid_read(string file, mixed reader, string func)
+{
+    string *dirs, *rpath;
+    string key;
+    int result;
+
+    /* Everyone is allowed to see the time or size of a file. */
+    if ((func == "file_time") ||
+        (func == "file_size"))
+    {
+        return 1;
+    }
+
+    if (objectp(reader))
+    {
+        rpath = explode(file_name(reader), "/") - ({ "" });
+        reader = geteuid(reader);
+    }
+
+    /* Allow read in / */
+    if (file == "/")
+    {
+        return 1;
+    }
+
+    /* Root and archwizards and keepers may do as they please. */
+    if ((reader == ROOT_UID) || (query_wiz_rank(reader) >= WIZ_ARCH))
+    {
+        return 1;
+    }
+
+    /* Anonymous objects cannot do anything. */
+    if (!stringp(reader) || !strlen(reader))
+    {
+        return 0;
+    }
+
+    dirs = explode(file, "/") - ({ "" });
+
+    /* See whether we made this decision before. */
+    if (!stringp(key = access_key(dirs, "r")))
+    {
+        return read_access(dirs, reader, rpath);
+    }
+    if (mappingp(access_cache[reader]) &&
+        (result = access_cache[reader][key]))
+    {
+        access_hits++;
+        return (result > 0);
+    }
+
+    access_misses++;
+    return cache_access(reader, key, read_access(dirs, reader, rpath));
+}
+
 #if 0
 /*
  * Function name: valid_move
@@ -1498,13 +1791,17 @@ load_domain_link(string file)
 static string *
 start_boot(int no_preload)
 {
-    string *prefiles, *links;
+    string *prefiles = ({ }), *links, *linked = ({ }), *ordered = ({ });
+    mapping depends = ([ ]), state = ([ ]);
     object simf;
     int size;
 
     if (game_started)
         return 0;
 
+    boot_start = time();
+    boot_end = 0;
+
     set_auth(this_object(), "root:root");
 
     /* Fix the userids of the simul_efun object */
@@ -1535,6 +1832,8 @@ start_boot(int no_preload)
 
     /* Initialise the siteban structure. */
     init_sitebans();
+    /* Read the sanctions into memory. */
+    init_sanctions();
     /* Initialise the player info (seconds). */
     init_player_info();
     /* Remove orphan mail files from the website. */
@@ -1582,23 +1881,107 @@ start_boot(int no_preload)
     size = sizeof(links);
     while (size--)
     {
-        prefiles += links[size]->query_preload();
+        linked += map(links[size]->query_preload(), fix_preload_name);
+        boot_deferred += map(links[size]->query_preload_deferred(),
+            fix_preload_name);
+        foreach(string file, string *after:
+            links[size]->query_preload_depends())
+        {
+            file = fix_preload_name(file);
+            depends[file] = (pointerp(depends[file]) ? depends[file] : ({ })) +
+                map(after, fix_preload_name);
+        }
     }
 
-    return prefiles;
+    /* The files named first are loaded in the order given. Of the files of
+     * the domains, the files they depend on are loaded first.
+     */
+    prefiles = filter(map(prefiles, fix_preload_name), strlen);
+    foreach(string file: prefiles)
+    {
+        state[file] = 2;
+    }
+    foreach(string file: linked)
+    {
+        ordered = order_preload(file, depends, state, ordered);
+    }
+    boot_deferred -= prefiles + ordered;
 
+    return prefiles + ordered;
+}
+
+/*
+ * Function name: fix_preload_name
+ * Description  : Makes the name of a preload file into the form we use,
+ *                with a leading slash and without ".c".
+ * Arguments    : string file - the file.
+ * Returns      : string - the fixed name.
+ */
+static string
+fix_preload_name(string file)
+{
+    if (!strlen(file))
+    {
+        return "";
+    }
+    if (file[0] != '/')
+    {
+        file = "/" + file;
+    }
+    if (file[-2..] == ".c")
+    {
+        file = file[..-3];
+    }
+
+    return file;
+}
+
+/*
+ * Function name: order_preload
+ * Description  : Adds a file to the preload order, after the files it
+ *                depends on. When the dependencies form a loop, the loop is
+ *                broken at the file we met first.
+ * Arguments    : string file - the file to add.
+ *                mapping depends - ([ file : ({ files to load first }) ])
+ *                mapping state - ([ file : 1 (busy) or 2 (ordered) ])
+ *                string *order - the order so far.
+ * Returns      : string * - the new order.
+ */
+static string *
+order_preload(string file, mapping depends, mapping state, string *order)
+{
+    if (!strlen(file) || state[file])
+    {
+        return order;
+    }
+
+    state[file] = 1;
+    if (pointerp(depends[file]))
+    {
+        foreach(string after: depends[file])
+        {
+            order = order_preload(after, depends, state, order);
+        }
+    }
+    state[file] = 2;
+
+    return order + ({ file });
 }
 
 /*
  * Function name: preload_boot
  * Description  : Called at game start time for every file that needs to be
- *                preloaded to load it into memory.
+ *                preloaded to load it into memory. The evaluation cost of
+ *                each load is kept for the boot report. The clock of the
+ *                driver only advances once per heartbeat, so it cannot
+ *                tell the files apart.
  * Arguments    : string file - the file to preload (without ".c" suffix).
  */
 static void
 preload_boot(string file)
 {
     string err, creator;
+    int    cost = debug("get_eval_cost");
 
     if (file_size(file + ".c") == -1)
     {
@@ -1611,15 +1994,125 @@ preload_boot(string file)
     if (err = (string)LOAD_ERR(file))
     {
         write("\tCan not load: " + file + ":\n     " + err + "\n");
+        return;
     }
-    else
+
+    write("\tPreloading: " + file + ".c  (" + creator + ")\n");
+    if (strlen(err = catch(file->teleledningsanka())))
     {
-        write("\tPreloading: " + file + ".c  (" + creator + ")\n");
-        if (strlen(file = catch(file->teleledningsanka())))
+        write("\tError: " + file + ".c\n");
+    }
+
+    boot_times[file] = ({ abs(debug("get_eval_cost") - cost),
+        (boot_end > 0) });
+}
+
+/*
+ * Function name: query_boot_report
+ * Description  : Describes where the evaluation cost went when the game
+ *                was booted: the totals per tier and per domain, and the
+ *                files that were most expensive to load.
+ * Returns      : string - the report.
+ */
+public string
+query_boot_report()
+{
+    mapping domains = ([ ]);
+    mixed  *files;
+    string  report, creator;
+    int     critical, deferred, num_critical, num_deferred;
+
+    foreach(string file, mixed times: boot_times)
+    {
+        if (times[BOOT_DEFERRED])
+        {
+            deferred += times[BOOT_COST];
+            num_deferred++;
+        }
+        else
+        {
+            critical += times[BOOT_COST];
+            num_critical++;
+        }
+
+        creator = creator_file(file);
+        if (!pointerp(domains[creator]))
         {
-            write("\tError: " + file + ".c\n");
+            domains[creator] = ({ 0, 0 });
         }
+        domains[creator][BOOT_COST] += times[BOOT_COST];
+        domains[creator][1]++;
     }
+
+    report = sprintf("Boot report of %s", ctime(game_start_time)) +
+        sprintf("Until final boot : %8d seconds\n",
+            ((boot_end > boot_start) ? (boot_end - boot_start) : 0)) +
+        sprintf("Preloaded        : %8d cost in %d files\n", critical,
+            num_critical) +
+        sprintf("Deferred         : %8d cost in %d files, %d waiting\n",
+            deferred, num_deferred, sizeof(boot_deferred));
+
+    report += sprintf("\n%10s %6s  %s\n", "Cost", "Files", "Domain");
+    files = sort_array(m_indexes(domains), &boot_sort(domains));
+    foreach(string domain: files)
+    {
+        report += sprintf("%10d %6d  %s\n", domains[domain][BOOT_COST],
+            domains[domain][1], domain);
+    }
+
+    report += sprintf("\n%10s %1s  %s\n", "Cost", "D", "File");
+    files = sort_array(m_indexes(boot_times), &boot_sort(boot_times));
+    foreach(string file: files[..19])
+    {
+        report += sprintf("%10d %1s  %s\n", boot_times[file][BOOT_COST],
+            (boot_times[file][BOOT_DEFERRED] ? "*" : " "), file);
+    }
+
+    return report;
+}
+
+/*
+ * Function name: boot_sort
+ * Description  : Sorts the entries of the boot report, the most expensive
+ *                first.
+ * Arguments    : mapping times - the costs, with the cost at BOOT_COST.
+ *                string a, b - the entries to compare.
+ * Returns      : int - -1, 0 or 1.
+ */
+static int
+boot_sort(mapping times, string a, string b)
+{
+    int diff = times[b][BOOT_COST] - times[a][BOOT_COST];
+
+    return ((diff > 0) ? 1 : ((diff < 0) ? -1 : 0));
+}
+
+/*
+ * Function name: preload_deferred
+ * Description  : Loads the next few files of the deferred preload tier.
+ *                When they are all loaded, the boot report is logged.
+ */
+static void
+preload_deferred()
+{
+    string *files = boot_deferred[..(DEFERRED_CHUNK - 1)];
+
+    boot_deferred = boot_deferred[DEFERRED_CHUNK..];
+    foreach(string file: files)
+    {
+        preload_boot(file);
+    }
+    set_auth(this_object(), "root:root");
+
+    if (sizeof(boot_deferred))
+    {
+        set_alarm(DEFERRED_DELAY, 0.0, preload_deferred);
+        return;
+    }
+
+#ifdef LOG_BOOT
+    log_file(LOG_BOOT, query_boot_report() + "\n");
+#endif LOG_BOOT
 }
 
 /*
@@ -1654,6 +2147,12 @@ final_boot()
     /* Tell the graph we rebooted. */
     mark_graph_reboot();
 
+    /* The players may log in now. Load the rest in the background. */
+    boot_end = time();
+    write(sprintf("Preloaded %d files in %d seconds, %d deferred.\n",
+        m_sizeof(boot_times), (boot_end - boot_start), sizeof(boot_deferred)));
+    set_alarm(DEFERRED_DELAY, 0.0, preload_deferred);
+
 #ifdef UDP_ENABLED
 #ifdef UDP_MANAGER
     udp_manager = UDP_MANAGER;
@@ -1944,6 +2443,7 @@ loaded_object(object lob, object ob)
 {
     string creator = creator_object(ob);
     string *auth = explode(query_auth(lob), ":");
+    object telemetry;
 
     if (!strlen(creator))
     {
@@ -1961,6 +2461,12 @@ loaded_object(object lob, object ob)
         return;
     }
 
+    /* Tell the telemetry about the program, if it runs. */
+    if (objectp(telemetry = find_object(TELEMETRY)))
+    {
+        telemetry->loaded_program(ob);
+    }
+
     if ((creator == BACKBONE_UID) ||
         (creator == auth[0]))
     {
@@ -2114,10 +2620,18 @@ query_command_substitute(string cmd)
 nomask public int
 query_memory_percentage()
 {
-    string data = SECURITY->do_debug("malloc");
-    string *rows = explode(data, "\n");
+    string data;
+    string *rows;
     int used = 0;
 
+    /* The telemetry samples the heap regularly. */
+    if (!catch(used = TELEMETRY->query_heap_size()) && (used > 0))
+    {
+        return (used / (memory_limit / 100));
+    }
+
+    data = SECURITY->do_debug("malloc");
+    rows = explode(data, "\n");
     if (data[0] == '<' && sizeof(rows) >= 5) {
         /* This might not be reliable across systems. We'll see */
         sscanf(rows[-5], "<system type=\"current\" size=\"%d\"/>", used);
@@ -3208,6 +3722,11 @@ save_player()
     export_uid(pobj);
     res = (int)pobj->save_player(pobj->query_real_name());
     pobj->open_player();
+    if (res)
+    {
+        catch(AUTOSAVE_SCHEDULER->saved_player(pobj,
+            file_size(PLAYER_FILE(pobj->query_real_name()) + ".o")));
+    }
     set_auth(this_object(), "#:" + (pobj->query_wiz_level() ?
         pobj->query_real_name() : BACKBONE_UID));
     export_uid(pobj);
@@ -3671,6 +4190,9 @@ master_shutdown(string reason)
     log_file(LOG_SHUTDOWN, ctime(time()) + " " + reason, -1);
 #endif LOG_SHUTDOWN
 
+    /* Write the logs that are still buffered. */
+    catch(LOG_CENTRAL->flush_all());
+
     /* This MUST be a this_object()->
      * If it is removed the game wont go down, so hands off!
      */
@@ -4074,12 +4596,21 @@ public void
 check_memory(int dodecay)
 {
     int uptime;
+    int minutes;
 
     /* Is the game too big? */
     if (query_memory_percentage() >= 100)
     {
         memory_failure();
     }
+    /* Warn the wizards when the memory will run out within the hour. */
+    else if (!catch(minutes = TELEMETRY->query_minutes_to(memory_limit)) &&
+        (minutes >= 0) && (minutes < 60))
+    {
+        filter(users(), &->query_wiz_level())->catch_tell("@ Armageddon: " +
+            "At this rate the memory is used up in " + minutes +
+            " minutes. See " + TELEMETRY + " for the leak suspects.\n");
+    }
 
     uptime = time() - query_start_time();
 #ifdef REGULAR_REBOOT
@@ -22,6 +22,12 @@ int valid_read(string file, mixed reader, string func);
 int valid_write(string file, mixed writer, string func);
 int exist_player(string pl_name);
 public int query_start_time();
+static varargs void forget_access(string euid, string path);
+static void forget_sanction_access(string giver);
+static void forget_domain_access(string dname);
+static string fix_preload_name(string file);
+static string *order_preload(string file, mapping depends, mapping state,
+    string *order);
 
 /*
  * /secure/master/fob.c
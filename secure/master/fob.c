@@ -450,6 +450,7 @@ make_domain(string dname, string sname, string wname)
     /* Add the domain entry to the domain mepping. */
     m_domains[dname] =
         ({ dom_count++, sname, wname, "", ({ }), DOMAIN_MAX, 0, 0, 0 });
+    forget_access(dname, "d/" + dname);
 
     /* Make the apprentice a lord. This will also save the domain mapping. */
     add_wizard_to_domain(dname, wname, cmder);
@@ -531,6 +532,7 @@ remove_domain(string dname)
 
     /* Delete the domain from the domain mapping. */
     m_delkey(m_domains, dname);
+    forget_access(dname, "d/" + dname);
     save_master();
 
     write("You have just obliterated " + dname + ".\n");
@@ -680,6 +682,9 @@ add_wizard_to_domain(string dname, string wname, string cmder)
     m_wizards[wname][FOB_WIZ_DOM] = dname;
     m_wizards[wname][FOB_WIZ_CHDOM] = cmder;
 
+    /* The file access of the wizard and to the wizard changes. */
+    forget_access(wname, "w/" + wname);
+
 
     /* If the person leaves an old domain, update the membership and tell
      * the people.
@@ -923,7 +928,10 @@ rename_wizard(string oldname, string newname)
 {
     string dname = m_wizards[oldname][FOB_WIZ_DOM];
 
-    /* Rename the wizard in the wizard mapping. */
+    /* Rename the wizard in the wizard mapping. The file access of many
+     * may change, so forget it all.
+     */
+    forget_access();
     write("Wizard status copied to " + capitalize(newname) + ".\n");
     m_wizards[newname] = secure_var(m_wizards[oldname]);
     m_delkey(m_wizards, oldname);
@@ -1068,6 +1076,8 @@ lordship(string wname, string dname)
             " to " + capitalize(wname) + ".\n");
     }
 
+    forget_access(wname);
+    forget_domain_access(dname);
     save_master();
 
     /* Log the assignment. */
@@ -2089,6 +2099,12 @@ do_change_rank(string wname, int rank, string cmder)
         capitalize(cmder)));
 
     int old_rank = m_wizards[wname][FOB_WIZ_RANK];
+
+    /* The file access of the wizard changes, and when the Lord or steward
+     * of the domain changes, so does that of the other of the two.
+     */
+    forget_access(wname);
+    forget_domain_access(m_wizards[wname][FOB_WIZ_DOM]);
     /* If the person was Lord over any domain, inform them. */
     if (old_rank >= WIZ_LORD)
     {
@@ -2106,6 +2122,7 @@ do_change_rank(string wname, int rank, string cmder)
                     dom + ".\n"));
 
             data[FOB_DOM_LORD] = "";
+            forget_access(data[FOB_DOM_STEWARD]);
             if (m_wizards[wname][FOB_WIZ_DOM] != dom)
                 data[FOB_DOM_MEMBERS] -= ({ wname });
         }
@@ -2732,6 +2749,7 @@ add_global_read(string wname, string comment)
 
     /* Add the stuff, save the master and tell the caller. */
     m_global_read[wname] = ({ cmder, comment });
+    forget_access(wname);
     save_master();
 
     if (objectp(wiz = find_player(wname)))
@@ -2770,6 +2788,7 @@ remove_global_read(string wname)
 
     /* Remove the entry, save the master and notify the caller. */
     m_delkey(m_global_read, wname);
+    forget_access(wname);
     save_master();
 
     if (objectp(wiz = find_player(wname)))
@@ -2917,6 +2936,7 @@ add_student(string mentor, string student)
         return 0;
 
     m_wizards[mentor][FOB_WIZ_STUDENTS] += ({ student });
+    forget_access(mentor);
     save_master();
     return 1;
 }
@@ -2941,6 +2961,7 @@ remove_student(string mentor, string student)
 
     /* It doesn't matter if he's in the list or not. */
     m_wizards[mentor][FOB_WIZ_STUDENTS] -= ({ student });
+    forget_access(mentor);
     save_master();
     return 1;
 }
@@ -2991,6 +3012,7 @@ set_restrict(string wiz, int res)
         return 0;
 
     m_wizards[wiz][FOB_WIZ_RESTRICT] |= res;
+    forget_access(wiz);
     save_master();
 
     return 1;
@@ -3013,6 +3035,7 @@ remove_restrict(string wiz, int res)
         return 0;
 
     m_wizards[wiz][FOB_WIZ_RESTRICT] ^= res;
+    forget_access(wiz);
     save_master();
 
     return 1;
@@ -3053,6 +3076,7 @@ update_teams()
             if (!m_wizards[wname] || m_wizards[wname][FOB_WIZ_RANK] < WIZ_NORMAL)
             {
                 m_teams[team][FOB_TEAM_MEMBERS] -= ({ wname });
+                forget_access(wname);
 
                 if (m_teams[team][FOB_TEAM_LEADER] == wname)
                 {
@@ -3102,6 +3126,7 @@ add_team_member(string team, string member)
     else
         m_teams[team][FOB_TEAM_MEMBERS] |= ({ member });
 
+    forget_access(member);
     save_master();
 
     log_file("TEAMS",
@@ -3134,6 +3159,7 @@ remove_team_member(string team, string member)
             return 0;
 
         m_teams[team][FOB_TEAM_MEMBERS] -= ({ member });
+        forget_access(member);
 
         if (m_teams[team][FOB_TEAM_LEADER] == member)
             m_teams[team][FOB_TEAM_LEADER] = 0;
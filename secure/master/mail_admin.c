@@ -12,10 +12,13 @@
  *
  * The following subcommands are supported:
  * - export a the mail-folder of a player to file;
+ * - convert the message-files in the old format into the mail store;
  * - print statistics about the mail system;
  * - purge all mailboxes and message-files that have reference to players
  *   that do not exist any longer, then purge all message-files that are
  *   not pointed at by any mail folder.
+ *
+ * The messages themselves are kept by the mail store, MAIL_STORE.
  */
 
 #include "/sys/composite.h"
@@ -24,12 +27,12 @@
 #include "/sys/std.h"
 
 #define DIR_NAME_MESSAGE(dir)  (MSG_DIR + "d" + (dir))
-#define MESSAGE_FILENAME(d, m) (DIR_NAME_MESSAGE(d) + "/" + (m))
 
 #define STATISTICS_FILE   ("/syslog/log/MAILBOX_STATS")
 #define MAX_MAILBOX_STATS (100)
 #define MAX_MAILBOX_PURGE (100)
 #define MAX_MESSAGE_PURGE (100)
+#define MAX_MESSAGE_CONVERT (100)
 #define LINE_LENGTH       ( 77)
 #define SPACES ("                                 ")
 
@@ -83,7 +86,7 @@ save_mail(mapping mail, string name)
 
 /*
  * Function name: restore_message
- * Description  : Restore an individual message from disk.
+ * Description  : Restore an individual message from the mail store.
  * Arguments    : int number - the time of the message.
  * Returns      : mapping  - the message restored.
  */
@@ -92,7 +95,7 @@ restore_message(int number)
 {
     mapping message;
 
-    message = restore_map(FILE_NAME_MESSAGE(number, HASH_SIZE));
+    message = MAIL_STORE->restore_message(number);
 
     if (!mappingp(message) ||
 	(m_sizeof(message) != M_SIZEOF_MSG))
@@ -105,14 +108,14 @@ restore_message(int number)
 
 /*
  * Function name: save_message
- * Description  : Save the individual message to disk.
+ * Description  : Save the individual message in the mail store.
  * Arguments    : mapping message - the message.
  *                int     number  - the current time to save.
  */
 static void
 save_message(mapping message, int number)
 {
-    save_map(message, FILE_NAME_MESSAGE(number, HASH_SIZE));
+    MAIL_STORE->save_message(message, number);
 }
 
 /*
@@ -256,30 +259,21 @@ export_mail(string name, string path)
  * Description  : Checks this message. It checks the validity of the names
  *                of all recipients and checks whether the message is still
  *                referenced from the mailboxes.
- * Arguments    : int dir     - the directory currently checked.
- *                string file - the filename of the message to check.
+ * Arguments    : int date - the time of the message to check.
  * Returns      : int 1/0 - purged/not purged.
  */
 static int
-purge_one_message(int dir, string file)
+purge_one_message(int date)
 {
     mapping message;
-    int     date;
     string *names;
     int    touched;
 
-    /* Extract the date from the filename. */
-    if (sscanf(file, "m%d.o", date) != 1)
-    {
-        rm(MESSAGE_FILENAME(dir, file));
-        return 1;
-    }
-
     /* Restore the message. */
     catch(message = restore_message(date));
     if (!mappingp(message))
     {
-        rm(MESSAGE_FILENAME(dir, file));
+        MAIL_STORE->delete_message(date);
         return 1;
     }
 
@@ -309,7 +303,7 @@ purge_one_message(int dir, string file)
     /* No names are left, purge the message. */
     if (!sizeof(names))
     {
-        rm(MESSAGE_FILENAME(dir, file));
+        MAIL_STORE->delete_message(date);
         return 1;
     }
 
@@ -326,51 +320,50 @@ purge_one_message(int dir, string file)
 
 /*
  * Function name: purge_check_messages
- * Description  : This will loop over a batch of message files and then
- *                continues with the next directory.
- * Arguments    : int dir       - the directory number we are working on.
+ * Description  : This will loop over a batch of messages and then
+ *                continues with the next segment of the mail store.
+ * Arguments    : int *segments - the segments left to check.
  *                int messages  - amount of messages found so far.
  *                int purged    - amount of messages purged so far.
- *                string *files - the names of the files left in this dir.
+ *                int *dates    - the messages left in this segment.
  */
 static void
-purge_check_messages(int dir, int messages, int purged, string *files)
+purge_check_messages(int *segments, int messages, int purged, int *dates)
 {
-    int size = min(sizeof(files), MAX_MESSAGE_PURGE);
+    int size = min(sizeof(dates), MAX_MESSAGE_PURGE);
 
     /* Loop over this batch. */
-    foreach(string file: files)
+    foreach(int date: dates[..(size - 1)])
     {
-        if (purge_one_message(dir, file))
+        if (purge_one_message(date))
         {
             purged++;
         }
     }
 
     /* Continue with the next batch. */
-    if (sizeof(files) > size)
+    if (sizeof(dates) > size)
     {
-        files = files[size..];
+        dates = dates[size..];
         mail_alarm = set_alarm(3.0, 0.0,
-            &purge_check_messages(dir, messages, purged, files));
+            &purge_check_messages(segments, messages, purged, dates));
         return;
     }
 
-    /* Continue with the next message directory. */
-    dir++;
-    if (dir < HASH_SIZE)
+    /* Continue with the next segment. */
+    if (sizeof(segments))
     {
-        mail_tell_wizard("MAIL ADMIN ->> Purged message directory d" +
-            dir + ".\n");
-        files = get_dir(DIR_NAME_MESSAGE(dir) + "/m*.o");
-        messages += sizeof(files);
+        mail_tell_wizard("MAIL ADMIN ->> Purging segment " +
+            segments[0] + ".\n");
+        dates = MAIL_STORE->query_segment_messages(segments[0]);
+        messages += sizeof(dates);
         mail_alarm = set_alarm(3.0, 0.0,
-            &purge_check_messages(dir, messages, purged, files));
+            &purge_check_messages(segments[1..], messages, purged, dates));
         return;
     }
 
     mail_tell_wizard("MAIL ADMIN ->> Message purging completed.\nPurged " +
-        purged + " out of " + messages + " message files.\n");
+        purged + " out of " + messages + " messages.\n");
 
     mail_system = 0;
     mail_wizard = 0;
@@ -389,7 +382,6 @@ purge_collect_mailboxes(string *names)
     int     index;
     int     size = min(sizeof(names), MAX_MAILBOX_PURGE);
     mapping mail;
-    string *files;
 
     /* Fetch the message dates from the mailfolders. */
     foreach(string name: names[..(size-1)])
@@ -423,11 +415,9 @@ purge_collect_mailboxes(string *names)
 
     mail_tell_wizard("MAIL ADMIN ->> Collected all mailboxes.\n");
 
-    /* Fetch the first directory of messages. */
-    files = get_dir(DIR_NAME_MESSAGE(0) + "/m*.o");
-
+    /* Start with the first segment of the mail store. */
     mail_alarm = set_alarm(5.0, 0.0,
-        &purge_check_messages(0, sizeof(files), 0, files));
+        &purge_check_messages(MAIL_STORE->query_segments(), 0, 0, ({ })));
 }
 
 /*
@@ -502,6 +492,15 @@ purge_check_mailboxes(int full)
 static int
 purge_mail(int full)
 {
+    /* Messages in the old format would not be seen by the purge. */
+    if (full &&
+        !MAIL_STORE->query_converted())
+    {
+        write("The messages must be converted with \"mailadmin convert\" " +
+            "before they can be purged.\n");
+        return 1;
+    }
+
     write("Purge started.\n");
     write("Starting with removing mailboxes of non-existant players.\n");
 
@@ -519,50 +518,22 @@ purge_mail(int full)
 /*
  * Function name: report_statistics
  * Description  : This function will do the actual reporting about the
- *                mail system.
+ *                mailboxes.
  * Arguments    : int boxes    - the number of mailboxes found.
  *                int messages - the number of messages found in the boxes.
- *                int files    - the number of individual message files.
  */
 static void
-report_statistics(int boxes, int messages, int files)
+report_statistics(int boxes, int messages)
 {
     mail_tell_wizard("MAIL ADMIN ->> Done gathering statistics.\n" +
 	"A total of " + boxes + " mailboxes was found, containing a total " +
-	"of " + messages + " mail messages. These messages are stored in " +
-	files + " individual message files. On average, " +
-	(files / HASH_SIZE) + " message files are stored in each of the " +
-	HASH_SIZE + " directories.\n");
+	"of " + messages + " mail messages. The mail store holds " +
+	MAIL_STORE->query_stats()["messages"] + " messages.\n");
 
     mail_wizard = 0;
     mail_alarm = 0;
 }
 
-/*
- * Function name: count_messages
- * Description  : This function loops over all message directories and counts
- *                the number of messages found in them. Note that this
- *                function is not protected against eval-cost.
- * Arguments    : int boxes    - the number of mailboxes found.
- *                int messages - the number of messages found in the boxes.
- */
-static void
-count_messages(int boxes, int messages)
-{
-    int index = -1;
-    int message_files = 0;
-
-    mail_tell_wizard("MAIL ADMIN ->> Counting message files.\n");
-
-    while (++index < HASH_SIZE)
-    {
-	message_files += sizeof(get_dir(DIR_NAME_MESSAGE(index) + "/m*.o"));
-    }
-
-    mail_alarm = set_alarm(5.0, 0.0,
-	&report_statistics(boxes, messages, message_files));
-}
-
 /*
  * Function name: count_mailboxes
  * Description  : This function will loop over the mail directories and
@@ -606,18 +577,43 @@ count_mailboxes(int boxes, int messages, string *files)
         return;
     }
 
-    /* Continue with counting the message files. */
-    mail_alarm = set_alarm(10.0, 0.0, &count_messages(boxes, messages));
+    mail_alarm = set_alarm(10.0, 0.0, &report_statistics(boxes, messages));
 }
 
 /*
- * Function mame: mail_statistics
- * Description  : This function will print various statistics about the
- *                mail system.
+ * Function name: mail_statistics
+ * Description  : This function will print the statistics about the mail
+ *                system. They are served from the counters of the mail
+ *                store, so no files are scanned.
  * Returns      : int 1/0 - success/failure.
  */
 static int
 mail_statistics()
+{
+    mapping stats = MAIL_STORE->query_stats();
+
+    write("Messages stored : " + stats["messages"] + " in " +
+        stats["segments"] + " segments.\n" +
+        "Recipients      : " + stats["recipients"] + " (" +
+        (stats["messages"] ? (stats["recipients"] / stats["messages"]) : 0) +
+        " per message)\n" +
+        "Bytes           : " + stats["bytes"] + " used, " + stats["dead"] +
+        " unused.\n" +
+        "Reads           : " + stats["reads"] + ", of which " + stats["hits"] +
+        " from the cache and " + stats["legacy"] + " from old files.\n" +
+        "Converted       : " + (stats["converted"] ?
+        ctime(stats["converted"]) : "no, use \"mailadmin convert\"") + "\n");
+    return 1;
+}
+
+/*
+ * Function name: mailbox_statistics
+ * Description  : This function will gather statistics about all mailboxes
+ *                and store them in a central file.
+ * Returns      : int 1/0 - success/failure.
+ */
+static int
+mailbox_statistics()
 {
     int    index = -1;
     int    boxes;
@@ -641,6 +637,71 @@ mail_statistics()
     return 1;
 }
 
+/*
+ * Function name: convert_messages
+ * Description  : This will convert a batch of message files in the old
+ *                format and then continues with the next directory.
+ * Arguments    : int dir       - the directory number we are working on.
+ *                int converted - amount of messages converted so far.
+ *                string *files - the names of the files left in this dir.
+ */
+static void
+convert_messages(int dir, int converted, string *files)
+{
+    int size = min(sizeof(files), MAX_MESSAGE_CONVERT);
+    int date;
+
+    foreach(string file: files[..(size - 1)])
+    {
+        if ((sscanf(file, "m%d.o", date) == 1) &&
+            MAIL_STORE->convert_message(date))
+        {
+            converted++;
+        }
+    }
+
+    /* Continue with the next batch, or the next directory. */
+    if (sizeof(files) > size)
+    {
+        files = files[size..];
+    }
+    else if (++dir < HASH_SIZE)
+    {
+        mail_tell_wizard("MAIL ADMIN ->> Converting directory d" + dir +
+            ".\n");
+        files = get_dir(DIR_NAME_MESSAGE(dir) + "/m*.o");
+    }
+    else
+    {
+        MAIL_STORE->set_converted();
+        mail_tell_wizard("MAIL ADMIN ->> Conversion completed.\nConverted " +
+            converted + " message files.\n");
+
+        mail_wizard = 0;
+        mail_alarm = 0;
+        return;
+    }
+
+    mail_alarm = set_alarm(2.0, 0.0, &convert_messages(dir, converted, files));
+}
+
+/*
+ * Function name: convert_mail
+ * Description  : Start moving the message files in the old format into
+ *                the mail store.
+ * Returns      : int 1/0 - success/failure.
+ */
+static int
+convert_mail()
+{
+    mail_wizard = this_player()->query_real_name();
+    mail_alarm = set_alarm(2.0, 0.0,
+        &convert_messages(0, 0, get_dir(DIR_NAME_MESSAGE(0) + "/m*.o")));
+
+    write("Conversion started.\n");
+    return 1;
+}
+
 /*
  * Function name: mailadmin
  * Description  : This contains the implementation of the "mailadmin" command
@@ -678,6 +739,16 @@ mailadmin(string str)
     args = explode(str, " ");
     switch(args[0])
     {
+    case "convert":
+	if (sizeof(args) != 1)
+	{
+	    notify_fail("Syntax: mailadmin convert\n");
+	    return 0;
+	}
+
+	return convert_mail();
+	/* notreached */
+
     case "export":
 	if (sizeof(args) != 3)
 	{
@@ -714,13 +785,17 @@ mailadmin(string str)
 	/* notreached */
 
     case "stats":
-	if (sizeof(args) != 1)
+	if (sizeof(args) == 1)
 	{
-	    notify_fail("Syntax: mailadmin stats\n");
-	    return 0;
+	    return mail_statistics();
+	}
+	if (args[1] == "boxes")
+	{
+	    return mailbox_statistics();
 	}
 
-	return mail_statistics();
+	notify_fail("Syntax: mailadmin stats [boxes]\n");
+	return 0;
 	/* notreached */
 
     default:
@@ -29,6 +29,313 @@
 				 "W" : SANCTION_WRITE_ALL, \
 				 "s" : SANCTION_SNOOP ])
 
+/*
+ * Global variable that is not saved. The sanctions as they are stored in
+ * the SANCTION_DIR are kept in this tree so that the checks do not have to
+ * probe the disk. The path is "" for normal sanctions and starts with a "/"
+ * for directory sanctions.
+ *
+ * sanction_tree = ([ (string) giver :
+ *                    ([ (string) receiver :
+ *                       ([ (string) path : ([ (string) type : 1 ]) ])
+ *                    ])
+ *                 ])
+ */
+private static mapping sanction_tree;
+
+/*
+ * Function name: sanction_path_key
+ * Description  : Converts the path of a directory sanction to the form used
+ *                as index in the sanction tree.
+ * Arguments    : string path - the path, with or without leading "/".
+ * Returns      : string - the index, "" for no path.
+ */
+static string
+sanction_path_key(string path)
+{
+    if (!strlen(path))
+    {
+	return "";
+    }
+
+    path = implode(explode(path, "/") - ({ "" }), "/");
+    return (strlen(path) ? ("/" + path) : "");
+}
+
+/*
+ * Function name: read_sanction_dir
+ * Description  : Reads the sanctions of a receiver from disk into the tree,
+ *                recursing into the directories of directory sanctions.
+ * Arguments    : mapping paths - the paths of the receiver in the tree.
+ *                string dir    - the directory of the receiver on disk.
+ *                string path   - the path of a directory sanction.
+ */
+static void
+read_sanction_dir(mapping paths, string dir, string path)
+{
+    foreach(string file: get_dir(dir + path + "/*") - ({ ".", ".." }))
+    {
+	if (file_size(dir + path + "/" + file) == -2)
+	{
+	    read_sanction_dir(paths, dir, path + "/" + file);
+	}
+	else if (stringp(SANCTION_FILE_TO_TOKEN["/" + file]))
+	{
+	    if (!mappingp(paths[path]))
+	    {
+		paths[path] = ([ ]);
+	    }
+	    paths[path]["/" + file] = 1;
+	}
+    }
+}
+
+/*
+ * Function name: read_sanction_tree
+ * Description  : Reads all sanctions from SANCTION_DIR.
+ * Returns      : mapping - the sanction tree, see above.
+ */
+static mapping
+read_sanction_tree()
+{
+    mapping tree = ([ ]);
+    mapping paths;
+
+    set_auth(this_object(), "root:root");
+
+    foreach(string giver: get_dir(SANCTION_DIR + "*") - ({ ".", ".." }))
+    {
+	if (file_size(SANCTION_DIR + giver) != -2)
+	{
+	    continue;
+	}
+
+	tree[giver] = ([ ]);
+	foreach(string receiver: get_dir(SANCTION_DIR + giver + "/*") -
+	    ({ ".", ".." }))
+	{
+	    read_sanction_dir((paths = ([ ])),
+		(SANCTION_DIR + giver + "/" + receiver), "");
+	    if (m_sizeof(paths))
+	    {
+		tree[giver][receiver] = paths;
+	    }
+	}
+    }
+
+    return tree;
+}
+
+/*
+ * Function name: init_sanctions
+ * Description  : Called at boot-time, and when the master is loaded, to read
+ *                the sanctions from disk into the sanction tree.
+ */
+static void
+init_sanctions()
+{
+    sanction_tree = read_sanction_tree();
+    forget_access();
+}
+
+/*
+ * Function name: has_sanction
+ * Description  : Finds out whether a sanction is in the sanction tree.
+ * Arguments    : string giver    - the euid giving the sanction.
+ *                string receiver - the receiver of the sanction.
+ *                string path     - the path index, see sanction_path_key.
+ *                string type     - the sanction type.
+ * Returns      : int 1/0 - exists/does not exist.
+ */
+static int
+has_sanction(string giver, string receiver, string path, string type)
+{
+    mapping node;
+
+    if (!mappingp(sanction_tree))
+    {
+	init_sanctions();
+    }
+
+    return (mappingp(node = sanction_tree[giver]) &&
+	    mappingp(node = node[receiver]) &&
+	    mappingp(node = node[path]) &&
+	    node[type]);
+}
+
+/*
+ * Function name: has_path_sanctions
+ * Description  : Finds out whether a domain or wizard has given out any
+ *                directory sanctions.
+ * Arguments    : string giver - the euid giving the sanctions.
+ * Returns      : int 1/0 - true if so.
+ */
+static int
+has_path_sanctions(string giver)
+{
+    if (!mappingp(sanction_tree))
+    {
+	init_sanctions();
+    }
+
+    if (!mappingp(sanction_tree[giver]))
+    {
+	return 0;
+    }
+
+    foreach(string receiver, mapping paths: sanction_tree[giver])
+    {
+	if (m_sizeof(paths) > (mappingp(paths[""]) ? 1 : 0))
+	{
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
+/*
+ * Function name: forget_sanction
+ * Description  : Removes sanctions from the tree. All but the first argument
+ *                are optional, like with remove_sanction().
+ * Arguments    : string giver    - the euid giving the sanction.
+ *                string receiver - the receiver of the sanction.
+ *                string type     - the sanction type.
+ *                string path     - the path in case of a directory sanction.
+ */
+static varargs void
+forget_sanction(string giver, string receiver, string type, string path)
+{
+    mapping paths;
+
+    forget_sanction_access(giver);
+
+    if (!mappingp(sanction_tree) ||
+	!mappingp(sanction_tree[giver]))
+    {
+	return;
+    }
+
+    if (!strlen(receiver))
+    {
+	m_delkey(sanction_tree, giver);
+	return;
+    }
+
+    if (!mappingp(paths = sanction_tree[giver][receiver]))
+    {
+	return;
+    }
+
+    path = sanction_path_key(path);
+    if (strlen(type))
+    {
+	if (mappingp(paths[path]))
+	{
+	    m_delkey(paths[path], type);
+	    if (!m_sizeof(paths[path]))
+	    {
+		m_delkey(paths, path);
+	    }
+	}
+    }
+    else if (!strlen(path))
+    {
+	m_delkey(sanction_tree[giver], receiver);
+    }
+    else
+    {
+	/* Removing a directory removes everything below it. */
+	foreach(string index: m_indices(paths))
+	{
+	    if ((index == path) ||
+		(index[..strlen(path)] == (path + "/")))
+	    {
+		m_delkey(paths, index);
+	    }
+	}
+    }
+
+    if (!m_sizeof(paths))
+    {
+	m_delkey(sanction_tree[giver], receiver);
+    }
+    if (!m_sizeof(sanction_tree[giver]))
+    {
+	m_delkey(sanction_tree, giver);
+    }
+}
+
+/*
+ * Function name: list_sanction_tree
+ * Description  : Makes a flat list of all sanctions in a tree, for easy
+ *                comparison.
+ * Arguments    : mapping tree - the sanction tree.
+ * Returns      : string * - the sanctions as "giver/receiver[path] type".
+ */
+static string *
+list_sanction_tree(mapping tree)
+{
+    string *list = ({ });
+
+    foreach(string giver, mapping receivers: tree)
+    {
+	foreach(string receiver, mapping paths: receivers)
+	{
+	    foreach(string path, mapping types: paths)
+	    {
+		foreach(string type: m_indices(types))
+		{
+		    list += ({ giver + "/" + receiver + path + " " +
+			SANCTION_FILE_TO_TOKEN[type] });
+		}
+	    }
+	}
+    }
+
+    return sort_array(list);
+}
+
+/*
+ * Function name: verify_sanctions
+ * Description  : Compares the sanction tree with the sanctions on disk and
+ *                prints the differences.
+ */
+static void
+verify_sanctions()
+{
+    string *memory, *disk, *diff;
+
+    if (!mappingp(sanction_tree))
+    {
+	init_sanctions();
+    }
+
+    memory = list_sanction_tree(sanction_tree);
+    disk = list_sanction_tree(read_sanction_tree());
+
+    write("Sanctions in memory: " + sizeof(memory) + ", on disk: " +
+	sizeof(disk) + ".\n");
+
+    if (sizeof(diff = disk - memory))
+    {
+	write("Only on disk:\n    " + implode(diff, "\n    ") + "\n");
+    }
+    if (sizeof(diff = memory - disk))
+    {
+	write("Only in memory:\n    " + implode(diff, "\n    ") + "\n");
+    }
+    if (sizeof(disk - memory) || sizeof(memory - disk))
+    {
+	write("The sanction tree does NOT agree with the disk. Use " +
+	    "\"sanction reload\" to read it again.\n");
+    }
+    else
+    {
+	write("The sanction tree agrees with the disk.\n");
+    }
+}
+
 /*
  * Function name: valid_snoop_sanction
  * Description  : This function can be used to query whether there is a
@@ -42,8 +349,7 @@
 static int
 valid_snoop_sanction(string snooper, string snoopee)
 {
-    return (file_time(SANCTION_DIR + snoopee + "/" + snooper +
-			SANCTION_SNOOP) > 0);
+    return has_sanction(snoopee, snooper, "", SANCTION_SNOOP);
 }
 
 /*
@@ -59,12 +365,9 @@ valid_snoop_sanction(string snooper, string snoopee)
 static int
 valid_read_sanction(string reader, string euid)
 {
-    return (file_time(SANCTION_DIR + euid + "/all" +
-		       SANCTION_READ) ||
-	    file_time(SANCTION_DIR + euid + "/" + reader +
-		       SANCTION_READ) ||
-	    file_time(SANCTION_DIR + euid + "/" + query_wiz_dom(reader) +
-		       SANCTION_READ));
+    return (has_sanction(euid, "all", "", SANCTION_READ) ||
+	    has_sanction(euid, reader, "", SANCTION_READ) ||
+	    has_sanction(euid, query_wiz_dom(reader), "", SANCTION_READ));
 }
 
 /*
@@ -80,12 +383,9 @@ valid_read_sanction(string reader, string euid)
 static int
 valid_read_all_sanction(string reader, string euid)
 {
-    return (file_time(SANCTION_DIR + euid + "/" + reader +
-		       SANCTION_READ_ALL) ||
-	    file_time(SANCTION_DIR + euid + "/" + query_wiz_dom(reader) +
-		       SANCTION_READ_ALL) ||
-	    file_time(SANCTION_DIR + euid + "/all" +
-		       SANCTION_READ_ALL));
+    return (has_sanction(euid, reader, "", SANCTION_READ_ALL) ||
+	    has_sanction(euid, query_wiz_dom(reader), "", SANCTION_READ_ALL) ||
+	    has_sanction(euid, "all", "", SANCTION_READ_ALL));
 }
 
 /*
@@ -101,12 +401,9 @@ valid_read_all_sanction(string reader, string euid)
 static int
 valid_write_sanction(string writer, string euid)
 {
-    return (file_time(SANCTION_DIR + euid + "/all" +
-		       SANCTION_WRITE) ||
-	    file_time(SANCTION_DIR + euid + "/" + writer +
-		       SANCTION_WRITE) ||
-	    file_time(SANCTION_DIR + euid + "/" + query_wiz_dom(writer) +
-		       SANCTION_WRITE));
+    return (has_sanction(euid, "all", "", SANCTION_WRITE) ||
+	    has_sanction(euid, writer, "", SANCTION_WRITE) ||
+	    has_sanction(euid, query_wiz_dom(writer), "", SANCTION_WRITE));
 }
 
 /*
@@ -122,12 +419,9 @@ valid_write_sanction(string writer, string euid)
 static int
 valid_write_all_sanction(string writer, string euid)
 {
-    return (file_time(SANCTION_DIR + euid + "/" + writer +
-		       SANCTION_WRITE_ALL) ||
-	    file_time(SANCTION_DIR + euid + "/" + query_wiz_dom(writer) +
-		       SANCTION_WRITE_ALL) ||
-	    file_time(SANCTION_DIR + euid + "/all" +
-		       SANCTION_WRITE_ALL));
+    return (has_sanction(euid, writer, "", SANCTION_WRITE_ALL) ||
+	    has_sanction(euid, query_wiz_dom(writer), "", SANCTION_WRITE_ALL) ||
+	    has_sanction(euid, "all", "", SANCTION_WRITE_ALL));
 }
 
 /*
@@ -146,12 +440,9 @@ valid_write_all_sanction(string writer, string euid)
 static int
 valid_read_path_sanction(string reader, string euid, string path)
 {
-    return (file_time(SANCTION_DIR + euid + "/all" +
-		       path + SANCTION_READ) ||
-	    file_time(SANCTION_DIR + euid + "/" + reader +
-		       path + SANCTION_READ) ||
-	    file_time(SANCTION_DIR + euid + "/" + query_wiz_dom(reader) +
-		       path + SANCTION_READ));
+    return (has_sanction(euid, "all", path, SANCTION_READ) ||
+	    has_sanction(euid, reader, path, SANCTION_READ) ||
+	    has_sanction(euid, query_wiz_dom(reader), path, SANCTION_READ));
 }
 
 /*
@@ -202,12 +493,9 @@ recursive_valid_read_path_sanction(string reader, string dname, string *parts)
 static int
 valid_write_path_sanction(string writer, string euid, string path)
 {
-    return (file_time(SANCTION_DIR + euid + "/all" +
-		       path + SANCTION_WRITE) ||
-	    file_time(SANCTION_DIR + euid + "/" + writer +
-		       path + SANCTION_WRITE) ||
-	    file_time(SANCTION_DIR + euid + "/" + query_wiz_dom(writer) +
-		       path + SANCTION_WRITE));
+    return (has_sanction(euid, "all", path, SANCTION_WRITE) ||
+	    has_sanction(euid, writer, path, SANCTION_WRITE) ||
+	    has_sanction(euid, query_wiz_dom(writer), path, SANCTION_WRITE));
 }
 
 /*
@@ -254,8 +542,7 @@ recursive_valid_write_path_sanction(string writer, string dname, string *parts)
 static varargs int
 query_sanction(string giver, string receiver, string type, string path)
 {
-    return (file_time(SANCTION_DIR + giver + "/" + receiver +
-			(strlen(path) ? ("/" + path) : "") + type) > 0);
+    return has_sanction(giver, receiver, sanction_path_key(path), type);
 }
 
 /*
@@ -275,6 +562,7 @@ static varargs int
 create_sanction(string giver, string receiver, string type, string path)
 {
     string *parts;
+    string key = sanction_path_key(path);
     int    index;
     int    size;
 
@@ -311,9 +599,34 @@ create_sanction(string giver, string receiver, string type, string path)
 	}
     }
 
-    return write_file((path + type),
-		      (objectp(this_player()) ?
-		       this_player()->query_real_name() : "sanction"));
+    if (!write_file((path + type),
+		    (objectp(this_player()) ?
+		     this_player()->query_real_name() : "sanction")))
+    {
+	return 0;
+    }
+
+    /* Record the sanction in the tree as well. */
+    forget_sanction_access(giver);
+    if (!mappingp(sanction_tree))
+    {
+	init_sanctions();
+	return 1;
+    }
+    if (!mappingp(sanction_tree[giver]))
+    {
+	sanction_tree[giver] = ([ ]);
+    }
+    if (!mappingp(sanction_tree[giver][receiver]))
+    {
+	sanction_tree[giver][receiver] = ([ ]);
+    }
+    if (!mappingp(sanction_tree[giver][receiver][key]))
+    {
+	sanction_tree[giver][receiver][key] = ([ ]);
+    }
+    sanction_tree[giver][receiver][key][type] = 1;
+    return 1;
 }
 
 /*
@@ -377,6 +690,11 @@ remove_sanction(string giver, string receiver, string type, string path)
 
     set_auth(this_object(), "root:root");
 
+    /* Forget about it in the tree. If removing it from disk fails, there is
+     * no sanction anymore either.
+     */
+    forget_sanction(giver, receiver, type, path);
+
     /* Construct the path to remove. */
     path = SANCTION_DIR + giver +
 	(strlen(receiver) ?
@@ -443,13 +761,17 @@ remove_all_sanctions(string name)
     remove_sanction(name);
 
     /* Remove all sanctions this wizard or domain has received. */
-    files = get_dir(SANCTION_DIR + "*");
+    if (!mappingp(sanction_tree))
+    {
+	init_sanctions();
+    }
+    files = m_indices(sanction_tree);
     index = -1;
     size = sizeof(files);
     while(++index < size)
     {
 	/* Only remove it if there is such a sanction indeed. */
-	if (file_size(SANCTION_DIR + files[index] + "/" + name) == -2)
+	if (mappingp(sanction_tree[files[index]][name]))
 	{
 	    remove_sanction(files[index], name);
 	}
@@ -600,12 +922,32 @@ sanction(string str)
 	return 1;
     }
 
+    /* The administration may compare the sanction tree with the disk. */
+    if ((str == "verify") ||
+	(str == "reload"))
+    {
+	if (query_wiz_rank(name) < WIZ_ARCH)
+	{
+	    notify_fail("Only the administration may " + str +
+		" the sanctions.\n");
+	    return 0;
+	}
+
+	if (str == "reload")
+	{
+	    init_sanctions();
+	    write("Sanctions read from disk again.\n");
+	}
+	verify_sanctions();
+	return 1;
+    }
+
     /* Clear your personal sanction list. */
     if ((str == "clear") ||
 	(str == "c"))
     {
 	write("Removing all your personal sanctions.\n");
-	recursive_rmdir(SANCTION_DIR + name);
+	remove_sanction(name);
 	return 1;
     }
 
@@ -632,7 +974,7 @@ sanction(string str)
 	}
 
 	write("Removing sanction(s) given to \"" + parts[0] + "\".\n");
-	recursive_rmdir(SANCTION_DIR + name + "/" + parts[0]);
+	remove_sanction(name, parts[0]);
 	rmdir(SANCTION_DIR + name);
 	return 1;
     }
@@ -776,7 +1118,7 @@ domainsanction(string str)
 	(parts[1] == "c"))
     {
 	write("Removing all sanctions from domain " + domain + ".\n");
-	recursive_rmdir(SANCTION_DIR + domain);
+	remove_sanction(domain);
 	return 1;
     }
 
@@ -809,7 +1151,7 @@ domainsanction(string str)
 
 	write("Removing sanction(s) given to \"" + parts[1] + "\" in " +
 	    domain + ".\n");
-	recursive_rmdir(SANCTION_DIR + domain + "/" + parts[1]);
+	remove_sanction(domain, parts[1]);
 	rmdir(SANCTION_DIR + domain);
 	return 1;
     }
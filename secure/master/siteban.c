@@ -11,6 +11,18 @@
 #define SITEBAN_DATE    2
 #define SITEBAN_COMMENT 3
 
+/* Indices into a compiled siteban list. */
+#define SITEBAN_TRIE      0
+#define SITEBAN_WILDCARDS 1
+
+/* Special keys in the nodes of the siteban trie. */
+#define SITEBAN_END       0
+#define SITEBAN_ANY       "*"
+
+/* Benchmark parameters. */
+#define SITEBAN_BENCH_SIZE  10000
+#define SITEBAN_BENCH_CHUNK 25
+
 /*
  * Global variable in the save-file:
  *
@@ -28,9 +40,29 @@ private mapping sitebans;
  *
  * sitebans_nologin = (string *)ipmasks
  * sitebans_nonew   = (string *)ipmasks
+ *
+ * The compiled versions of these lists are used for the actual checks. The
+ * masks that contain only whole octets, optionally followed by a final "*",
+ * are put in a trie of octets. Other masks are kept in a list that is still
+ * checked with wildmatch().
+ *
+ * compiled_nologin = ({ (mapping) trie, (string *)wildcard masks })
+ * compiled_nonew   = ({ (mapping) trie, (string *)wildcard masks })
+ *
+ * trie = ([ (string) octet : (mapping) trie,
+ *           SITEBAN_ANY    : 1 if a mask ends here with ".*",
+ *           SITEBAN_END    : 1 if a mask ends here exactly,
+ *        ])
  */
 private static string *sitebans_nologin;
 private static string *sitebans_nonew;
+private static mixed  compiled_nologin;
+private static mixed  compiled_nonew;
+
+/*
+ * Global variable used for the siteban benchmark.
+ */
+private static mapping bench_state;
 
 /*
  * Function name: filter_sitebans
@@ -45,6 +77,112 @@ filter_sitebans(string ipmask, int type)
     return (sitebans[ipmask][SITEBAN_TYPE] == type);
 }
 
+/*
+ * Function name: compile_sitebans
+ * Description  : Compiles a list of ip masks into a trie of octets and a
+ *                list of masks that need wildcard matching.
+ * Arguments    : string *masks - the ip masks.
+ * Returns      : mixed - ({ (mapping) trie, (string *) wildcards })
+ */
+static mixed
+compile_sitebans(string *masks)
+{
+    mapping trie = ([ ]);
+    mapping node;
+    string  *wildcards = ({ });
+    string  *octets;
+    int     index, size;
+
+    foreach(string mask: masks)
+    {
+        octets = explode(mask, ".");
+        size = sizeof(octets);
+
+        /* Only whole octets can go in the trie, and a "*" only as last
+         * octet. Anything else requires wildmatch().
+         */
+        index = -1;
+        while(++index < size)
+        {
+            if ((octets[index] == SITEBAN_ANY) && (index == (size - 1)))
+            {
+                continue;
+            }
+            if (sizeof(regexp(({ octets[index] }), "[*?[\\]")))
+            {
+                break;
+            }
+        }
+
+        if (!size || (index < size) || (member_array("", octets) >= 0) ||
+            (implode(octets, ".") != mask))
+        {
+            wildcards += ({ mask });
+            continue;
+        }
+
+        node = trie;
+        foreach(string octet: octets)
+        {
+            if (octet == SITEBAN_ANY)
+            {
+                node[SITEBAN_ANY] = 1;
+                break;
+            }
+
+            if (!mappingp(node[octet]))
+            {
+                node[octet] = ([ ]);
+            }
+            node = node[octet];
+        }
+
+        if (octets[-1..][0] != SITEBAN_ANY)
+        {
+            node[SITEBAN_END] = 1;
+        }
+    }
+
+    return ({ trie, wildcards });
+}
+
+/*
+ * Function name: match_sitebans
+ * Description  : Finds out whether an ip number matches a compiled siteban
+ *                list. The cost of the trie lookup only depends on the
+ *                number of octets, not on the number of bans.
+ * Arguments    : mixed compiled - the compiled list, see compile_sitebans.
+ *                string ipnumber - the ip number to test.
+ * Returns      : int 1/0 - matched / did not match.
+ */
+static int
+match_sitebans(mixed compiled, string ipnumber)
+{
+    mapping node = compiled[SITEBAN_TRIE];
+
+    foreach(string octet: explode(ipnumber, "."))
+    {
+        if (node[SITEBAN_ANY])
+        {
+            return 1;
+        }
+
+        if (!mappingp(node = node[octet]))
+        {
+            node = 0;
+            break;
+        }
+    }
+
+    if (mappingp(node) && node[SITEBAN_END])
+    {
+        return 1;
+    }
+
+    return (sizeof(compiled[SITEBAN_WILDCARDS]) &&
+        sizeof(filter(compiled[SITEBAN_WILDCARDS], &wildmatch(, ipnumber))));
+}
+
 /*
  * Function name: init_sitebans
  * Description  : Called at boot-time, and whenever the sitebans list has been
@@ -63,6 +201,9 @@ init_sitebans()
         &filter_sitebans(, SITEBAN_NOLOGIN));
     sitebans_nonew = filter(m_indices(sitebans),
         &filter_sitebans(, SITEBAN_NONEW));
+
+    compiled_nologin = compile_sitebans(sitebans_nologin);
+    compiled_nonew = compile_sitebans(sitebans_nonew);
 }
 
 /*
@@ -79,10 +220,13 @@ check_newplayer(string ipnumber)
     if (!strlen(ipnumber))
         return 0;
 
-    if (sizeof(filter(sitebans_nologin, &wildmatch(, ipnumber))))
+    if (!pointerp(compiled_nologin))
+        init_sitebans();
+
+    if (match_sitebans(compiled_nologin, ipnumber))
         return SITEBAN_NOLOGIN;
 
-    if (sizeof(filter(sitebans_nonew, &wildmatch(, ipnumber))))
+    if (match_sitebans(compiled_nonew, ipnumber))
         return SITEBAN_NONEW;
 
     return 0;
@@ -184,6 +328,156 @@ list_siteban(string wildcards)
     return 1;    
 }
 
+/*
+ * Function name: bench_siteban_chunk
+ * Description  : Replays a part of the connection log of the benchmark. The
+ *                log is replayed in chunks from alarms, as wildmatching the
+ *                whole log against the whole list in one go would exceed
+ *                the evaluation limit. Since gettimeofday() only changes
+ *                once per driver heartbeat, the cost is expressed in the
+ *                number of wildmatch() calls and trie steps made.
+ */
+static void
+bench_siteban_chunk()
+{
+    string *chunk = bench_state["ips"][..(SITEBAN_BENCH_CHUNK - 1)];
+    string *wildcards = bench_state["compiled"][SITEBAN_WILDCARDS];
+    int    plain, fast;
+
+    bench_state["ips"] = bench_state["ips"][SITEBAN_BENCH_CHUNK..];
+
+    foreach(string ip: chunk)
+    {
+        plain = sizeof(filter(bench_state["masks"], &wildmatch(, ip)));
+        fast = match_sitebans(bench_state["compiled"], ip);
+
+        bench_state["lookups"]++;
+        bench_state["banned"] += fast;
+        bench_state["steps"] += sizeof(explode(ip, "."));
+        if ((plain > 0) != fast)
+        {
+            bench_state["mismatches"]++;
+        }
+    }
+
+    if (sizeof(bench_state["ips"]))
+    {
+        set_alarm(0.0, 0.0, bench_siteban_chunk);
+        return;
+    }
+
+    if (objectp(bench_state["wizard"]))
+    {
+        tell_object(bench_state["wizard"], sprintf("Siteban benchmark " +
+            "done in %d seconds.\n" +
+            "Bans       : %d (%d in trie, %d wildcard)\n" +
+            "Lookups    : %d (%d banned)\n" +
+            "Old method : %d wildmatch calls\n" +
+            "Compiled   : %d trie steps, %d wildmatch calls\n" +
+            "Mismatches : %d\n",
+            time() - bench_state["start"],
+            sizeof(bench_state["masks"]),
+            sizeof(bench_state["masks"]) - sizeof(wildcards),
+            sizeof(wildcards),
+            bench_state["lookups"], bench_state["banned"],
+            bench_state["lookups"] * sizeof(bench_state["masks"]),
+            bench_state["steps"],
+            bench_state["lookups"] * sizeof(wildcards),
+            bench_state["mismatches"]));
+    }
+    bench_state = 0;
+}
+
+/*
+ * Function name: bench_siteban
+ * Description  : Replays the ip numbers in a connection log against a
+ *                generated list of bans, using both wildmatch() on the
+ *                list and the compiled matcher, and compares the results.
+ *                The log should contain an ip number as first word of each
+ *                line.
+ * Arguments    : string file - the connection log.
+ *                int size - the number of bans to generate.
+ * Returns      : int 1/0 - success/failure.
+ */
+static int
+bench_siteban(string file, int size)
+{
+    string *ips = ({ });
+    string *masks = ({ });
+    string ip;
+    int    index;
+
+    if (mappingp(bench_state))
+    {
+        notify_fail("A siteban benchmark is already running.\n");
+        return 0;
+    }
+
+    if (!strlen(file = read_file(file)))
+    {
+        notify_fail("Cannot read the connection log.\n");
+        return 0;
+    }
+
+    foreach(string line: explode(file, "\n"))
+    {
+        if (sscanf(line, "%s %*s", ip) != 2)
+        {
+            ip = line;
+        }
+        if (sizeof(explode(ip, ".")) == 4)
+        {
+            ips += ({ ip });
+        }
+    }
+
+    if (!sizeof(ips))
+    {
+        notify_fail("No ip numbers found in the connection log.\n");
+        return 0;
+    }
+
+    /* Generate a list of bans of the kinds we see in practice. Some of them
+     * are taken from the log so that there are hits as well.
+     */
+    while(++index <= size)
+    {
+        switch(index % 20)
+        {
+        case 0:
+            ip = ips[random(sizeof(ips))];
+            masks += ({ implode(explode(ip, ".")[..2], ".") + ".*" });
+            break;
+
+        case 1:
+            masks += ({ random(256) + "." + random(256) + ".*" });
+            break;
+
+        case 2:
+            masks += ({ random(256) + "." + random(10) + "?.*" });
+            break;
+
+        case 3..9:
+            masks += ({ random(256) + "." + random(256) + "." +
+                random(256) + ".*" });
+            break;
+
+        default:
+            masks += ({ random(256) + "." + random(256) + "." +
+                random(256) + "." + random(256) });
+        }
+    }
+
+    bench_state = ([ "masks" : masks, "ips" : ips,
+        "compiled" : compile_sitebans(masks), "lookups" : 0, "banned" : 0,
+        "steps" : 0, "mismatches" : 0, "start" : time(),
+        "wizard" : this_player() ]);
+    write("Replaying " + sizeof(ips) + " connections against " + size +
+        " bans. This will take a while.\n");
+    set_alarm(0.0, 0.0, bench_siteban_chunk);
+    return 1;
+}
+
 /*
  * Function name: remove_siteban
  * Description  : Called to remove the ban of a single site.
@@ -275,11 +569,21 @@ siteban(string str)
         }
         return remove_siteban(words[1]);
 
+    case "benchmark":
+        if ((sizeof(words) < 2) || (sizeof(words) > 3))
+        {
+            notify_fail("Syntax: benchmark <connection log> [<bans>]\n");
+            return 0;
+        }
+        return bench_siteban(FTPATH(this_player()->query_path(), words[1]),
+            ((sizeof(words) == 3) ? atoi(words[2]) : SITEBAN_BENCH_SIZE));
+
     default:
         notify_fail("No such argument to \"siteban\".\nSyntax: siteban " +
             "list nologin / nonew / <wildcards>\n        siteban [add] " +
             "nologin / nonew <ipmask> <reason>\n        siteban remove " +
-            "<ipmask>\n");
+            "<ipmask>\n        siteban benchmark <connection log> " +
+            "[<bans>]\n");
         return 0;
     }
 }
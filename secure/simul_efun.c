@@ -868,7 +868,29 @@ log_file(string file, string text, int cyclesize)
 	path = SECURITY->query_wiz_path(crname) + "/log";
     }
     file = path + "/" + file;
-    
+
+#ifdef CYCLIC_LOG_SIZE
+
+    /* If no cycle size was provided, use the default cycle size. */
+    if (!cyclesize)
+    {
+        if (!(cyclesize = CYCLIC_LOG_SIZE[crname]))
+	{
+	    cyclesize = CYCLIC_LOG_SIZE[0];
+	}
+    }
+
+#endif /* CYCLIC_LOG_SIZE */
+
+    /* Let the log writer buffer the line. Only while it cannot be loaded,
+     * e.g. when the game boots, do we write the line ourselves.
+     */
+    if (!catch(index = LOG_CENTRAL->buffer_log(crname, path, file, text,
+        cyclesize)) && index)
+    {
+        return;
+    }
+
     /* We swap to the userid of the user trying to do log_file */
     oldeuid = geteuid(this_object());
     this_object()->seteuid(crname);
@@ -891,19 +913,6 @@ log_file(string file, string text, int cyclesize)
 	}
     }
 
-#ifdef CYCLIC_LOG_SIZE
-
-    /* If no cycle size was provided, use the default cycle size. */
-    if (!cyclesize)
-    {
-        if (!(cyclesize = CYCLIC_LOG_SIZE[crname]))
-	{
-	    cyclesize = CYCLIC_LOG_SIZE[0];
-	}
-    }
-
-#endif /* CYCLIC_LOG_SIZE */
-
     /* If we have a positive cycle size, enforce it. */
     if ((cyclesize > 0) && (file_size(file) > cyclesize))
     {
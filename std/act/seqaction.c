@@ -27,10 +27,15 @@
   behaviour. Use the VBFC just as usual. Note also that effuserid will be 0
   in the call to these VBFC functions (as it normally is).
 
+  The steps are run by the ambient scheduler (AMBIENT_SCHEDULER). When no
+  interactive player has been met for a while, the NPC parks itself there
+  until a player meets it or another parked NPC in the same room.
+
 */
 #pragma save_binary
 #pragma strict_types
 
+#include <files.h>
 #include <macros.h>
 
 /* Local definitions. */
@@ -47,9 +52,11 @@ static  mixed   *seq_commands;          /* Array of arrays holding actions
 static  string  *seq_names;             /* id of a sequence */
 static  int     *seq_flags;             /* flags of a sequence */
 static  int     seq_active,
+                seq_parked,             /* Parked in the scheduler */
                 *seq_cpos;              /* Current position in array */
 
 public void seq_restart();
+static void seq_start();
 
 /*
  *  Description: Called from living to initialize
@@ -73,13 +80,21 @@ seq_heartbeat(int steps)
     int il, newstep, stopseq, stopped;
     mixed cmd;
     mixed cmdres;
-    mixed *calls;
 
     /* Something might have gone badly wrong */
     if (!environment())
+    {
+        seq_active = 0;
         return;
+    }
 
-    set_alarm(rnd() * SEQ_SLOW + SEQ_SLOW / 2.0, 0.0, &seq_heartbeat(1));
+    seq_active = 1;
+    if (seq_parked)
+    {
+        /* Woken by the scheduler for another NPC in the room. */
+        seq_parked = 0;
+        this_object()->remove_notify_meet_interactive("seq_restart");
+    }
 
     stopseq = ((time() -
                 this_object()->query_last_met_interactive()) > SEQ_STAY_AWAKE);
@@ -135,25 +150,24 @@ seq_heartbeat(int steps)
         }
     }
 
-    calls = get_all_alarms();
-    if (stopped)
+    if (newstep > 1)
+    {
+        AMBIENT_SCHEDULER->schedule_step(itof(newstep) *
+            (SEQ_SLOW / 2.0 + rnd() * SEQ_SLOW), newstep);
+    }
+    else if (stopped)
     {
-        for (il = 0 ; il < sizeof(calls) ; il++)
-            if (calls[il][1] == "seq_heartbeat")
-                remove_alarm(calls[il][0]);
+        AMBIENT_SCHEDULER->park_npc();
         this_object()->add_notify_meet_interactive("seq_restart");
+        seq_parked = 1;
         if (!newstep)
         {
             seq_active = 0;
         }
     }
-    if (newstep > 1)
+    else
     {
-        for (il = 0 ; il < sizeof(calls) ; il++)
-            if (calls[il][1] == "seq_heartbeat")
-                remove_alarm(calls[il][0]);
-        set_alarm(itof(newstep) * (SEQ_SLOW / 2.0 + rnd() * SEQ_SLOW), 0.0,
-                  &seq_heartbeat(newstep));
+        AMBIENT_SCHEDULER->schedule_step(rnd() * SEQ_SLOW + SEQ_SLOW / 2.0, 1);
     }
 }
 
@@ -164,17 +178,51 @@ seq_heartbeat(int steps)
 public void
 seq_restart()
 {
-    mixed *calls = get_all_alarms();
-    int il;
-
     seq_active = 1;
-    for (il=0 ; il<sizeof(calls) ; il++)
-        if (calls[il][1] == "seq_heartbeat")
-            remove_alarm(calls[il][0]);
-    set_alarm(1.0, 0.0, &seq_heartbeat(1));
+    seq_parked = 0;
+    AMBIENT_SCHEDULER->wake_npc();
     this_object()->remove_notify_meet_interactive("seq_restart");
 }
 
+/*
+ * Called when a command is added while no sequence is running. Unlike
+ * seq_restart() it does not wake the other NPCs in the room.
+ */
+static void
+seq_start()
+{
+    seq_active = 1;
+    if (seq_parked)
+    {
+        seq_parked = 0;
+        this_object()->remove_notify_meet_interactive("seq_restart");
+    }
+    AMBIENT_SCHEDULER->schedule_step(1.0, 1);
+}
+
+/*
+ * Registers a chunk of NPCs again with a new ambient scheduler.
+ */
+static void
+seq_rejoin(object *npcs, float *delays, int *steps)
+{
+    AMBIENT_SCHEDULER->rejoin_npcs(npcs, delays, steps);
+}
+
+/*
+ * Called from the ambient scheduler when it is destructed, so that we
+ * register the chunk of NPCs with the new scheduler once it is gone.
+ * A delay < 0.0 means the NPC was parked.
+ */
+public nomask void
+seq_handover(object *npcs, float *delays, int *steps)
+{
+    if (file_name(previous_object()) != AMBIENT_SCHEDULER)
+        return;
+
+    set_alarm(0.0, 0.0, &seq_rejoin(npcs, delays, steps));
+}
+
 /*
  *  Description: New command sequence. Command sequences are independant
  *               named streams of commands. This function creates a stream.
@@ -213,6 +261,17 @@ seq_delete(string name)
     seq_commands = exclude_array(seq_commands, pos, pos);
     seq_cpos = exclude_array(seq_cpos, pos, pos);
     seq_flags = exclude_array(seq_flags, pos, pos);
+
+    /* Nothing left to run, leave the scheduler. */
+    if (!sizeof(seq_names) &&
+        (seq_active || seq_parked))
+    {
+        AMBIENT_SCHEDULER->unschedule_npc();
+        if (seq_parked)
+            this_object()->remove_notify_meet_interactive("seq_restart");
+        seq_active = 0;
+        seq_parked = 0;
+    }
 }
 
 /*
@@ -238,7 +297,7 @@ seq_addfirst(string name, mixed cmd)
 
     if (!seq_active)
     {
-        seq_restart();
+        seq_start();
     }
 
     if (!pointerp(cmd))
@@ -270,7 +329,7 @@ seq_addlast(string name, mixed cmd)
 
     if (!seq_active)
     {
-        seq_restart();
+        seq_start();
     }
 
     if (!pointerp(cmd))
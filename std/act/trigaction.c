@@ -10,6 +10,13 @@
 
   NOTICE: Triggers are obsolete. Use hooks as much as possible! For emotes,
           use emote_hook() and emote_hook_onlooker().
+
+  Every pattern is compiled once when it is added. The compiled form holds
+  the number of arguments of the pattern and the literal words that must
+  be present in a line for parse_command() to match it. A line that lacks
+  one of those words is rejected without calling parse_command(). Patterns
+  with value by function calls (@@) are compiled each time they are used,
+  after process_string(), and are kept in a small cache.
 */
 
 #pragma save_binary
@@ -17,6 +24,20 @@
 
 #define MAX_TRIG_VAR 10
 
+/* The number of processed dynamic patterns we keep compiled. */
+#define MAX_TRIG_CACHE 20
+
+/* Indices into the compiled form of a pattern. */
+#define TRIG_PATTERN  0
+#define TRIG_NUM_ARGS 1
+#define TRIG_WORDS    2
+
+/* Indices into the statistics of a pattern. */
+#define TRIG_LINES    0
+#define TRIG_REJECTED 1
+#define TRIG_PARSED   2
+#define TRIG_MATCHED  3
+
 static 	string	*trig_patterns,		/* Patterns that trig actions */
                 *trig_functions;        /* Commands to execute */
 static  object  *trig_oblist;           /* List of %l / %i objects */
@@ -24,8 +45,84 @@ static  int     num_arg;                /* Number of arguments */
 static	mixed 	a1, a2, a3, a4, a5,
    		a6, a7, a8, a9, a10;	/* Arguments */
 static	string	cur_text;		/* Text currently catched */
+static  mixed   *trig_compiled;         /* Compiled patterns, or 0 if dynamic */
+static  mapping trig_cache = ([ ]);     /* Compiled dynamic patterns */
+static  mapping trig_stats = ([ ]);     /* Statistics per pattern */
 
 mixed trig_check(string str, string pat, string func);
+static mixed trig_check_compiled(string str, mixed compiled, string func);
+
+/*
+ * Function name: trig_compile
+ * Description  : Compiles a pattern. The literal words of the pattern are
+ *                collected, leaving out the %-arguments, the optional words
+ *                in [] and the alternatives separated with /.
+ * Arguments    : string pat - the pattern, after process_string().
+ * Returns      : mixed - ({ pattern, number of arguments, literal words }),
+ *                        or 0 if the pattern is illegal.
+ */
+static mixed
+trig_compile(string pat)
+{
+    string *words, *literals = ({ });
+    string word;
+    int num, index, size;
+
+    num = sizeof(explode("dummy" + pat + "dummy", "%")) - 1;
+    if ((num > MAX_TRIG_VAR) || (num < 1))
+    {
+	return 0; /* Illegal pattern */
+    }
+
+    words = explode(pat, " ") - ({ "" });
+    size = sizeof(words);
+    for (index = 0; index < size; index++)
+    {
+	word = words[index];
+	if ((index > 0) && (words[index - 1] == "/"))
+	    continue;
+	if ((index < (size - 1)) && (words[index + 1] == "/"))
+	    continue;
+	if (strlen(word) > 2 && word[0] == '\'' && word[-1] == '\'')
+	    word = word[1..-2];
+	if (sizeof(explode("x" + word + "x", "%")) > 1 ||
+	    sizeof(explode("x" + word + "x", "[")) > 1 ||
+	    sizeof(explode("x" + word + "x", "]")) > 1 ||
+	    sizeof(explode("x" + word + "x", "/")) > 1 ||
+	    sizeof(explode("x" + word + "x", "'")) > 1)
+	    continue;
+	literals += ({ lower_case(word) });
+    }
+
+    return ({ pat, num, literals });
+}
+
+/*
+ * Function name: trig_compiled_for
+ * Description  : Finds the compiled form of a pattern in the list.
+ * Arguments    : int il - the index of the pattern.
+ * Returns      : mixed - the compiled form, or 0 if the pattern is illegal.
+ */
+static mixed
+trig_compiled_for(int il)
+{
+    string pattern;
+
+    if (pointerp(trig_compiled[il]))
+	return trig_compiled[il];
+
+    /* Value by function call, compile the processed pattern. */
+    pattern = process_string(trig_patterns[il], 1);
+    if (!stringp(pattern))
+	return 0;
+    if (!pointerp(trig_cache[pattern]))
+    {
+	if (m_sizeof(trig_cache) >= MAX_TRIG_CACHE)
+	    trig_cache = ([ ]);
+	trig_cache[pattern] = trig_compile(pattern);
+    }
+    return trig_cache[pattern];
+}
 
 /*
  * Function name: catch_tell
@@ -35,8 +132,9 @@ mixed trig_check(string str, string pat, string func);
 void
 catch_tell(string str)
 {
-    int il;
-    string pattern, func, euid;
+    int il, *stats;
+    string lower;
+    mixed compiled;
 
     if (query_interactive(this_object())) // Monster is possessed
     {
@@ -48,14 +146,38 @@ catch_tell(string str)
 	return;
 
     cur_text = str;
+    lower = lower_case(str);
 
     for (il = 0; il < sizeof(trig_patterns); il++)
     {
-	if (stringp(trig_patterns[il])) 
+	if (!stringp(trig_patterns[il]))
+	    continue;
+
+	stats = trig_stats[trig_patterns[il]];
+	stats[TRIG_LINES]++;
+	if (!pointerp(compiled = trig_compiled_for(il)))
+	    continue;
+
+	/* All literal words must be in the line for it to match. */
+	foreach(string word: compiled[TRIG_WORDS])
 	{
-	    pattern = process_string(trig_patterns[il], 1);
-	    if (trig_check(str, pattern, trig_functions[il]))
-		return;
+	    if (sizeof(explode("x" + lower + "x", word)) < 2)
+	    {
+		compiled = 0;
+		break;
+	    }
+	}
+	if (!compiled)
+	{
+	    stats[TRIG_REJECTED]++;
+	    continue;
+	}
+
+	stats[TRIG_PARSED]++;
+	if (trig_check_compiled(str, compiled, trig_functions[il]))
+	{
+	    stats[TRIG_MATCHED]++;
+	    return;
 	}
     }
 }
@@ -79,21 +201,44 @@ trig_query_args()
 string trig_query_text() { return cur_text; }
 
 
+/*
+ * Function name: trig_check
+ * Description  : Tries to match a line against a pattern, and calls the
+ *                function of the trigger if it matches.
+ * Arguments    : string str - the line.
+ *                string pat - the pattern, after process_string().
+ *                string func - the function to call.
+ * Returns      : mixed - the result of the function, or 0.
+ */
 mixed
 trig_check(string str, string pat, string func)
 {
-    int pmatch;
-    string *split, euid;
+    if (!stringp(pat))
+	return 0;
+
+    return trig_check_compiled(str, trig_compile(pat), func);
+}
+
+/*
+ * Function name: trig_check_compiled
+ * Description  : Like trig_check(), but with a compiled pattern.
+ * Arguments    : string str - the line.
+ *                mixed compiled - the compiled pattern.
+ *                string func - the function to call.
+ * Returns      : mixed - the result of the function, or 0.
+ */
+static mixed
+trig_check_compiled(string str, mixed compiled, string func)
+{
+    int pmatch, num;
+    string pat;
     mixed ob;
 
-    if (!stringp(pat) || !stringp(func))
+    if (!pointerp(compiled) || !stringp(func))
 	return 0;
 
-    split = explode("dummy" + pat + "dummy", "%");
-    if ((sizeof(split) - 1) > MAX_TRIG_VAR)
-    {
-	return 0; /* Illegal pattern */
-    }
+    pat = compiled[TRIG_PATTERN];
+    num = compiled[TRIG_NUM_ARGS];
     
     if (sizeof(trig_oblist))
 	ob = trig_oblist;
@@ -103,7 +248,7 @@ trig_check(string str, string pat, string func)
     if (!ob)
 	return;
 
-    switch (sizeof(split) - 1)
+    switch (num)
     {
     case 1:
 	pmatch = parse_command(str, ob, pat, a1);
@@ -140,14 +285,14 @@ trig_check(string str, string pat, string func)
     if (!pmatch)
 	return 0;
 
-    num_arg = sizeof(split) - 1;
+    num_arg = num;
 
     func = process_string(func, 1);
 
     if (!stringp(func))
 	return func;
 
-    switch (sizeof(split) - 1)
+    switch (num)
     {
     case 1:
 	return call_other(this_object(), func, a1);
@@ -199,9 +344,17 @@ trig_new(string pat, string func)
     {
 	trig_patterns = ({});
 	trig_functions = ({});
+	trig_compiled = ({});
     }
     trig_patterns += ({ pat });
     trig_functions += ({ func });
+    /* Patterns with value by function calls are compiled when used. */
+    if (stringp(pat) && (sizeof(explode("x" + pat + "x", "@@")) < 2))
+	trig_compiled += ({ trig_compile(pat) });
+    else
+	trig_compiled += ({ 0 });
+    if (stringp(pat) && !pointerp(trig_stats[pat]))
+	trig_stats[pat] = ({ 0, 0, 0, 0 });
 }
 
 /*
@@ -216,6 +369,9 @@ trig_delete(string pat)
     {
 	trig_patterns = exclude_array(trig_patterns, pos, pos);
 	trig_functions = exclude_array(trig_functions, pos, pos);
+	trig_compiled = exclude_array(trig_compiled, pos, pos);
+	if (member_array(pat, trig_patterns) < 0)
+	    m_delkey(trig_stats, pat);
     }
 }
 
@@ -228,6 +384,74 @@ trig_setobjects(object *obs)
     trig_oblist = obs;
 }
 
+/*
+ * Function name: trig_query_stats
+ * Description  : Returns the statistics of the triggers of this NPC.
+ * Returns      : mapping - ([ pattern : ({ lines, rejected, parsed,
+ *                              matched }) ]), where rejected is the number
+ *                              of lines the compiled pattern rejected
+ *                              without calling parse_command().
+ */
+public mapping
+trig_query_stats()
+{
+    mapping result = ([ ]);
+
+    foreach(string pattern, int *stats: trig_stats)
+    {
+	result[pattern] = stats + ({ });
+    }
+    return result;
+}
+
+/*
+ * Function name: trig_sort_hot
+ * Description  : Sorts the patterns with the most calls to parse_command()
+ *                first.
+ * Arguments    : string a, b - the patterns to compare.
+ * Returns      : int - -1, 0 or 1.
+ */
+static int
+trig_sort_hot(string a, string b)
+{
+    int diff = trig_stats[b][TRIG_PARSED] - trig_stats[a][TRIG_PARSED];
+
+    return ((diff > 0) ? 1 : ((diff < 0) ? -1 : 0));
+}
+
+/*
+ * Function name: trig_report
+ * Description  : Lists the hottest triggers of this NPC, being the ones
+ *                that called parse_command() most often.
+ * Arguments    : int num - the number of triggers to list, default 10.
+ * Returns      : string - the report.
+ */
+public varargs string
+trig_report(int num)
+{
+    string *patterns;
+    string str;
+    int *stats;
+
+    if (num <= 0)
+	num = 10;
+
+    patterns = sort_array(m_indexes(trig_stats), trig_sort_hot);
+    if (sizeof(patterns) > num)
+	patterns = patterns[..(num - 1)];
+
+    str = sprintf("%8s %8s %8s %8s  %s\n", "Lines", "Rejected", "Parsed",
+	"Matched", "Pattern");
+    foreach(string pattern: patterns)
+    {
+	stats = trig_stats[pattern];
+	str += sprintf("%8d %8d %8d %8d  %s\n", stats[TRIG_LINES],
+	    stats[TRIG_REJECTED], stats[TRIG_PARSED], stats[TRIG_MATCHED],
+	    pattern);
+    }
+    return str;
+}
+
 /* This #if 0 makes that the routine isn't actually defined in the living, but
  * it is documented in sman. The reaosn for this is that it's faster to handle
  * at runtime if the routine doesn't exist than if it's empty.
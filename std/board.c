@@ -22,6 +22,10 @@
  *                           This hides the board for tools.
  * set_keep_discarded(n) 0 = don't keep old notes (default).
  *			 1 = keep old notes.
+ * set_indexed_store(n)	 0 = keep every note in its own file (default).
+ *			 1 = keep all notes in a single data file with an
+ *			     index. Existing notes are converted when the
+ *			     board is loaded.
  *
  * There are three functions you can use to restrict usage of the board.
  * Independantly of the 'normal' access rules these functions can be used
@@ -55,6 +59,14 @@
  * date    ( 9) 69..77 ("dd mmm yy" e.g. "30 Jun 12")
  *
  * During display, the rank length is abbreviated to 7 characters.
+ *
+ * The indexed store keeps the bodies of all notes in the file "notes" in
+ * the board directory. Notes are only ever appended to that file. The file
+ * "index.o" holds the headers of the notes and the offset and length of
+ * each body, so the headers can be loaded with a single read and a body is
+ * only read when someone reads the note. Removed notes leave unused bytes in
+ * the data file, which is compacted when more than half of it is unused.
+ * See <mbs.h> for the format of the index.
  */
 
 #pragma save_binary
@@ -64,6 +76,7 @@ inherit "/std/object";
 
 #include <files.h>
 #include <macros.h>
+#include <mbs.h>
 #include <std.h>
 #include <stdproperties.h>
 #include <time.h>
@@ -85,6 +98,9 @@ inherit "/std/object";
 #define READ_STAT	   0
 #define WRITE_STAT	   1
 
+/* Don't bother to compact the data file when it wastes less than this. */
+#define MIN_COMPACT_BYTES  10000
+
 /*
  * Global variables. They are not savable, the first two are private too,
  * which means that people cannot dump them.
@@ -92,6 +108,8 @@ inherit "/std/object";
 static private mixed   headers = ({ });
 static private mapping writing = ([ ]);
 static private int     *stats = ({ 0, 0 });
+static private mapping store_notes = ([ ]);
+static private int     store_dead = 0;
 
 static string  board_name = "";
 static string  remove_str = "Only a Lord or higher can remove other peoples notes.\n";
@@ -103,6 +121,7 @@ static int     remove_rank = WIZ_LORD;
 static int     show_lvl = 1;
 static int     no_report = 0;
 static int     fuse = 0;
+static int     indexed_store = 0;
 
 /*
  * Prototypes.
@@ -241,6 +260,30 @@ set_keep_discarded(int n)
     keep_discarded = (fuse ? keep_discarded : (n ? 1 : 0));
 }
 
+/*
+ * Function name: set_indexed_store
+ * Description  : Set this if you want the notes to be kept in a single
+ *                indexed data file rather than in a file per note. When
+ *                the board is loaded, notes in the old format are converted.
+ * Arguments    : int n - true to use the indexed store (default: false)
+ */
+public nomask void
+set_indexed_store(int n)
+{
+    indexed_store = (fuse ? indexed_store : (n ? 1 : 0));
+}
+
+/*
+ * Function name: query_indexed_store
+ * Description  : Find out whether the board uses the indexed store.
+ * Returns      : int - if true, the indexed store is used.
+ */
+public int
+query_indexed_store()
+{
+    return indexed_store;
+}
+
 /*
  * Function name: query_author
  * Description  : Return the name of the author of a certain note. Observe
@@ -432,6 +475,239 @@ check_remove(int note = 0)
             !allow_remove(note));
 }
 
+/*
+ * Function name: save_store
+ * Description  : Save the index of the indexed store.
+ */
+private nomask void
+save_store()
+{
+    seteuid(getuid());
+
+    save_map(([ BOARD_STORE_NOTES : store_notes,
+                BOARD_STORE_DEAD  : store_dead ]),
+        board_name + "/" + BOARD_STORE_INDEX);
+}
+
+/*
+ * Function name: append_store
+ * Description  : Append the body of a note to the data file of the indexed
+ *                store and add the note to the index. The index is not
+ *                saved.
+ * Arguments    : string fname - the name of the note, "b<time>".
+ *                string head  - the (abbreviated) header of the note.
+ *                string body  - the message body.
+ * Returns      : int 1/0 - success/failure.
+ */
+private nomask int
+append_store(string fname, string head, string body)
+{
+    string data = board_name + "/" + BOARD_STORE_DATA;
+    int    offset = file_size(data);
+
+    if (offset < 0)
+	offset = 0;
+
+    if (strlen(body) &&
+	!write_file(data, body))
+    {
+	return 0;
+    }
+
+    store_notes[fname] = ({ head, offset, strlen(body) });
+    return 1;
+}
+
+/*
+ * Function name: read_store
+ * Description  : Read the body of a note from the data file of the indexed
+ *                store.
+ * Arguments    : string fname - the name of the note, "b<time>".
+ * Returns      : string - the body, or 0 if the note is not in the store.
+ */
+private nomask string
+read_store(string fname)
+{
+    mixed entry = store_notes[fname];
+
+    if (!pointerp(entry))
+	return 0;
+
+    if (!entry[BSN_LENGTH])
+	return "";
+
+    seteuid(getuid());
+
+    return read_bytes(board_name + "/" + BOARD_STORE_DATA, entry[BSN_OFFSET],
+	entry[BSN_LENGTH]);
+}
+
+/*
+ * Function name: compact_store
+ * Description  : Rewrite the data file of the indexed store without the
+ *                bodies of the notes that were removed. When something
+ *                goes wrong, the old data file is left alone. The new
+ *                index is saved right away.
+ */
+private nomask void
+compact_store()
+{
+    string  data = board_name + "/" + BOARD_STORE_DATA;
+    string  temp = data + ".new";
+    string  body;
+    mapping compacted = ([ ]);
+    int     offset;
+
+    seteuid(getuid());
+
+    rm(temp);
+    foreach(string fname, mixed entry: store_notes)
+    {
+	body = read_store(fname);
+	if (!stringp(body) ||
+	    (strlen(body) && !write_file(temp, body)))
+	{
+	    rm(temp);
+	    return;
+	}
+
+	compacted[fname] = ({ entry[BSN_HEADER], offset, strlen(body) });
+	offset += strlen(body);
+    }
+
+    rm(data);
+    if (offset)
+	rename(temp, data);
+
+    store_notes = compacted;
+    store_dead = 0;
+
+    /* The offsets in the old index no longer match the data file. */
+    save_store();
+}
+
+/*
+ * Function name: drop_store
+ * Description  : Remove a note from the index of the indexed store. The
+ *                data file is compacted when more than half of it is no
+ *                longer used. The index is not saved.
+ * Arguments    : string fname - the name of the note, "b<time>".
+ */
+private nomask void
+drop_store(string fname)
+{
+    int live;
+
+    if (!pointerp(store_notes[fname]))
+	return;
+
+    store_dead += store_notes[fname][BSN_LENGTH];
+    m_delkey(store_notes, fname);
+
+    if (store_dead < MIN_COMPACT_BYTES)
+	return;
+
+    foreach(string name, mixed entry: store_notes)
+	live += entry[BSN_LENGTH];
+
+    if (store_dead > live)
+	compact_store();
+}
+
+/*
+ * Function name: convert_store
+ * Description  : Move notes from the old format, a file per note, into the
+ *                indexed store. A file is only removed after the index
+ *                with its note has been saved.
+ * Arguments    : string *files - the note files, "b<time>".
+ */
+private nomask void
+convert_store(string *files)
+{
+    string *done = ({ });
+    string text;
+    string head;
+    string body;
+
+    foreach(int number: sort_array(map(files, &atoi() @ &extract(, 1))))
+    {
+	/* Never overwrite a note that is in the store already. */
+	if (!number ||
+	    pointerp(store_notes["b" + number]) ||
+	    !stringp(text = read_file(board_name + "/b" + number)))
+	{
+	    continue;
+	}
+
+	body = "";
+	if (!sscanf(text, "%s\n%s", head, body))
+	    continue;
+
+	if (append_store("b" + number, abbreviate_rank(head), body))
+	    done += ({ "b" + number });
+    }
+
+    if (!sizeof(done))
+	return;
+
+    save_store();
+    foreach(string file: done)
+	rm(board_name + "/" + file);
+
+    SECURITY->log_syslog("BOARD", ctime(time()) + ": Converted " +
+	sizeof(done) + " notes on " + board_name + " to the indexed store.\n",
+	100000);
+}
+
+/*
+ * Function name: load_store
+ * Description  : Load the headers from the index of the indexed store. Any
+ *                notes in the old format are converted first.
+ * Arguments    : string *files - the note files in the old format.
+ */
+private nomask void
+load_store(string *files)
+{
+    mapping index;
+
+    if (file_size(board_name + "/" + BOARD_STORE_INDEX + ".o") > 0)
+    {
+	index = restore_map(board_name + "/" + BOARD_STORE_INDEX);
+	store_notes = (mappingp(index[BOARD_STORE_NOTES]) ?
+	    index[BOARD_STORE_NOTES] : ([ ]));
+	store_dead = index[BOARD_STORE_DEAD];
+    }
+
+    if (sizeof(files))
+	convert_store(files);
+
+    headers = ({ });
+    foreach(int number: sort_array(map(m_indexes(store_notes),
+	&atoi() @ &extract(, 1))))
+    {
+	headers += ({ ({ store_notes["b" + number][BSN_HEADER],
+	    "b" + number }) });
+    }
+    msg_num = sizeof(headers);
+}
+
+/*
+ * Function name: read_body
+ * Description  : Read the body of a note, without the header.
+ * Arguments    : int note - the index of the note in the headers.
+ * Returns      : string - the body of the note.
+ */
+private nomask string
+read_body(int note)
+{
+    seteuid(getuid());
+
+    if (indexed_store)
+	return read_store(headers[note][1]);
+
+    return read_file(board_name + "/" + headers[note][1], 2);
+}
+
 /*
  * Function name: load_headers
  * Description  : Load the headers when the board is created. This is done
@@ -453,6 +729,12 @@ load_headers()
     seteuid(getuid());
 
     notes = get_dir(board_name + "/b*");
+    if (indexed_store)
+    {
+        load_store(notes);
+        return;
+    }
+
     msg_num = sizeof(notes);
     if (msg_num)
     {
@@ -869,10 +1151,21 @@ discard_message(string file)
 	if (file_size(board_name + "_old") == -1)
 	    mkdir(board_name + "_old");
 
-	rename(board_name + "/" + file, board_name + "_old/" + file);
+	/* Old notes are always kept in a file per note. */
+	if (indexed_store)
+	{
+	    if (pointerp(store_notes[file]))
+		write_file(board_name + "_old/" + file,
+		    store_notes[file][BSN_HEADER] + "\n" + read_store(file));
+	}
+	else
+	    rename(board_name + "/" + file, board_name + "_old/" + file);
     }
-    else
+    else if (!indexed_store)
 	rm(board_name + "/" + file);
+
+    if (indexed_store)
+	drop_store(file);
 }
 
 /*
@@ -894,8 +1187,9 @@ post_note_hook(string head)
  *                stores it to disk and notifies the board master.
  * Arguments    : string head    - the header of the note.
  *                string message - the message body.
+ * Returns      : int 1/0 - success/failure.
  */
-private nomask void
+private nomask int
 post_note(string head, string message)
 {
     string fname;
@@ -917,11 +1211,19 @@ post_note(string head, string message)
 
     /* Check that the message file isn't used yet. */
     fname = "b" + (t = time());
-    while(file_size(board_name + "/" + fname) != -1)
+    while((file_size(board_name + "/" + fname) != -1) ||
+	pointerp(store_notes[fname]))
 	fname = "b" + (++t);
 
     /* Write the message to disk and update the headers. */
-    write_file(board_name + "/" + fname, head + "\n" + message);
+    if (indexed_store)
+    {
+	if (!append_store(fname, abbreviate_rank(head), message))
+	    return 0;
+	save_store();
+    }
+    else if (!write_file(board_name + "/" + fname, head + "\n" + message))
+	return 0;
     headers += ({ ({ abbreviate_rank(head), fname }) });
     msg_num++;
 
@@ -932,6 +1234,7 @@ post_note(string head, string message)
     stats[WRITE_STAT]++;
 
     post_note_hook(head);
+    return 1;
 }
 
 /*
@@ -972,7 +1275,12 @@ done_editing(string message)
 	writing[this_player()][AUTHOR_BEGIN..];
     m_delkey(writing, this_player());
 
-    post_note(head, message);
+    if (!post_note(head, message))
+    {
+	write("Your note could not be stored! No note posted. " +
+	    "Please report this!\n");
+	return 0;
+    }
 
     write("Ok.\n");
     return 1;
@@ -1049,7 +1357,8 @@ create_note(string header, string author, string body)
 	sizeof(explode(body, "\n")), capitalize(author)) +
 	(show_lvl ? "           " : " ") + TIME2FORMAT(time(), "-d mmm");
 
-    post_note(head, body);
+    if (!post_note(head, body))
+	return 0;
 
     tell_room(environment(), "You suddenly notice a note on the " +
 	short() + " that you did not see before.\n");
@@ -1136,10 +1445,10 @@ read_msg(string what_msg, int mr)
     text = headers[note][0] + " " +
         TIME2FORMAT(atoi(headers[note][1][1..]), "yyyy") + "\n\n";
     if (mr)
-	this_player()->more(text + read_file(board_name + "/" + headers[note][1], 2));
+	this_player()->more(text + read_body(note));
     else
     {
-	write(text + read_file(board_name + "/" + headers[note][1], 2));
+	write(text + read_body(note));
     }
 
     /* Update the master board central unless that has been prohibited. */
@@ -1203,6 +1512,9 @@ remove_msg(string what_msg)
     headers = exclude_array(headers, note, note);
     msg_num--;
 
+    if (indexed_store)
+	save_store();
+
     if ((note == msg_num) &&
 	(!no_report))
         BOARD_CENTRAL->remove_note(board_name);
@@ -1291,10 +1603,18 @@ rename_msg(string str)
     num--;
     headers[num][0] = headers[num][0][..45] +
 	sprintf("%-11s", capitalize(name)) + headers[num][0][57..];
-    note = headers[num][0] + "\n" +
-	read_file(board_name + "/" + headers[num][1], 2);
-    rm(board_name + "/" + headers[num][1]);
-    write_file(board_name + "/" + headers[num][1], note);
+    if (indexed_store)
+    {
+	/* The header is only kept in the index. */
+	store_notes[headers[num][1]][BSN_HEADER] = headers[num][0];
+	save_store();
+    }
+    else
+    {
+	note = headers[num][0] + "\n" + read_body(num);
+	rm(board_name + "/" + headers[num][1]);
+	write_file(board_name + "/" + headers[num][1], note);
+    }
 
     write("Author on note " + (++num) + " changed from " +
 	capitalize(this_player()->query_real_name()) + " to " +
@@ -1348,8 +1668,7 @@ store_msg(string str)
     }
 
     note--;
-    str = (headers[note][0] + "\n\n" +
-	   read_file((board_name + "/" + headers[note][1]), 2));
+    str = (headers[note][0] + "\n\n" + read_body(note));
     EDITOR_SECURITY->board_write(file, str);
 
     /* We always return 1 because we don't want other commands to be
@@ -21,6 +21,7 @@
 #include <cmdparse.h>
 #include <comb_mag.h>
 #include <composite.h>
+#include <files.h>
 #include <filter_funs.h>
 #include <formulas.h>
 #include <hooks.h>
@@ -84,7 +85,6 @@ static int    *att_id = ({}),    /* Id's for attacks */
               panic_time,        /* Time panic last checked. */
               tohit_val,         /* A precalculated tohit value for someone */
               i_am_real,         /* True if the living object is interactive */
-              alarm_id,          /* The id of the heart_beat alarm */
               combat_time,       /* The last time a hit was made. */
               tohit_mod,         /* Bonus/Minus to the tohit value */
               acro_evade;        /* Evade value due to SS_ACROBAT */
@@ -97,7 +97,8 @@ static mixed  *attacks = ({}),   /* Array of each attack */
 
 static object me,                /* The living object concerned */
               *enemies = ({}),   /* Array holding all living I hunt */
-              attack_ob;         /* Object to attack == Current enemy. */
+              attack_ob,         /* Object to attack == Current enemy. */
+              scheduler;         /* The scheduler running our rounds. */
 
 static mapping dam_by_dt = ([ ]); /* ([ int dt : int cumulative damage ]) */
 
@@ -1712,15 +1713,12 @@ cb_query_speed()
 public nomask void
 cb_update_speed()
 {
-    mixed alarm;
     float oldspeed = speed;
 
     cb_calc_speed();
-    if ((speed != oldspeed) && alarm_id && (alarm = get_alarm(alarm_id)))
+    if ((speed != oldspeed) && objectp(scheduler))
     {
-        float next = speed * (alarm[2] / alarm[3]);
-        remove_alarm(alarm_id);
-        alarm_id = set_alarm(next, speed, heart_beat);
+        scheduler->update_round_speed(oldspeed, speed);
     }
 }
 
@@ -1734,30 +1732,82 @@ restart_heart()
     /* Mark this moment as being in combat. */
     cb_update_combat_time();
 
-    if (!alarm_id || !get_alarm(alarm_id))
+    if (!objectp(scheduler))
     {
-        cb_update_speed();
-        alarm_id = set_alarm(speed, speed, heart_beat);
+        cb_calc_speed();
+        COMBAT_SCHEDULER->schedule_round(speed);
+        scheduler = find_object(COMBAT_SCHEDULER);
     }
 }
 
+/*
+ * Function name: cb_scheduler_rejoin
+ * Description  : Registers our rounds again with a new combat scheduler.
+ * Arguments    : float delay - the time until our next round.
+ */
+static void
+cb_scheduler_rejoin(float delay)
+{
+    /* Restarted by an attack in the meantime. */
+    if (objectp(scheduler))
+        return;
+
+    COMBAT_SCHEDULER->schedule_round(speed, delay);
+    scheduler = find_object(COMBAT_SCHEDULER);
+}
+
+/*
+ * Function name: cb_scheduler_handover
+ * Description  : Called from the combat scheduler when it is destructed, so
+ *                that we register with the new scheduler once it is gone.
+ * Arguments    : float delay - the time until our next round.
+ */
+public nomask void
+cb_scheduler_handover(float delay)
+{
+    if (file_name(previous_object()) != COMBAT_SCHEDULER)
+        return;
+
+    scheduler = 0;
+    set_alarm(0.0, 0.0, &cb_scheduler_rejoin(delay));
+}
+
 /*
  * Function name: stop_heart
- * Description  : Called to stop the heartbeat. It will remove the running
- *                alarm.
+ * Description  : Called to stop the heartbeat. It will take us out of the
+ *                combat scheduler.
  */
 static void
 stop_heart()
 {
     me->remove_prop(LIVE_I_ATTACK_DELAY);
-    remove_alarm(alarm_id);
-    alarm_id = 0;
+    if (objectp(scheduler))
+    {
+        scheduler->unschedule_round();
+        scheduler = 0;
+    }
 
     /* Garbage collection. */
     if (!objectp(me))
         remove_object();
 }
 
+/*
+ * Function name: cb_combat_round
+ * Description  : Called from the combat scheduler when our next round is
+ *                due. See /sys/global/combat_scheduler.c
+ */
+public nomask void
+cb_combat_round()
+{
+    if (previous_object() != scheduler)
+    {
+        return;
+    }
+
+    heart_beat();
+}
+
 /*
  * Function name: heart_beat
  * Description:   Do 1 round of fighting with the choosen enemy. This is
@@ -10,6 +10,7 @@
 inherit "/std/object";
 inherit "/lib/keep";
 
+#include <files.h>
 #include <macros.h>
 #include <stdproperties.h>
 #include <composite.h>
@@ -29,6 +30,18 @@ static  int       cont_cur_light, /* The current light status in cont. */
                   cont_cur_volume,
                   cont_block_prop;
 
+/*
+ * While a move is in progress, the changes to the internal state are not
+ * passed on to our environment immediately, but collected and passed on
+ * once when the move is done. See batch_internal().
+ */
+static  int       cont_batch,       /* Number of batches in progress */
+                  cont_batch_time,  /* Time the batch started */
+                  cont_batch_eval,  /* Evaluation cost when it started */
+                  cont_pend_light,  /* Changes not passed on yet */
+                  cont_pend_weight,
+                  cont_pend_volume;
+
 static  mapping   cont_sublocs,    /* Map of sublocations and the object res-
                                       ponsible for the subloc, in container */
                   cont_subloc_ids; /* Map of sublocation ids to sublocation */
@@ -39,6 +52,9 @@ static  mapping   cont_sublocs,    /* Map of sublocations and the object res-
  */
 static mapping container_objects;
 
+/* The props we want objects in our inventory to tell us about. */
+static mapping cont_prop_interest;
+
 
 /*
  * Prototypes
@@ -47,6 +63,8 @@ void create_container();
 void reset_container();
 void reset_auto_objects();
 void update_internal(int l, int w, int v);
+static void flush_internal();
+static int  batch_stale();
 public int light();
 public nomask int weight();
 public nomask int volume();
@@ -373,13 +391,89 @@ leave_env(object from, object to)
 public void
 update_internal(int l, int w, int v)
 {
-    object ob, env;
-
     cont_cur_light += l;
     cont_cur_weight += w;
     cont_cur_volume += v;
 
-    if (!(env = environment()))
+    cont_pend_light += l;
+    cont_pend_weight += w;
+    cont_pend_volume += v;
+
+    if (!cont_batch || batch_stale())
+    {
+        cont_batch = 0;
+        flush_internal();
+    }
+}
+
+/*
+ * Function name: batch_stale
+ * Description  : Find out whether the batch in progress belongs to an
+ *                earlier execution, in which it was never closed due to an
+ *                error. The evaluation cost counter starts over with every
+ *                execution, so a batch started at a higher count, or in a
+ *                different second, is stale.
+ * Returns      : int 1/0 - stale or not.
+ */
+static int
+batch_stale()
+{
+    return ((cont_batch_time != time()) ||
+        (cont_batch_eval > SECURITY->do_debug("get_eval_cost")));
+}
+
+/*
+ * Function name: batch_internal
+ * Description  : Starts or ends a batch of changes to the internal state.
+ *                During a batch, the changes are only collected, and when
+ *                the last batch ends, they are passed on to the environment
+ *                at once. This is used by move() in /std/object.c, so the
+ *                changes of an object leaving and entering are passed up
+ *                once, and changes that cancel out are not passed up at all.
+ *                Code moving many objects at once may use it as well. A
+ *                batch that is not closed due to an error is dropped in the
+ *                next execution, see batch_stale().
+ * Arguments    : int begin - true to start a batch, false to end it.
+ */
+public void
+batch_internal(int begin)
+{
+    if (begin)
+    {
+        if (cont_batch && batch_stale())
+            cont_batch = 0;
+
+        if (!cont_batch++)
+        {
+            cont_batch_time = time();
+            cont_batch_eval = SECURITY->do_debug("get_eval_cost");
+        }
+        return;
+    }
+
+    if ((cont_batch > 0) && !(--cont_batch))
+        flush_internal();
+}
+
+/*
+ * Function name: flush_internal
+ * Description  : Passes the collected changes to the internal state on to
+ *                our environment.
+ */
+static void
+flush_internal()
+{
+    object env;
+    int l = cont_pend_light;
+    int w = cont_pend_weight;
+    int v = cont_pend_volume;
+
+    cont_pend_light = 0;
+    cont_pend_weight = 0;
+    cont_pend_volume = 0;
+
+    if (!(l || w || v) ||
+        !(env = environment()))
         return;
 
     /*
@@ -404,6 +498,75 @@ update_internal(int l, int w, int v)
                 v * 100 / env->query_prop(CONT_I_REDUCE_VOLUME));
 }
 
+/*
+ * Function name: query_internal_state
+ * Description  : Returns the accumulated light, weight and volume of the
+ *                objects in this container.
+ * Returns      : int * - ({ light, weight, volume })
+ */
+public int *
+query_internal_state()
+{
+    return ({ cont_cur_light, cont_cur_weight, cont_cur_volume });
+}
+
+/*
+ * Function name: check_internal
+ * Description  : Recomputes the light, weight and volume of the objects in
+ *                this container from scratch and compares them with the
+ *                accumulated values. This is meant for testing the
+ *                bookkeeping of update_internal(). Note that containers
+ *                that reduce the weight or volume of their contents may
+ *                differ slightly due to rounding.
+ * Arguments    : int recursive - if true, check the containers inside too.
+ *                int repair - if true, correct the values that differ.
+ * Returns      : mapping - ([ container : ({ *accumulated, *computed }) ])
+ *                    for every container with different values.
+ */
+public varargs mapping
+check_internal(int recursive, int repair)
+{
+    mapping result = ([ ]);
+    int *state, *sum = ({ 0, 0, 0 });
+    int rw, rv;
+
+    if (cont_linkroom)
+        return result;
+
+    rw = query_prop(CONT_I_REDUCE_WEIGHT);
+    rv = query_prop(CONT_I_REDUCE_VOLUME);
+    foreach(object ob: all_inventory())
+    {
+        if (recursive && function_exists("check_internal", ob))
+            result += ob->check_internal(recursive, repair);
+
+        sum[0] += ob->query_prop(OBJ_I_LIGHT);
+        sum[1] += ob->query_prop(OBJ_I_WEIGHT);
+        sum[2] += ob->query_prop(OBJ_I_VOLUME);
+
+        /* The contents of a container count reduced. */
+        if (pointerp(state = ob->query_internal_state()))
+        {
+            sum[1] += (state[1] * 100 / rw) - state[1];
+            if (!ob->query_prop(CONT_I_RIGID))
+                sum[2] += (state[2] * 100 / rv) - state[2];
+        }
+    }
+
+    state = query_internal_state();
+    if ((state[0] != sum[0]) || (state[1] != sum[1]) || (state[2] != sum[2]))
+    {
+        result[this_object()] = ({ state, sum });
+        if (repair)
+        {
+            update_internal(sum[0] - state[0], sum[1] - state[1],
+                sum[2] - state[2]);
+        }
+    }
+
+    return result;
+}
+
 /*
  * Function name: update_light
  * Description:   Reevalueate the lightvalue of the container.
@@ -425,6 +588,31 @@ update_light(int recursive)
     }
 }
 
+/*
+ * Function name: query_prop_interest
+ * Description  : Objects in our inventory ask this once after they moved
+ *                here, to find out for which properties they should call
+ *                notify_change_prop() in us. See /std/object.c.
+ * Returns      : mapping - ([ prop : 1 ]) for the interesting props, or 0
+ *                    if we want to know about all props.
+ */
+public mapping
+query_prop_interest()
+{
+    if ((function_exists("notify_change_prop", this_object()) !=
+        CONTAINER_OBJECT) || shadowed_function("notify_change_prop"))
+        return 0;
+
+    /* Shared by all objects in our inventory. */
+    if (!mappingp(cont_prop_interest))
+        cont_prop_interest = ([ CONT_I_LIGHT : 1, OBJ_I_LIGHT : 1,
+            CONT_I_WEIGHT : 1, OBJ_I_WEIGHT : 1, CONT_I_VOLUME : 1,
+            OBJ_I_VOLUME : 1, CONT_I_ATTACH : 1, CONT_I_TRANSP : 1,
+            CONT_I_CLOSED : 1 ]);
+
+    return cont_prop_interest;
+}
+
 /*
  * Function name: notify_change_prop
  * Description:   This function is called when a property in an object
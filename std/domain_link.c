@@ -17,6 +17,8 @@
  * Global variables.
  */
 private static string *gPreload  = ({ });
+private static string *gDeferred = ({ });
+private static mapping gDepends  = ([ ]);
 private static mapping commodity = ([ ]);
 
 /*
@@ -34,13 +36,39 @@ create()
  * Function name: preload
  * Description  : This function should be called from the preload_link()
  *                function of the domain. It enables the domain to load some
- *                modules at boot time.
+ *                modules at boot time. Files that must be loaded before
+ *                this file can be named, also when they are in another
+ *                domain, and the master will load them first.
  * Arguments    : string file - the filename of the file to preload.
+ *                mixed after - the file or files to load first.
  */
-nomask void
-preload(string file)
+nomask varargs void
+preload(string file, mixed after)
 {
     gPreload += ({ file });
+
+    if (stringp(after))
+    {
+        after = ({ after });
+    }
+    if (sizeof(after))
+    {
+        gDepends[file] = (pointerp(gDepends[file]) ? gDepends[file] : ({ })) +
+            after;
+    }
+}
+
+/*
+ * Function name: preload_deferred
+ * Description  : Like preload(), but for files that are not needed before
+ *                the players may log in. They are loaded in the background
+ *                after the game started.
+ * Arguments    : string file - the filename of the file to preload.
+ */
+nomask void
+preload_deferred(string file)
+{
+    gDeferred += ({ file });
 }
 
 /*
@@ -54,6 +82,29 @@ query_preload()
     return secure_var(gPreload);
 }
 
+/*
+ * Function name: query_preload_depends
+ * Description  : Get the files that must be loaded before the preload
+ *                files.
+ * Returns      : mapping - ([ file : ({ files to load first }) ])
+ */
+public nomask mapping
+query_preload_depends()
+{
+    return secure_var(gDepends);
+}
+
+/*
+ * Function name: query_preload_deferred
+ * Description  : Get the list of files to preload after the game started.
+ * Returns      : string * - the list of files.
+ */
+public nomask string *
+query_preload_deferred()
+{
+    return secure_var(gDeferred);
+}
+
 /*
  * Function name : add_commodity
  * Description   : function would add a commodity to the domain mapping
@@ -102,7 +153,7 @@ query_commodities()
  * Function name: preload_link
  * Description  : This function should be masked by domains that want to
  *                preload some files at boot time. It should contain only
- *                calls to the function preload().
+ *                calls to the functions preload() and preload_deferred().
  */
 public void
 preload_link()
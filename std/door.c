@@ -1509,6 +1509,7 @@ add_door_info(object dest)
 
     dest->add_prop(ROOM_AS_DOORID, door_ids);
     dest->add_prop(ROOM_AO_DOOROB, doors);
+    ROOM_GRAPH->invalidate_room(dest);
 }
 
 /*
@@ -1538,6 +1539,7 @@ remove_door_info(object dest)
 
     dest->add_prop(ROOM_AS_DOORID, door_ids);
     dest->add_prop(ROOM_AO_DOOROB, doors);
+    ROOM_GRAPH->invalidate_room(dest);
 }
 
 /*
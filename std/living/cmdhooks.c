@@ -20,6 +20,10 @@ static string   *wiz_souls,             /* The wizard soul names */
                 *soul_souls,            /* The ordinary soul names */
                 *tool_souls,            /* The tool soul names */
                 say_string;             /* The last message said */
+static private mapping cmd_index;       /* The verb index of our souls */
+static private int cmd_index_commands,  /* Commands resolved by the index */
+                   cmd_index_saved,     /* exist_command calls saved */
+                   cmd_index_loading;   /* All souls are being loaded */
 
 /*
  * Prototypes
@@ -259,6 +263,22 @@ query_wizsoul_list()
     return secure_var(wiz_souls);
 }
 
+/*
+ * Function name: update_cmd_index
+ * Description  : Fetches the verb index for the souls we have now. While
+ *                update_hooks() loads all souls, this is only done once
+ *                they are all loaded.
+ */
+static nomask void
+update_cmd_index()
+{
+    if (cmd_index_loading)
+        return;
+
+    cmd_index = SOUL_INDEX->query_verb_index(wiz_souls, tool_souls,
+        soul_souls);
+}
+
 /*
  * Function name:   load_wiz_souls
  * Description:     Load the wizard souls into the player.
@@ -283,12 +303,14 @@ load_wiz_souls()
     else
     {
         wiz_souls = ({ });
+        update_cmd_index();
         return 1;
     }
 
     if (!sizeof(wiz_souls))
     {
         write("Error loading wizard soul list. No wizard soul loaded.\n");
+        update_cmd_index();
         return 0;
     }
 
@@ -301,6 +323,7 @@ load_wiz_souls()
     }
 
     wiz_souls = start_souls(wiz_souls);
+    update_cmd_index();
     return 1;
 }
 
@@ -320,6 +343,7 @@ load_command_souls()
 
     soul_souls = start_souls(soul_souls);
     update_cmdsoul_list(soul_souls);
+    update_cmd_index();
     return 1;
 }
 
@@ -335,6 +359,7 @@ load_tool_souls()
         !interactive(this_object()))
     {
         tool_souls = ({});
+        update_cmd_index();
         return 0;
     }
 
@@ -348,9 +373,102 @@ load_tool_souls()
 
     tool_souls = start_souls(tool_souls);
     update_tool_list(tool_souls);
+    update_cmd_index();
     return 1;
 }
 
+/*
+ * Function name: index_commands
+ * Description  : Try to find and perform a command using the verb index.
+ *                Only the souls that define the verb are called, in the
+ *                same order as my_commands() would search them.
+ * Arguments    : string verb - the verb.
+ *                string str - the argument string.
+ * Returns      : int 1/0 - command found or not.
+ */
+static int
+index_commands(string verb, string str)
+{
+    mixed  *souls = cmd_index[verb];
+    int    size = sizeof(souls);
+    int    wizard = query_wiz_level();
+    int    skipped = (wizard ? 0 : (sizeof(wiz_souls) + sizeof(tool_souls)));
+    int    i, rv;
+    object ob;
+
+    cmd_index_commands++;
+
+    i = -1;
+    while(++i < size)
+    {
+        /* Don't waste the wiz-souls and toolsouls on mortals. */
+        if (!wizard && (souls[i][SOUL_INDEX_KIND] != SOUL_KIND_CMD))
+        {
+            continue;
+        }
+
+        ob = find_object(souls[i][SOUL_INDEX_PATH]);
+        if (!ob)
+        {
+            if (catch(souls[i][SOUL_INDEX_PATH]->teleledningsanka()))
+                tell_object(this_object(),
+                    "Yikes, baaad soul: " + souls[i][SOUL_INDEX_PATH] + "\n");
+            ob = find_object(souls[i][SOUL_INDEX_PATH]);
+            if (!ob)
+                continue;
+        }
+
+        if (souls[i][SOUL_INDEX_KIND] == SOUL_KIND_CMD)
+        {
+            rv = ob->do_command(verb, str);
+        }
+        else
+        {
+            ob->open_soul(0);
+            export_uid(ob);
+            ob->open_soul(1);
+            rv = ob->do_command(verb, str);
+            ob->open_soul(0);
+            if (SECURITY->query_restrict(query_real_name()) &
+                RESTRICT_LOG_COMMANDS)
+                SECURITY->log_restrict(verb, str);
+        }
+
+        if (rv)
+        {
+            cmd_index_saved += souls[i][SOUL_INDEX_POS] - skipped;
+            return 1;
+        }
+    }
+
+    /* The old search would have asked every soul. */
+    cmd_index_saved += sizeof(soul_souls) +
+        (wizard ? (sizeof(wiz_souls) + sizeof(tool_souls)) : 0);
+
+    /* Allow npcs to cast spells using the spell name as a verb. */
+    if (query_npc() &&
+        (ob = this_object()->find_spell(verb)))
+    {
+        this_object()->start_spell(verb, str, ob);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Function name: query_cmd_index_stats
+ * Description  : Gives the number of commands resolved through the verb
+ *                index, and the number of exist_command() calls that the
+ *                index saved compared to searching all souls.
+ * Returns      : int * - ({ commands, calls saved })
+ */
+public nomask int *
+query_cmd_index_stats()
+{
+    return ({ cmd_index_commands, cmd_index_saved });
+}
+
 /*
  * Function name:   my_commands
  * Description:     Try to find and perform a command.
@@ -365,6 +483,12 @@ my_commands(string str)
     string verb = query_verb();
     int    size;
 
+    /* Use the verb index unless it is being rebuilt. */
+    if (mappingp(cmd_index) && !cmd_index[SOUL_INDEX_STALE])
+    {
+        return index_commands(verb, str);
+    }
+
     /* Don't waste the wiz-souls and toolsouls on mortals.
      */
     if (query_wiz_level())
@@ -492,14 +616,22 @@ reopen_soul()
 /*
  * Function name: update_hooks
  * Description  : This function loads and initializes all wizards souls,
- *                tool souls and command souls the player can have.
+ *                tool souls and command souls the player can have, and
+ *                fetches the verb index for those souls.
  */
 nomask public void
 update_hooks()
 {
+    cmd_index_loading = 1;
     load_wiz_souls();
     load_tool_souls();
     load_command_souls();
+    cmd_index_loading = 0;
+
+    update_cmd_index();
+
+    /* We are called when our rank changes, which shows in our unmet name. */
+    notify_change_short();
 }
 
 /*
@@ -41,6 +41,9 @@ set_linkdead(int i)
 	is_linkdead = time();
     else
 	is_linkdead = 0;
+
+    /* We may be shown as a statue now. */
+    notify_change_short();
 }
 
 /*
@@ -243,6 +243,9 @@ set_race_name(string str)
 
     race_name = str;
     add_name(race_name);
+
+    /* The race is part of our unmet name. */
+    notify_change_short();
 }
 
 /*
@@ -1318,6 +1321,8 @@ set_ghost(int flag)
 
         remove_name(LD_GHOST);
     }
+
+    notify_change_short();
 }
 
 /*
@@ -1467,6 +1472,7 @@ set_gender(int g)
     if (g == G_MALE || g == G_FEMALE || g == G_NEUTER)
     {
         gender = g;
+        notify_change_short();
     }
 }
 
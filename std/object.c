@@ -42,7 +42,14 @@ static int      obj_no_show,    /* Don't display this object. */
 static object   obj_previous;   /* Caller of function resulting in VBFC */
 static mapping  obj_props;      /* Object properties */
 private static int hb_alarm_id,    /* Identification of hearbeat callout */
-                reset_interval; /* Constant used to set reset interval */
+                reset_interval, /* Constant used to set reset interval */
+                reset_visited,  /* Visited by a player since the reset */
+                reset_pending;  /* Reset deferred until the next visit */
+private static mapping prop_hooks;   /* Shared table of add/remove_prop hooks */
+private static object *prop_hook_shadows; /* Shadows prop_hooks is made for */
+private static mixed  prop_interest; /* Props the environment wants to know */
+private static object prop_interest_env; /* Environment of prop_interest */
+private static object prop_interest_shadow; /* Its outermost shadow then */
 
 /*
  * Prototypes
@@ -191,22 +198,73 @@ random_reset()
 public nomask void
 reset()
 {
-    mixed *calls = get_all_alarms();
-    int index = sizeof(calls);
-
-    while(--index >= 0)
-        if (calls[index][1] == "reset")
-            remove_alarm(calls[index][0]);
+    reset_pending = 0;
+    reset_visited = 0;
 
     if (!reset_interval)
         return;
 
     if (function_exists("reset_object", this_object()))
-        set_alarm(random_reset(), 0.0, reset);
+        RESET_SCHEDULER->schedule_reset(random_reset());
 
     this_object()->reset_object();
 }
 
+/*
+ * Function name: reset_due
+ * Description  : Called from the reset scheduler when it is time to reset.
+ *                A room that no player visited since its previous reset
+ *                postpones the reset until the next player enters.
+ */
+public nomask void
+reset_due()
+{
+    if (file_name(previous_object()) != RESET_SCHEDULER)
+        return;
+
+    if (!reset_visited && query_prop(ROOM_I_IS) &&
+        !sizeof(filter(all_inventory(), interactive)))
+    {
+        reset_pending = 1;
+        RESET_SCHEDULER->pending_reset();
+        return;
+    }
+
+    reset();
+}
+
+/*
+ * Function name: reset_rejoin
+ * Description  : Registers a chunk of objects again with a new reset
+ *                scheduler.
+ * Arguments    : object *obs - the objects.
+ *                float *delays - the time until their reset, or < 0.0 if
+ *                    the reset waits for a visitor.
+ */
+static void
+reset_rejoin(object *obs, float *delays)
+{
+    RESET_SCHEDULER->rejoin_resets(obs, delays);
+}
+
+/*
+ * Function name: reset_handover
+ * Description  : Called from the reset scheduler when it is destructed with
+ *                a chunk of its queue, so that we register the chunk with
+ *                the new scheduler once it is gone.
+ * Arguments    : object *obs - the objects.
+ *                float *delays - the time until their reset, or < 0.0 if
+ *                    the reset waits for a visitor.
+ */
+public nomask void
+reset_handover(object *obs, float *delays)
+{
+    if (file_name(previous_object()) != RESET_SCHEDULER)
+        return;
+
+    set_alarm(0.0, 0.0, &reset_rejoin(obs, delays));
+}
+
 /*
  * Function name: disable_reset
  * Description  : Used to disable reset, in case it isn't needed. Call this
@@ -215,14 +273,11 @@ reset()
 nomask public void
 disable_reset()
 {
-    mixed *calls = get_all_alarms();
-    int index = sizeof(calls);
-
-    while(--index >= 0)
-        if (calls[index][1] == "reset")
-            remove_alarm(calls[index][0]);
+    if (reset_interval)
+        RESET_SCHEDULER->unschedule_reset();
 
     reset_interval = 0;
+    reset_pending = 0;
 }
 
 /*
@@ -255,7 +310,7 @@ enable_reset(int factor = 100)
     reset_interval = factor;
 
     if (function_exists("reset_object", this_object()))
-        set_alarm(random_reset(), 0.0, reset);
+        RESET_SCHEDULER->schedule_reset(random_reset());
 }
 
 /*
@@ -536,6 +591,117 @@ adjectiv_id(string str)
     return (member_array(str, obj_adjs) >= 0);
 }
 
+/*
+ * Function name: query_shadows
+ * Description  : Finds the shadows of this object.
+ * Returns      : object * - the shadows, outermost last.
+ */
+static object *
+query_shadows()
+{
+    object *shadows = ({ });
+    object sh = this_object();
+
+    while (objectp(sh = shadow(sh, 0)))
+        shadows += ({ sh });
+
+    return shadows;
+}
+
+/*
+ * Function name: prop_hook_exists
+ * Description  : Find out whether this object or one of its shadows defines
+ *                a hook for a property. The answer is kept in a table that
+ *                is shared with all objects with the same program and
+ *                shadows, so the hook is only looked up once.
+ * Arguments    : string fname - the name of the hook, e.g. "add_prop" + prop.
+ * Returns      : int 1/0 - defined or not.
+ */
+static int
+prop_hook_exists(string fname)
+{
+    object *shadows;
+    int flag;
+
+    /* Find the table again when the shadows changed. */
+    if (objectp(shadow(this_object(), 0)) || sizeof(prop_hook_shadows))
+    {
+        shadows = query_shadows();
+        if (sizeof(shadows) != sizeof(prop_hook_shadows) ||
+            sizeof(shadows - prop_hook_shadows))
+        {
+            prop_hook_shadows = shadows;
+            prop_hooks = 0;
+        }
+    }
+
+    if (!mappingp(prop_hooks))
+    {
+        prop_hooks = PROP_HOOKS->query_hook_table(({ this_object() }) +
+            (prop_hook_shadows || ({ })));
+    }
+
+    if (!(flag = prop_hooks[fname]))
+    {
+        flag = PROP_HOOK_ABSENT;
+        if (function_exists(fname, this_object()))
+            flag = PROP_HOOK_DEFINED;
+        else
+        {
+            foreach(object sh: prop_hook_shadows || ({ }))
+            {
+                if (function_exists(fname, sh))
+                {
+                    flag = PROP_HOOK_DEFINED;
+                    break;
+                }
+            }
+        }
+        prop_hooks[fname] = flag;
+    }
+
+    if (flag == PROP_HOOK_DEFINED)
+    {
+        prop_hooks[PROP_HOOK_CALLS]++;
+        return 1;
+    }
+
+    prop_hooks[PROP_HOOK_SKIPS]++;
+    return 0;
+}
+
+/*
+ * Function name: prop_interest_wanted
+ * Description  : Find out whether the environment wants to be told about a
+ *                change of a property. The props it is interested in are
+ *                asked once after each move, see query_prop_interest(),
+ *                and again when a shadow was added to the environment, as
+ *                the shadow may redefine notify_change_prop().
+ * Arguments    : object env - the environment.
+ *                string prop - the property.
+ * Returns      : int 1/0 - call notify_change_prop() or not.
+ */
+static int
+prop_interest_wanted(object env, string prop)
+{
+    object sh = env;
+    object outer;
+
+    /* New shadows are always put on the outside. */
+    while (objectp(sh = shadow(sh, 0)))
+        outer = sh;
+
+    if ((env != prop_interest_env) ||
+        (outer != prop_interest_shadow))
+    {
+        prop_interest_env = env;
+        prop_interest_shadow = outer;
+        prop_interest = env->query_prop_interest();
+    }
+
+    return (!mappingp(prop_interest) || prop_interest[prop]);
+}
+
 /*
  * Function name: add_prop
  * Description:   Add a property to the property list
@@ -569,7 +735,8 @@ add_prop(string prop, mixed val)
         return;
     }
 
-    if (call_other(this_object(), "add_prop" + prop, val))
+    if (prop_hook_exists("add_prop" + prop) &&
+        call_other(this_object(), "add_prop" + prop, val))
     {
         return;
     }
@@ -582,7 +749,8 @@ add_prop(string prop, mixed val)
     oval = query_prop(prop);
     obj_props[prop] = val;
 
-    if (environment())
+    if (environment() &&
+        prop_interest_wanted(environment(), prop))
     {
         environment()->notify_change_prop(prop, query_prop(prop), oval);
     }
@@ -615,12 +783,14 @@ remove_prop(string prop)
         return;
     }
 
-    if (call_other(this_object(), "remove_prop" + prop))
+    if (prop_hook_exists("remove_prop" + prop) &&
+        call_other(this_object(), "remove_prop" + prop))
     {
         return;
     }
 
-    if (environment())
+    if (environment() &&
+        prop_interest_wanted(environment(), prop))
     {
         environment()->notify_change_prop(prop, 0, query_prop(prop));
     }
@@ -728,6 +898,45 @@ notify_change_prop(string prop, mixed val, mixed oval)
 {
 }
 
+/*
+ * Function name: shadowed_function
+ * Description  : Find out whether one of the shadows of this object defines
+ *                a function.
+ * Arguments    : string fname - the function.
+ * Returns      : int 1/0 - true if a shadow defines it.
+ */
+static int
+shadowed_function(string fname)
+{
+    foreach(object sh: query_shadows())
+    {
+        if (function_exists(fname, sh))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Function name: query_prop_interest
+ * Description  : Objects in our inventory ask this once after they moved
+ *                here, to find out for which properties they should call
+ *                notify_change_prop() in us. If you redefine
+ *                notify_change_prop(), redefine this function too, or all
+ *                property changes will be passed on.
+ * Returns      : mapping - ([ prop : 1 ]) for the interesting props, or 0
+ *                    if we want to know about all props.
+ */
+public mapping
+query_prop_interest()
+{
+    if ((function_exists("notify_change_prop", this_object()) !=
+        OBJECT_OBJECT) || shadowed_function("notify_change_prop"))
+        return 0;
+
+    return ([ ]);
+}
+
 /*
  * Function name: mark_state
  * Description:   Mark the internal state so that update is later possible
@@ -894,6 +1103,14 @@ move(mixed dest, mixed subloc)
 
     if (old != dest)
     {
+        /* Collect the changes to the weight, volume and light of both
+         * sides, so they are passed on to the environments only once.
+         */
+        if (old)
+            old->batch_internal(1);
+        if (dest)
+            dest->batch_internal(1);
+
         if (old)
         {
             this_object()->leave_env(old, dest);
@@ -905,6 +1122,23 @@ move(mixed dest, mixed subloc)
             this_object()->enter_env(dest, old);
             dest->enter_inv(this_object(), old);
         }
+
+        /* The inner container goes first, so its changes are merged with
+         * those of the outer one.
+         */
+        if (old && dest && environment(dest) &&
+            (member_array(old, all_environment(dest)) >= 0))
+        {
+            dest->batch_internal(0);
+            old->batch_internal(0);
+        }
+        else
+        {
+            if (old)
+                old->batch_internal(0);
+            if (dest)
+                dest->batch_internal(0);
+        }
     }
     mark_state();
     return 0;
@@ -1368,6 +1602,18 @@ query_names()
     return query_list(obj_names, 1);
 }
 
+/*
+ * Function name: notify_change_short
+ * Description  : Tells our environment that our short description, or
+ *                whether we are shown, may have changed.
+ */
+static void
+notify_change_short()
+{
+    if (objectp(environment()))
+        environment()->hook_change_short(this_object());
+}
+
 /*
  * Function name: set_adj
  * Description  : This function adds adjectives to the list of adjectives
@@ -1380,6 +1626,7 @@ public void
 set_adj(mixed adj)
 {
     obj_adjs = add_list(obj_adjs, adj, 1);
+    notify_change_short();
 }
 
 /*
@@ -1394,6 +1641,7 @@ public void
 add_adj(mixed adj)
 {
     obj_adjs = add_list(obj_adjs, adj, 0);
+    notify_change_short();
 }
 
 /*
@@ -1407,6 +1655,7 @@ public void
 remove_adj(mixed adj)
 {
     obj_adjs = del_list(obj_adjs, adj);
+    notify_change_short();
 }
 
 /*
@@ -1451,6 +1700,7 @@ set_short(mixed short)
 {
     if (!obj_no_change)
         obj_short = short;
+    notify_change_short();
 }
 
 /*
@@ -1466,6 +1716,7 @@ set_pshort(mixed pshort)
 {
     if (!obj_no_change)
         obj_pshort = pshort;
+    notify_change_short();
 }
 
 /*
@@ -1524,6 +1775,7 @@ public void
 unset_no_show()
 {
     obj_no_show = 0;
+    notify_change_short();
 }
 
 /*
@@ -1546,6 +1798,7 @@ void
 set_no_show_composite(int i)
 {
     obj_no_show_c = i;
+    notify_change_short();
 }
 
 /*
@@ -1556,6 +1809,7 @@ void
 unset_no_show_composite()
 {
     obj_no_show_c = 0;
+    notify_change_short();
 }
 
 /*
@@ -2606,6 +2860,16 @@ init()
 {
     int index = sizeof(obj_commands);
 
+    /* A player enters a room that postponed its reset. */
+    if (reset_interval && objectp(this_player()) &&
+        interactive(this_player()))
+    {
+        if (reset_pending)
+            reset();
+        else
+            reset_visited = 1;
+    }
+
     while(--index >= 0)
     {
         add_action(cmditem_action, obj_commands[index]);
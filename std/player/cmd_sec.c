@@ -32,12 +32,17 @@ static nomask int change_password(string str);
 /*
  * Global variables, they are static and will not be saved.
  */
-static int save_alarm;           /* The id of the autosave-alarm */
+static int save_time;            /* The time of the last save */
+static int save_skips;           /* The number of autosaves skipped */
+
+/* The number of autosaves an idle player may skip in a row. */
+#define MAX_AUTOSAVE_SKIPS (5)
 
 /*
  * Function name: start_autosave
  * Description  : Call this function to start autosaving. Only works for
- *                mortal players.
+ *                mortal players. The player is put at the end of the queue
+ *                of the autosave scheduler.
  */
 static nomask void
 start_autosave()
@@ -49,11 +54,13 @@ start_autosave()
     }
 
     /* Only autosave on interactives, not on linkdead players. */
-    remove_alarm(save_alarm);
-    save_alarm = 0;
     if (interactive())
     {
-	save_alarm = set_alarm(300.0, 0.0, save_me);
+	AUTOSAVE_SCHEDULER->register_player();
+    }
+    else
+    {
+	AUTOSAVE_SCHEDULER->unregister_player();
     }
 }
 
@@ -64,8 +71,40 @@ start_autosave()
 static nomask void
 stop_autosave()
 {
-    remove_alarm(save_alarm);
-    save_alarm = 0;
+    AUTOSAVE_SCHEDULER->unregister_player();
+}
+
+/*
+ * Function name: autosave_me
+ * Description  : Called from the autosave scheduler when it is our turn to
+ *                be saved. A player who has been idle and out of combat
+ *                since the last save has nothing new to save and skips the
+ *                turn, but not more than MAX_AUTOSAVE_SKIPS times in a row.
+ *                Fighting gains experience without typing a command.
+ * Arguments    : int force - if true, always save, e.g. at shutdown.
+ * Returns      : int 1/0 - saved or skipped.
+ */
+public nomask int
+autosave_me(int force)
+{
+    if (previous_object() != find_object(AUTOSAVE_SCHEDULER))
+    {
+	return 0;
+    }
+
+    if (!force &&
+	interactive() &&
+	(query_idle(this_object()) >= (time() - save_time)) &&
+	!objectp(query_attack()) &&
+	(query_combat_time() < save_time) &&
+	(save_skips < MAX_AUTOSAVE_SKIPS))
+    {
+	save_skips++;
+	return 0;
+    }
+
+    save_me(0);
+    return 1;
 }
 
 /*
@@ -231,6 +270,8 @@ save_me(int manual)
     seteuid(0);
     SECURITY->save_player();
     seteuid(getuid(this_object()));
+    save_time = time();
+    save_skips = 0;
 
     /* If the player is a mortal, we will restart autosave. */
     start_autosave();
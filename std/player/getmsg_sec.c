@@ -23,6 +23,12 @@ static string  gmcp_client,      /* GMCP client name */
                gmcp_version,     /* GMCP client version */
                gmcp_mapfile,     /* last loaded mapfile */
                gmcp_section;     /* last loaded mapsection */
+static mapping m_gmcp_pending = ([ ]); /* Fields to send this tick. */
+static mapping m_gmcp_sent = ([ ]);    /* Fields last sent per package. */
+static int     gmcp_alarm,       /* alarm to send the pending fields */
+               gmcp_frames,      /* frames sent by gmcp_char */
+               gmcp_saved_frames, /* frames merged or dropped */
+               gmcp_saved_bytes; /* estimated bytes not sent */
 
 nomask public void gmcp_team();
 
@@ -340,6 +346,9 @@ set_gmcp(string package, mixed data)
         }
         catch_gmcp(GMCP_CHAR_STATUSVARS, data);
 
+        /* A new subscriber must get all fields again. */
+        m_gmcp_sent = ([ ]);
+
         /* Send the char.status package. */
         data = ([ GMCP_NAME : query_name(), GMCP_RACE : query_race_name(),
             GMCP_LEVEL : GET_EXP_LEVEL_DESC(query_average_stat(), query_gender()),
@@ -494,9 +503,80 @@ gmcp_refresh()
     }
 }
 
+/*
+ * Function name: gmcp_frame_size
+ * Description  : Estimates the number of bytes of a frame with a single
+ *                field of a package, including the telnet negotiation.
+ * Arguments    : string package - the package.
+ *                string name - the name of the field.
+ *                mixed value - the value of the field.
+ * Returns      : int - the estimated size.
+ */
+static int
+gmcp_frame_size(string package, string name, mixed value)
+{
+    return strlen(package) + strlen(name) +
+        (stringp(value) ? strlen(value) : 4) + 13;
+}
+
+/*
+ * Function name: gmcp_flush
+ * Description  : Sends the fields that changed since the last tick, one
+ *                frame per package. Fields that were changed back to the
+ *                value last sent are dropped.
+ */
+static void
+gmcp_flush()
+{
+    mapping pending = m_gmcp_pending;
+    mapping sent;
+
+    gmcp_alarm = 0;
+    m_gmcp_pending = ([ ]);
+
+    foreach(string package, mapping fields: pending)
+    {
+        if (!mappingp(sent = m_gmcp_sent[package]))
+        {
+            sent = ([ ]);
+            m_gmcp_sent[package] = sent;
+        }
+
+        /* The fields of the char packages are strings, so we only drop
+         * strings that did not change.
+         */
+        foreach(string name: m_indices(fields))
+        {
+            if (stringp(fields[name]) && (sent[name] == fields[name]))
+            {
+                gmcp_saved_frames++;
+                gmcp_saved_bytes +=
+                    gmcp_frame_size(package, name, fields[name]);
+                m_delkey(fields, name);
+                continue;
+            }
+            sent[name] = fields[name];
+        }
+
+        if (!m_sizeof(fields))
+        {
+            continue;
+        }
+
+        /* Every field beyond the first would have been a frame of its own. */
+        gmcp_frames++;
+        gmcp_saved_frames += m_sizeof(fields) - 1;
+        gmcp_saved_bytes += (m_sizeof(fields) - 1) * (strlen(package) + 7);
+        catch_gmcp(package, fields);
+    }
+}
+
 /*
  * Function name: gmcp_char
- * Description  : Updates the char package with a new value.
+ * Description  : Updates the char package with a new value. The values are
+ *                collected and sent at the end of the tick, so that several
+ *                changes in one package make a single frame. Values that
+ *                did not change are not sent at all.
  * Arguments    : string package - the package to update
  *                string name - the name of the variable
  *                mixed value - the new value
@@ -504,10 +584,42 @@ gmcp_refresh()
 nomask public void
 gmcp_char(string package, string name, mixed value)
 {
-    if (m_gmcp[GMCP_CHAR])
+    if (!m_gmcp[GMCP_CHAR])
     {
-        catch_gmcp(package, ([ name : value ]) );
+        return;
     }
+
+    if (!mappingp(m_gmcp_pending[package]))
+    {
+        m_gmcp_pending[package] = ([ ]);
+    }
+    /* A value set twice in one tick is only sent once. */
+    else if (IN_ARRAY(name, m_indices(m_gmcp_pending[package])))
+    {
+        gmcp_saved_frames++;
+        gmcp_saved_bytes += gmcp_frame_size(package, name, value);
+    }
+
+    m_gmcp_pending[package][name] = value;
+    if (!gmcp_alarm)
+    {
+        gmcp_alarm = set_alarm(0.0, 0.0, gmcp_flush);
+    }
+}
+
+/*
+ * Function name: query_gmcp_stats
+ * Description  : Find out how well the char package updates were merged.
+ * Returns      : mapping - ([ "frames" : frames sent,
+ *                             "saved frames" : frames merged or dropped,
+ *                             "saved bytes" : estimated bytes not sent ])
+ */
+nomask public mapping
+query_gmcp_stats()
+{
+    return ([ "frames" : gmcp_frames,
+              "saved frames" : gmcp_saved_frames,
+              "saved bytes" : gmcp_saved_bytes ]);
 }
 
 /*
@@ -26,6 +26,7 @@ inherit "/std/container";
 
 static object   room_link_cont;	/* Linked container */
 static object   *accept_here = ({ }); /* Items created here on roomcreation */
+static mapping  room_prop_interest;  /* Props we want to be told about */
 
 /*
  * Function name: create_room
@@ -228,7 +229,9 @@ set_room(mixed room)
 /* 
  * Function name: update_internal
  * Description:   Updates the light, weight and volume of things inside
- *                also updates a possible connected container.
+ *                also updates a possible connected container. As this is
+ *                also called from enter_inv() and leave_inv(), we forget the
+ *                description of our contents here.
  * Arguments:     l: Light diff.
  *		  w: Weight diff. (Ignored)
  *		  v: Volume diff. (Ignored)
@@ -236,6 +239,8 @@ set_room(mixed room)
 public void
 update_internal(int l, int w, int v)
 {
+    forget_contents();
+
     ::update_internal(l, w, v);
 
     if (room_link_cont)
@@ -244,19 +249,87 @@ update_internal(int l, int w, int v)
     }
 }
 
-#if 0
+/*
+ * Function name: query_prop_interest
+ * Description  : Objects in our inventory ask this once after they moved
+ *                here, to find out for which properties they should call
+ *                notify_change_prop() in us. See /std/container.c.
+ * Returns      : mapping - ([ prop : 1 ]) for the interesting props, or 0
+ *                    if we want to know about all props.
+ */
+public mapping
+query_prop_interest()
+{
+    if ((function_exists("notify_change_prop", this_object()) !=
+        ROOM_OBJECT) || shadowed_function("notify_change_prop"))
+        return 0;
+
+    /* Shared by all objects in our inventory. */
+    if (!mappingp(room_prop_interest))
+        room_prop_interest = ([ CONT_I_LIGHT : 1, OBJ_I_LIGHT : 1,
+            CONT_I_WEIGHT : 1, OBJ_I_WEIGHT : 1, CONT_I_VOLUME : 1,
+            OBJ_I_VOLUME : 1, CONT_I_ATTACH : 1, CONT_I_TRANSP : 1,
+            CONT_I_CLOSED : 1, OBJ_I_INVIS : 1, OBJ_I_HIDE : 1,
+            OBJ_I_BROKEN : 1, LIVE_S_EXTRA_SHORT : 1,
+            LIVE_I_NO_GENDER_DESC : 1 ]);
+
+    return room_prop_interest;
+}
+
+/*
+ * Function name: notify_change_prop
+ * Description:   This function is called when a property in an object
+ *                in the inventory has been changed. The props that change
+ *                the looks of the object make us forget the description
+ *                of our contents.
+ * Arguments:     prop - The property that has been changed.
+ *                val  - The new value.
+ *                old  - The old value.
+ */
+public void
+notify_change_prop(string prop, mixed val, mixed old)
+{
+    if (old == val)
+        return;
+
+    switch(prop)
+    {
+    case OBJ_I_INVIS:
+    case OBJ_I_HIDE:
+    case OBJ_I_BROKEN:
+    case LIVE_S_EXTRA_SHORT:
+    case LIVE_I_NO_GENDER_DESC:
+        forget_contents();
+        return;
+    }
+
+    ::notify_change_prop(prop, val, old);
+}
+
 /*
  * Function name: hook_change_invis
  * Description  : Called when the (in)visibility state of a living in the room
  *                changes. Use obj->query_invis() to find out the new state.
- *                This is a non-existent pseudo-routine for documentation.
+ *                If you redefine it, call ::hook_change_invis(ob) too.
  * Arguments    : object ob - the object that changes visibility.
  */
 public void
 hook_change_invis(object ob)
 {
+    forget_contents();
+}
+
+/*
+ * Function name: hook_change_short
+ * Description  : Called when an object in the room changes its short
+ *                description, or whether it is shown.
+ * Arguments    : object ob - the object that changes.
+ */
+public void
+hook_change_short(object ob)
+{
+    forget_contents();
 }
-#endif
 
 /*
  * Function name: clean_up
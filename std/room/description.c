@@ -20,6 +20,23 @@ static  string *herbs;             /* WHat herbs grows in this room? */
 /* Buffer this as it's a rather costly call. */
 static  string  gmcp_room_id = MASTER_HASH(this_object());
 
+/*
+ * The description of the contents is kept per visibility class, that is per
+ * set of the hidden and invisible objects a viewer can see. Everything that
+ * does not depend on who is looking is made once for each class. It is
+ * dropped when something enters or leaves, or changes its looks.
+ */
+static  object *desc_plain;        /* Contents everyone can see */
+static  object *desc_concealed;    /* Hidden or invisible contents */
+static  mapping desc_classes;      /* ([ class : ({ description }) ]) */
+
+/* Indices into the description of a visibility class. */
+#define DESC_DEAD   (0) /* The dead objects */
+#define DESC_TEXT   (1) /* Their description, if the same for everyone */
+#define DESC_GROUPS (2) /* The livings grouped by their unmet short */
+#define DESC_NAMES  (3) /* The description of each group when unmet */
+#define DESC_LOOSE  (4) /* The livings that are described per viewer */
+
 /*
  * Function name: add_my_desc
  * Description:   Add a description printed after the normal long description.
@@ -286,6 +303,198 @@ gmcp_room_info(object player, mapping data = 0)
     player->catch_gmcp(GMCP_ROOM_INFO, data);
 }
 
+/*
+ * Function name: forget_contents
+ * Description  : Drops the description of the contents, so it is made again
+ *                when someone looks next.
+ */
+static void
+forget_contents()
+{
+    desc_plain = 0;
+    desc_concealed = 0;
+    desc_classes = 0;
+}
+
+/*
+ * Function name: unmet_group
+ * Description  : Gives the key under which a living is grouped with others
+ *                that look the same to those who have not met them. The
+ *                unmet name holds the gender, race, ghost state and
+ *                wizardhood. When one of those, LIVE_S_EXTRA_SHORT or
+ *                LIVE_I_NO_GENDER_DESC change, the living tells us through
+ *                hook_change_short() or notify_change_prop().
+ * Arguments    : object ob - the living.
+ * Returns      : string - the key.
+ */
+static string
+unmet_group(object ob)
+{
+    return ob->query_nonmet_name() + "|" + !!ob->query_linkdead() + "|" +
+        ob->query_prop(LIVE_S_EXTRA_SHORT);
+}
+
+/*
+ * Function name: make_class
+ * Description  : Makes the description of the contents for a visibility
+ *                class, as far as it does not depend on the viewer.
+ * Arguments    : object *obarr - the objects seen in this class.
+ *                object for_obj - the first viewer in this class.
+ * Returns      : mixed - the description, see DESC_* above.
+ */
+static mixed
+make_class(object *obarr, object for_obj)
+{
+    object *lv, *dd, *loose;
+    mapping groups = ([ ]);
+    string text, key;
+
+    obarr = filter(obarr, not @ &->query_no_show_composite());
+    lv = FILTER_LIVE(obarr);
+    dd = obarr - lv;
+
+    /* The dead are only described once when they look alike to all. */
+    if (sizeof(COMPOSITE_STABLE(dd)) == sizeof(dd))
+    {
+        text = COMPOSITE_FILE->desc_dead(dd, 1, for_obj);
+        text = (stringp(text) ? text : "");
+    }
+
+    loose = lv - COMPOSITE_STABLE(lv);
+    foreach(object ob: lv - loose)
+    {
+        key = unmet_group(ob);
+        groups[key] = (pointerp(groups[key]) ? (groups[key] + ({ ob })) :
+            ({ ob }));
+    }
+
+    return ({ dd, text, m_values(groups), allocate(m_sizeof(groups)),
+        loose });
+}
+
+/*
+ * Function name: query_class
+ * Description  : Finds the description of the visibility class of a viewer.
+ *                The class is told by the hidden and invisible objects the
+ *                viewer can see. When the objects to describe are not what
+ *                we expect for the class, the cache is not used.
+ * Arguments    : object for_obj - the viewer.
+ *                object *obarr - the objects to describe.
+ *                int fresh - true if the contents were just looked up.
+ * Returns      : mixed - the description, see DESC_* above, or 0.
+ */
+static varargs mixed
+query_class(object for_obj, object *obarr, int fresh)
+{
+    object *seen, *plain;
+    object *inv;
+    string key = "";
+
+    /* When the room hears not of all changes, we cannot keep anything. */
+    if ((function_exists("update_internal", this_object()) != ROOM_OBJECT) ||
+        (function_exists("notify_change_prop", this_object()) != ROOM_OBJECT))
+    {
+        return 0;
+    }
+
+    if (!mappingp(desc_classes))
+    {
+        inv = filter(all_inventory(this_object()), not @ &->query_no_show());
+        desc_concealed = ({ });
+        foreach(object ob: inv)
+        {
+            if ((ob->query_prop(OBJ_I_INVIS) > 0) ||
+                (ob->query_prop(OBJ_I_HIDE) > 0))
+            {
+                desc_concealed += ({ ob });
+            }
+        }
+        desc_plain = inv - desc_concealed;
+        desc_classes = ([ ]);
+        fresh = 1;
+    }
+
+    seen = desc_concealed & obarr;
+    plain = desc_plain - ({ for_obj });
+    if ((sizeof(obarr) != (sizeof(plain) + sizeof(seen))) ||
+        (sizeof(obarr & plain) != sizeof(plain)))
+    {
+        /* Something may have been destructed. Try once more. */
+        if (fresh)
+        {
+            return 0;
+        }
+
+        forget_contents();
+        return query_class(for_obj, obarr, 1);
+    }
+
+    foreach(object ob: desc_concealed)
+    {
+        key += (IN_ARRAY(ob, seen) ? "1" : "0");
+    }
+
+    if (!pointerp(desc_classes[key]))
+    {
+        desc_classes[key] = make_class(desc_plain + seen, for_obj);
+    }
+
+    return desc_classes[key];
+}
+
+/*
+ * Function name: describe_live_class
+ * Description  : Describes the livings of a visibility class to a viewer.
+ *                Only now the met and unmet names are applied.
+ * Arguments    : mixed desc - the description of the class.
+ *                object for_obj - the viewer.
+ * Returns      : string - the description, or 0.
+ */
+static string
+describe_live_class(mixed desc, object for_obj)
+{
+    object *group, *unmet;
+    object *others = desc[DESC_LOOSE] - ({ for_obj });
+    string *words = ({ });
+    int index = -1;
+    int size = sizeof(desc[DESC_GROUPS]);
+
+    while(++index < size)
+    {
+        group = desc[DESC_GROUPS][index] - ({ for_obj });
+        unmet = filter(group, &->notmet_me(for_obj));
+        others += (group - unmet);
+        if (!sizeof(unmet))
+        {
+            continue;
+        }
+
+        /* Only the description of a whole group is the same for all. */
+        if (sizeof(unmet) < sizeof(desc[DESC_GROUPS][index]))
+        {
+            words += ({ COMPOSITE_FILE->desc_same(unmet, for_obj) });
+            continue;
+        }
+        if (!stringp(desc[DESC_NAMES][index]))
+        {
+            desc[DESC_NAMES][index] =
+                COMPOSITE_FILE->desc_same(unmet, for_obj);
+        }
+        words += ({ desc[DESC_NAMES][index] });
+    }
+
+    if (sizeof(others))
+    {
+        foreach(object *same: unique_array(others, "short"))
+        {
+            words += ({ COMPOSITE_FILE->desc_same(same, for_obj) });
+        }
+    }
+
+    words = filter(words, stringp);
+    return (sizeof(words) ? COMPOSITE_WORDS(words) : 0);
+}
+
 /*
  * Function name: describe_contents
  * Description:   Give a description of items in this room
@@ -296,12 +505,33 @@ public void
 describe_contents(object for_obj, object *obarr)
 {
     object *lv, *dd;
+    mixed desc;
     string item;
 
     for_obj->catch_tell(show_sublocs(for_obj));
 
     obarr -= ({ for_obj });
 
+    if (pointerp(desc = query_class(for_obj, obarr)))
+    {
+        item = desc[DESC_TEXT];
+        if (!stringp(item))
+        {
+            item = COMPOSITE_FILE->desc_dead(desc[DESC_DEAD], 1, for_obj);
+        }
+        if (strlen(item))
+        {
+            for_obj->catch_tell(capitalize(item) + ".\n");
+        }
+
+        item = describe_live_class(desc, for_obj);
+        if (stringp(item))
+        {
+            for_obj->catch_tell(capitalize(item) + ".\n");
+        }
+        return;
+    }
+
     lv = FILTER_LIVE(obarr);
     dd = obarr - lv;
 
@@ -171,6 +171,7 @@ add_exit(string place, string cmd, mixed efunc, mixed tired, mixed non_obvious)
 
     map(FILTER_LIVE(all_inventory()), &ugly_update_action(, cmd, unq_move));
     default_dirs -= ({ cmd });
+    ROOM_GRAPH->invalidate_room();
     return 1;
 }
 
@@ -208,6 +209,7 @@ remove_exit(string cmd)
                 default_dirs += ({ cmd });
 
             map(FILTER_LIVE(all_inventory()), &ugly_update_action(, cmd, unq_no_move));
+            ROOM_GRAPH->invalidate_room();
             return 1;
         }
     }
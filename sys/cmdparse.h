@@ -376,5 +376,25 @@
 #define QUESTION_FILTER ({ "a", "an", "the", "those", "these", "is", "are", \
     "about", "how" })
 
+/*
+ * SOUL_INDEX_*
+ *
+ * The verb index of a living maps each verb to an array with the souls that
+ * define the verb, in the order they are searched. Each element is an array
+ * of ({ soul filename, soul kind, position in the complete search order }).
+ * The index is shared between all livings with the same souls and is kept
+ * by /sys/global/soul_index. When the key SOUL_INDEX_STALE is present, the
+ * index is being rebuilt and should not be trusted.
+ */
+#define SOUL_INDEX_PATH     (0)
+#define SOUL_INDEX_KIND     (1)
+#define SOUL_INDEX_POS      (2)
+
+#define SOUL_KIND_WIZ       (0)
+#define SOUL_KIND_TOOL      (1)
+#define SOUL_KIND_CMD       (2)
+
+#define SOUL_INDEX_STALE    ("")
+
 /* No definitions beyond this line. */
 #endif CMDPARSE_DEF
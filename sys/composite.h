@@ -127,5 +127,15 @@
  */
 #define EXPAND_LINE(text, length) sprintf("%'" + (text) + "'*s", (length), "")
 
+/*
+ * COMPOSITE_STABLE
+ *
+ * Returns the objects from the array <obs> whose short description is the
+ * same for everyone who can see them, so a description of them can be shared
+ * among all onlookers. Livings are only stable when they show the standard
+ * met and unmet names.
+ */
+#define COMPOSITE_STABLE(obs) ((object *)COMPOSITE_FILE->filter_stable(obs))
+
 /* No definitions beyond this point. */
 #endif COMPOSITE_DEF
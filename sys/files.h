@@ -76,8 +76,10 @@
 #define GAMEINFO_OBJECT    ("/secure/gameinfo_player")
 #define GOG_ACCOUNTS       ("/secure/gog_accounts")
 #define LOGIN_OBJECT       ("/secure/login")
+#define LOG_CENTRAL        ("/secure/log_central")
 #define MAIL_CHECKER       ("/secure/mail_checker")
 #define MAIL_READER        ("/secure/mail_reader")
+#define MAIL_STORE         ("/secure/mail_store")
 #define MAP_CENTRAL        ("/secure/map_central")
 #define MSSP               ("/secure/mssp")
 #define PLAYER_TOOL        ("/secure/player_tool")
@@ -139,9 +141,19 @@
 #define WORKROOM_OBJECT    ("/std/workroom")
 
 /* The section /sys */
+#define AMBIENT_SCHEDULER  ("/sys/global/ambient")
+#define AUTOSAVE_SCHEDULER ("/sys/global/autosave")
+#define CACHE_CENTRAL      ("/sys/global/cache")
+#define COMBAT_SCHEDULER   ("/sys/global/combat_scheduler")
 #define MANCTRL            ("/sys/global/manpath")
+#define PROFILER           ("/sys/global/profiler")
+#define PROP_HOOKS         ("/sys/global/prop_hooks")
+#define RESET_SCHEDULER    ("/sys/global/reset")
+#define ROOM_GRAPH         ("/sys/global/room_graph")
 #define FPATH_FILENAME     ("/sys/global/filepath")
 #define LISTENER_CENTRAL   ("/sys/global/listeners")
+#define SOUL_INDEX         ("/sys/global/soul_index")
+#define TELEMETRY          ("/sys/global/telemetry")
 #define ACHIEVEMENTS       ("/d/Genesis/specials/achievements/achievement_master")
 #define WEBSTATS_CENTRAL   ("/d/Web/stats/webstats")
 #define MAGIC_MAP_ID       ("_sparkle_magic_map")
@@ -301,6 +313,28 @@
  * (void) notify_new_object(object obj)
  */
 #define LISTENER_ADD(obj)    (LISTENER_CENTRAL->register_listener(obj))
+
+/*
+ * LISTENER_ADD_FILTER(obj, filter) - add an object as listener that is only
+ * interested in some of the new objects. The filter is a mapping with one
+ * or more of the criteria below, each with a string or an array of strings.
+ * The listener is called for an object that matches any of them.
+ *
+ * LISTEN_PATH    - the master file of the object, e.g. "/std/weapon".
+ * LISTEN_PREFIX  - the master file starts with this path, e.g. "/d/Genesis/".
+ * LISTEN_INHERIT - the object inherits this program, e.g. "/std/armour".
+ * LISTEN_PROP    - the object has this property set.
+ *
+ * Example: LISTENER_ADD_FILTER(this_object(),
+ *              ([ LISTEN_INHERIT : ({ "/std/weapon", "/std/armour" }) ]));
+ */
+#define LISTEN_PATH    "path"
+#define LISTEN_PREFIX  "prefix"
+#define LISTEN_INHERIT "inherit"
+#define LISTEN_PROP    "prop"
+
+#define LISTENER_ADD_FILTER(obj, filter) \
+    (LISTENER_CENTRAL->register_listener((obj), (filter)))
 #define LISTENER_REMOVE(obj) (LISTENER_CENTRAL->unregister_listener(obj))
 
 /*
@@ -309,5 +343,15 @@
  */
 #define LISTENER_NOTIFY(obj) (LISTENER_CENTRAL->register_new_object(obj))
 
+/*
+ * The entries of the hook tables of PROP_HOOKS. A hook add_prop<prop> or
+ * remove_prop<prop> is either defined or absent. The counters hold the
+ * number of hook calls made and skipped.
+ */
+#define PROP_HOOK_DEFINED 1
+#define PROP_HOOK_ABSENT  2
+#define PROP_HOOK_CALLS   "_calls"
+#define PROP_HOOK_SKIPS   "_skips"
+
 /* No definitions beyond this line. */
 #endif FILES_DEFINED
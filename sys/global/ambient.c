@@ -0,0 +1,581 @@
+/*
+ * /sys/global/ambient.c
+ *
+ * This daemon runs the command sequences of NPCs (/std/act/seqaction.c),
+ * which drive the chat and act loops of /std/act/chat.c and action.c.
+ * Rather than every NPC keeping its own alarm, the NPCs register their next
+ * step here and the scheduler executes all steps that are due in batches
+ * from a single alarm.
+ *
+ * An NPC that has not met an interactive player for a while parks itself.
+ * A parked NPC is not in the scheduler at all and costs nothing. It is kept
+ * in the list of the room it was in when it parked, and when a player meets
+ * any of the NPCs in that room, all parked NPCs of the room are woken at
+ * once.
+ *
+ * The steps are kept in a timing wheel of WHEEL_SIZE slots, each slot
+ * covering WHEEL_TICK seconds, like in the combat scheduler. The NPCs use
+ * the following calls:
+ *
+ *    schedule_step(float delay, int steps)
+ *                            - run seq_heartbeat(steps) after the delay.
+ *    park_npc()              - stop running until a player is met.
+ *    wake_npc()              - a player was met, wake the room.
+ *    unschedule_npc()        - forget about the caller.
+ *
+ * The wheel only lives in memory. When the scheduler is updated or
+ * destructed, remove_object() hands the active and parked NPCs over in
+ * chunks of HANDOVER_CHUNK. The first NPC of every chunk registers the whole
+ * chunk again with the new scheduler right after, see seq_handover() in
+ * /std/act/seqaction.c.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <macros.h>
+
+/* The granularity of the wheel in seconds, and the number of slots. */
+#define WHEEL_TICK          (1.0)
+#define WHEEL_SIZE          (64)
+
+/* The maximum number of steps we run in a single tick. Steps that do not
+ * fit are executed in the next tick.
+ */
+#define MAX_STEPS_PER_TICK  (200)
+
+/* The delay before the first step of an NPC that is woken. */
+#define WAKE_DELAY          (1.0)
+
+/* The number of NPCs handed over to the next scheduler in one call. */
+#define HANDOVER_CHUNK      (50)
+
+/* Indices into the NPC entries. */
+#define ENTRY_DUE           (0)
+#define ENTRY_STEPS         (1)
+
+/*
+ * Global variables.
+ *
+ * wheel   - ({ ([ npc : 1 ]) }) one mapping for each slot of the wheel.
+ * entries - ([ npc : ({ due tick, steps }) ]) the active NPCs.
+ * parked  - ([ room : ([ npc : 1 ]) ]) the parked NPCs per room.
+ * rooms   - ([ npc : room ]) the room an NPC parked in.
+ */
+private static mixed   *wheel = allocate(WHEEL_SIZE);
+private static mapping entries = ([ ]);
+private static mapping parked = ([ ]);
+private static mapping rooms = ([ ]);
+private static float   base_time;
+private static int     last_tick;
+private static int     tick_alarm;
+
+/*
+ * Statistics.
+ */
+private static int     stat_start;
+private static int     stat_steps;
+private static int     stat_parks;
+private static int     stat_wakes;
+private static int     stat_woken;
+private static int     stat_deferred;
+private static int     stat_errors;
+
+/*
+ * Prototypes.
+ */
+static int  current_tick();
+static void run_ticks();
+
+/*
+ * Function name: create
+ * Description  : Initialise the wheel.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    for (int index = 0; index < WHEEL_SIZE; index++)
+    {
+        wheel[index] = ([ ]);
+    }
+
+    base_time = gettimeofday();
+    stat_start = time();
+}
+
+/*
+ * Function name: remove_object
+ * Description  : Before we are destructed, the active and parked NPCs are
+ *                told when their next step is due, so they can register with
+ *                the next scheduler. A parked NPC gets a delay < 0.0.
+ */
+public void
+remove_object()
+{
+    int now = current_tick();
+    int size = m_sizeof(entries) + m_sizeof(rooms);
+    object *npcs = allocate(size);
+    float *delays = allocate(size);
+    int *steps = allocate(size);
+    int index;
+
+    if (tick_alarm)
+    {
+        remove_alarm(tick_alarm);
+        tick_alarm = 0;
+    }
+
+    foreach(object npc, mixed entry: entries)
+    {
+        npcs[index] = npc;
+        /* Overdue steps are due at once. */
+        delays[index] = itof(MAX(entry[ENTRY_DUE] - now, 0)) * WHEEL_TICK;
+        steps[index] = entry[ENTRY_STEPS];
+        index++;
+    }
+
+    foreach(object npc, object room: rooms)
+    {
+        npcs[index] = npc;
+        delays[index] = -1.0;
+        index++;
+    }
+
+    for (index = 0; index < size; index += HANDOVER_CHUNK)
+    {
+        if (objectp(npcs[index]) &&
+            catch(npcs[index]->seq_handover(
+                npcs[index..(index + HANDOVER_CHUNK - 1)],
+                delays[index..(index + HANDOVER_CHUNK - 1)],
+                steps[index..(index + HANDOVER_CHUNK - 1)])))
+        {
+            stat_errors++;
+        }
+    }
+
+    destruct();
+}
+
+/*
+ * Function name: current_tick
+ * Description  : Find out in which tick of the wheel we are right now.
+ * Returns      : int - the tick number.
+ */
+static int
+current_tick()
+{
+    return ftoi((gettimeofday() - base_time) / WHEEL_TICK);
+}
+
+/*
+ * Function name: delete_entry
+ * Description  : Removes an NPC from the wheel.
+ * Arguments    : object npc - the NPC.
+ */
+static void
+delete_entry(object npc)
+{
+    mixed entry = entries[npc];
+
+    if (pointerp(entry))
+    {
+        m_delkey(wheel[entry[ENTRY_DUE] % WHEEL_SIZE], npc);
+        m_delkey(entries, npc);
+    }
+}
+
+/*
+ * Function name: unpark
+ * Description  : Removes an NPC from the list of parked NPCs.
+ * Arguments    : object npc - the NPC.
+ */
+static void
+unpark(object npc)
+{
+    object room = rooms[npc];
+
+    m_delkey(rooms, npc);
+    if (objectp(room) &&
+        mappingp(parked[room]))
+    {
+        m_delkey(parked[room], npc);
+        if (!m_sizeof(parked[room]))
+        {
+            m_delkey(parked, room);
+        }
+    }
+}
+
+/*
+ * Function name: insert_entry
+ * Description  : Puts an NPC in the slot of the tick its step is due, and
+ *                makes sure the alarm runs.
+ * Arguments    : object npc - the NPC.
+ *                float delay - the time until the step.
+ *                int steps - the argument to seq_heartbeat().
+ */
+static void
+insert_entry(object npc, float delay, int steps)
+{
+    int due;
+
+    if (!tick_alarm)
+    {
+        last_tick = current_tick();
+        tick_alarm = set_alarm(WHEEL_TICK, WHEEL_TICK, run_ticks);
+    }
+
+    delete_entry(npc);
+    due = current_tick() + ftoi(delay / WHEEL_TICK);
+    if (due <= last_tick)
+    {
+        due = last_tick + 1;
+    }
+
+    entries[npc] = ({ due, steps });
+    wheel[due % WHEEL_SIZE][npc] = 1;
+}
+
+/*
+ * Function name: schedule_step
+ * Description  : Called from an NPC to run its next step after a delay. A
+ *                step that was already scheduled is replaced.
+ * Arguments    : float delay - the time until the step.
+ *                int steps - the argument to seq_heartbeat().
+ */
+public void
+schedule_step(float delay, int steps)
+{
+    object npc = previous_object();
+
+    if (!function_exists("seq_heartbeat", npc))
+    {
+        return;
+    }
+
+    unpark(npc);
+    insert_entry(npc, delay, steps);
+}
+
+/*
+ * Function name: park
+ * Description  : Takes an NPC out of the wheel and adds it to the parked
+ *                NPCs of the room it is in.
+ * Arguments    : object npc - the NPC.
+ */
+static void
+park(object npc)
+{
+    object room = environment(npc);
+
+    delete_entry(npc);
+    unpark(npc);
+    if (!objectp(room))
+    {
+        return;
+    }
+
+    /* Forget the NPCs of rooms that were destructed. */
+    m_delkey(parked, 0);
+
+    rooms[npc] = room;
+    if (mappingp(parked[room]))
+    {
+        parked[room][npc] = 1;
+    }
+    else
+    {
+        parked[room] = ([ npc : 1 ]);
+    }
+    stat_parks++;
+}
+
+/*
+ * Function name: park_npc
+ * Description  : Called from an NPC that has not met a player for a while.
+ *                It is taken out of the scheduler until wake_npc() is
+ *                called for it or another NPC in the same room.
+ */
+public void
+park_npc()
+{
+    park(previous_object());
+}
+
+/*
+ * Function name: rejoin_npcs
+ * Description  : Called from an NPC with a chunk of NPCs that were in the
+ *                previous scheduler when it was destructed.
+ * Arguments    : object *npcs - the NPCs.
+ *                float *delays - the time until their step, or < 0.0 if
+ *                    they were parked.
+ *                int *steps - the arguments to seq_heartbeat().
+ */
+public void
+rejoin_npcs(object *npcs, float *delays, int *steps)
+{
+    int size = sizeof(npcs);
+
+    if ((sizeof(delays) != size) ||
+        (sizeof(steps) != size))
+    {
+        return;
+    }
+
+    for (int index = 0; index < size; index++)
+    {
+        if (!objectp(npcs[index]) ||
+            !function_exists("seq_heartbeat", npcs[index]))
+        {
+            continue;
+        }
+
+        if (delays[index] < 0.0)
+        {
+            park(npcs[index]);
+        }
+        else
+        {
+            unpark(npcs[index]);
+            insert_entry(npcs[index], delays[index], steps[index]);
+        }
+    }
+}
+
+/*
+ * Function name: wake_room
+ * Description  : Wakes all parked NPCs of a room.
+ * Arguments    : object room - the room.
+ */
+static void
+wake_room(object room)
+{
+    mapping npcs = parked[room];
+
+    if (!mappingp(npcs))
+    {
+        return;
+    }
+
+    m_delkey(parked, room);
+    stat_wakes++;
+    foreach(object npc: m_indexes(npcs))
+    {
+        m_delkey(rooms, npc);
+        if (objectp(npc))
+        {
+            insert_entry(npc, WAKE_DELAY, 1);
+            stat_woken++;
+        }
+    }
+}
+
+/*
+ * Function name: wake_npc
+ * Description  : Called from an NPC when it meets a player. All parked NPCs
+ *                in its room and in the room it parked in are woken, and the
+ *                caller itself runs its next step soon.
+ */
+public void
+wake_npc()
+{
+    object npc = previous_object();
+    mixed entry;
+
+    if (objectp(rooms[npc]))
+    {
+        wake_room(rooms[npc]);
+    }
+    if (objectp(environment(npc)))
+    {
+        wake_room(environment(npc));
+    }
+
+    unpark(npc);
+    entry = entries[npc];
+    if (!pointerp(entry) ||
+        (entry[ENTRY_DUE] > (current_tick() + ftoi(WAKE_DELAY / WHEEL_TICK))))
+    {
+        insert_entry(npc, WAKE_DELAY, 1);
+    }
+}
+
+/*
+ * Function name: unschedule_npc
+ * Description  : Called from an NPC to stop its steps altogether.
+ */
+public void
+unschedule_npc()
+{
+    object npc = previous_object();
+
+    delete_entry(npc);
+    unpark(npc);
+}
+
+/*
+ * Function name: run_slot
+ * Description  : Executes all steps in the slot of a tick that are due.
+ * Arguments    : int tick - the tick to process.
+ *                int budget - the number of steps we may still run.
+ * Returns      : int - the number of steps executed, or -1 if we ran out
+ *                      of budget before the slot was done.
+ */
+static int
+run_slot(int tick, int budget)
+{
+    mapping slot = wheel[tick % WHEEL_SIZE];
+    mixed entry;
+    int steps, deferred;
+
+    foreach(object npc: m_indexes(slot))
+    {
+        entry = entries[npc];
+        if (!objectp(npc) || !pointerp(entry))
+        {
+            m_delkey(slot, npc);
+            m_delkey(entries, npc);
+            continue;
+        }
+
+        /* Not due in this rotation of the wheel. */
+        if (entry[ENTRY_DUE] > tick)
+        {
+            continue;
+        }
+
+        if (steps >= budget)
+        {
+            deferred++;
+            continue;
+        }
+
+        /* The NPC schedules its next step itself. */
+        m_delkey(slot, npc);
+        m_delkey(entries, npc);
+        if (catch(npc->seq_heartbeat(entry[ENTRY_STEPS])))
+        {
+            stat_errors++;
+        }
+        steps++;
+    }
+
+    if (deferred)
+    {
+        stat_deferred += deferred;
+        return -1;
+    }
+
+    return steps;
+}
+
+/*
+ * Function name: run_ticks
+ * Description  : Called every tick from the alarm. It executes the slots
+ *                of all ticks that passed since the previous call.
+ */
+static void
+run_ticks()
+{
+    int now = current_tick();
+    int steps, done;
+
+    if ((now - last_tick) > WHEEL_SIZE)
+    {
+        last_tick = now - WHEEL_SIZE;
+    }
+
+    while (last_tick < now)
+    {
+        done = run_slot(last_tick + 1, MAX_STEPS_PER_TICK - steps);
+        if (done < 0)
+        {
+            steps = MAX_STEPS_PER_TICK;
+            break;
+        }
+
+        steps += done;
+        last_tick++;
+    }
+
+    stat_steps += steps;
+
+    if (!m_sizeof(entries))
+    {
+        remove_alarm(tick_alarm);
+        tick_alarm = 0;
+    }
+}
+
+/*
+ * Function name: query_active
+ * Description  : Find out whether an NPC has a step scheduled.
+ * Arguments    : object npc - the NPC.
+ * Returns      : int 1/0 - scheduled or not.
+ */
+public int
+query_active(object npc)
+{
+    return pointerp(entries[npc]);
+}
+
+/*
+ * Function name: query_parked
+ * Description  : Find out whether an NPC is parked.
+ * Arguments    : object npc - the NPC.
+ * Returns      : int 1/0 - parked or not.
+ */
+public int
+query_parked(object npc)
+{
+    return objectp(rooms[npc]);
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the statistics of the scheduler.
+ * Returns      : mapping - the statistics, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    return ([
+        "active"   : m_sizeof(entries),
+        "parked"   : m_sizeof(rooms),
+        "rooms"    : m_sizeof(parked),
+        "steps"    : stat_steps,
+        "parks"    : stat_parks,
+        "wakes"    : stat_wakes,
+        "woken"    : stat_woken,
+        "deferred" : stat_deferred,
+        "errors"   : stat_errors,
+        "since"    : stat_start,
+        ]);
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the number of active and parked NPCs when a wizard
+ *                stats the scheduler.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    mapping stats = query_stats();
+
+    return sprintf("Ambient scheduler since %s\n", ctime(stats["since"])) +
+        sprintf("Active NPCs : %6d    Alarm  : %s\n", stats["active"],
+            (tick_alarm ? "running" : "idle")) +
+        sprintf("Parked NPCs : %6d    Rooms  : %d\n", stats["parked"],
+            stats["rooms"]) +
+        sprintf("Steps       : %6d    Parks  : %d    Wakes : %d (%d NPCs)\n",
+            stats["steps"], stats["parks"], stats["wakes"], stats["woken"]) +
+        sprintf("Deferred    : %6d    Errors : %d\n", stats["deferred"],
+            stats["errors"]);
+}
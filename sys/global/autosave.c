@@ -0,0 +1,342 @@
+/*
+ * /sys/global/autosave.c
+ *
+ * This daemon schedules the autosaves of the mortal players. Rather than
+ * every player keeping a private alarm, the players are kept in a queue
+ * and every second the next players in line get their turn, so the saves
+ * are spread evenly over the autosave interval, also when many players log
+ * in at the same time after a reboot.
+ *
+ * A player who did nothing since the previous save skips the turn, see
+ * autosave_me() in /std/player/cmd_sec.c. No more than MAX_SAVES_PER_TICK
+ * player files are written each second. When the game is shut down, the
+ * armageddon calls save_all() to save all players at once.
+ *
+ * The queue is not kept when the daemon is updated. The logged in mortal
+ * players are put in the queue again when it is loaded.
+ *
+ * The players use the following calls:
+ *
+ *    register_player()   - put the caller at the end of the queue.
+ *    unregister_player() - take the caller out of the queue.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <files.h>
+#include <macros.h>
+#include <std.h>
+
+/* The time in seconds in which all players get their turn. */
+#define AUTOSAVE_INTERVAL   (300)
+
+/* The maximum number of player files we write each second. */
+#define MAX_SAVES_PER_TICK  (5)
+
+/* The number of players saved in one go when saving everyone. */
+#define SAVE_ALL_CHUNK      (25)
+
+/*
+ * Global variables.
+ *
+ * queue      - the players in the order of their turns.
+ * save_queue - the players still to be saved by save_all().
+ */
+private static object  *queue = ({ });
+private static object  *save_queue = ({ });
+private static int     tick_alarm;
+
+/*
+ * Statistics.
+ */
+private static int     stat_start;
+private static int     stat_saves;
+private static int     stat_autosaves;
+private static int     stat_skips;
+private static int     stat_deferred;
+private static int     stat_bulk;
+private static int     stat_errors;
+private static int     stat_bytes;
+private static int     stat_minute;
+private static int     stat_minute_saves;
+private static int     stat_minute_bytes;
+private static int     stat_last_saves;
+private static int     stat_last_bytes;
+
+/*
+ * Prototypes.
+ */
+static void run_tick();
+
+/*
+ * Function name: create
+ * Description  : Constructor. The queue only lives in memory, so when we
+ *                are loaded again, e.g. after an update, the mortal players
+ *                that are logged in are put in the queue again.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    stat_start = time();
+    stat_minute = time() / 60;
+
+    foreach(object player: users())
+    {
+        if (IS_PLAYER_OBJECT(player) &&
+            !player->query_wiz_level())
+        {
+            queue += ({ player });
+        }
+    }
+
+    if (sizeof(queue))
+    {
+        tick_alarm = set_alarm(1.0, 1.0, run_tick);
+    }
+}
+
+/*
+ * Function name: register_player
+ * Description  : Called from a player to be saved regularly. The player is
+ *                put at the end of the queue, so a player who just saved
+ *                waits a full interval for the next turn.
+ */
+public void
+register_player()
+{
+    object player = previous_object();
+
+    if (!IS_PLAYER_OBJECT(player))
+    {
+        return;
+    }
+
+    queue = (queue - ({ player })) + ({ player });
+    if (!tick_alarm)
+    {
+        tick_alarm = set_alarm(1.0, 1.0, run_tick);
+    }
+}
+
+/*
+ * Function name: unregister_player
+ * Description  : Called from a player that should no longer be saved.
+ */
+public void
+unregister_player()
+{
+    queue -= ({ previous_object() });
+}
+
+/*
+ * Function name: roll_minute
+ * Description  : Starts counting a new minute when the previous one passed.
+ */
+static void
+roll_minute()
+{
+    int minute = time() / 60;
+
+    if (minute == stat_minute)
+    {
+        return;
+    }
+
+    /* Only the minute right before this one counts as the last minute. */
+    stat_last_saves = ((minute == (stat_minute + 1)) ? stat_minute_saves : 0);
+    stat_last_bytes = ((minute == (stat_minute + 1)) ? stat_minute_bytes : 0);
+    stat_minute = minute;
+    stat_minute_saves = 0;
+    stat_minute_bytes = 0;
+}
+
+/*
+ * Function name: saved_player
+ * Description  : Called from the master after it saved a player, whether
+ *                that was an autosave or not.
+ * Arguments    : object player - the player saved.
+ *                int bytes - the size of the file written.
+ */
+public void
+saved_player(object player, int bytes)
+{
+    if (previous_object() != find_object(SECURITY))
+    {
+        return;
+    }
+
+    bytes = ((bytes > 0) ? bytes : 0);
+    roll_minute();
+    stat_minute_saves++;
+    stat_minute_bytes += bytes;
+    stat_saves++;
+    stat_bytes += bytes;
+}
+
+/*
+ * Function name: run_tick
+ * Description  : Called every second. The next players in the queue get
+ *                their turn.
+ */
+static void
+run_tick()
+{
+    int turns, writes, index;
+    mixed saved;
+    object player;
+
+    queue -= ({ 0 });
+    if (!sizeof(queue))
+    {
+        remove_alarm(tick_alarm);
+        tick_alarm = 0;
+        return;
+    }
+
+    turns = (sizeof(queue) + AUTOSAVE_INTERVAL - 1) / AUTOSAVE_INTERVAL;
+    for (index = 0; index < turns; index++)
+    {
+        if (writes >= MAX_SAVES_PER_TICK)
+        {
+            stat_deferred += turns - index;
+            break;
+        }
+
+        /* Move the player to the end of the queue before the save, since
+         * the player may unregister while saving.
+         */
+        player = queue[0];
+        queue = queue[1..] + ({ player });
+        if (catch(saved = player->autosave_me(0)))
+        {
+            stat_errors++;
+        }
+        else if (saved)
+        {
+            stat_autosaves++;
+            writes++;
+        }
+        else
+        {
+            stat_skips++;
+        }
+    }
+}
+
+/*
+ * Function name: save_chunk
+ * Description  : Saves the next chunk of players when saving everyone.
+ */
+static void
+save_chunk()
+{
+    object *chunk = save_queue[..(SAVE_ALL_CHUNK - 1)];
+
+    save_queue = save_queue[SAVE_ALL_CHUNK..];
+    foreach(object player: chunk)
+    {
+        if (!objectp(player))
+        {
+            continue;
+        }
+
+        if (catch(player->autosave_me(1)))
+        {
+            stat_errors++;
+        }
+        stat_bulk++;
+    }
+
+    if (sizeof(save_queue))
+    {
+        set_alarm(0.0, 0.0, save_chunk);
+    }
+}
+
+/*
+ * Function name: save_all
+ * Description  : Called from the armageddon when the game is shut down. All
+ *                players in the queue are saved right away, whether they
+ *                did something or not and without the limit on the number
+ *                of writes. They are saved in chunks to stay within the
+ *                evaluation limits.
+ */
+public void
+save_all()
+{
+    if (function_exists("start_shutdown", previous_object()) !=
+        "/secure/armageddon")
+    {
+        return;
+    }
+
+    /* Already busy saving everyone. */
+    if (sizeof(save_queue))
+    {
+        return;
+    }
+
+    save_queue = queue - ({ 0 });
+    if (sizeof(save_queue))
+    {
+        save_chunk();
+    }
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the statistics of the scheduler.
+ * Returns      : mapping - the statistics, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    int minutes = (time() - stat_start) / 60;
+
+    roll_minute();
+    return ([
+        "players"          : sizeof(queue),
+        "saves"            : stat_saves,
+        "autosaves"        : stat_autosaves,
+        "skips"            : stat_skips,
+        "deferred"         : stat_deferred,
+        "bulk"             : stat_bulk,
+        "errors"           : stat_errors,
+        "bytes"            : stat_bytes,
+        "saves_per_minute" : (itof(stat_saves) / itof(minutes ? minutes : 1)),
+        "saves_last"       : stat_last_saves,
+        "bytes_last"       : stat_last_bytes,
+        "since"            : stat_start,
+        ]);
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the number of saves and the bytes written when a
+ *                wizard stats the scheduler.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    mapping stats = query_stats();
+
+    return sprintf("Autosave scheduler since %s\n", ctime(stats["since"])) +
+        sprintf("Players   : %8d    Alarm    : %s\n", stats["players"],
+            (tick_alarm ? "running" : "idle")) +
+        sprintf("Saves     : %8d    Autosave : %d    Skipped : %d\n",
+            stats["saves"], stats["autosaves"], stats["skips"]) +
+        sprintf("Deferred  : %8d    Shutdown : %d    Errors  : %d\n",
+            stats["deferred"], stats["bulk"], stats["errors"]) +
+        sprintf("Bytes     : %8d    Average  : %d per save\n", stats["bytes"],
+            (stats["saves"] ? (stats["bytes"] / stats["saves"]) : 0)) +
+        sprintf("Saves/min : %8.2f    Last minute : %d saves, %d bytes\n",
+            stats["saves_per_minute"], stats["saves_last"],
+            stats["bytes_last"]);
+}
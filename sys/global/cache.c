@@ -0,0 +1,432 @@
+/*
+ * /sys/global/cache.c
+ *
+ * This object holds the read cache of all objects that inherit /lib/cache.
+ * Rather than every object keeping its own small cache, the data files are
+ * kept here once, so a file that is read by several objects only takes
+ * memory once. The cache is limited by the number of bytes the data files
+ * take on disk rather than by the number of files.
+ *
+ * The least recently used files are kept in a doubly linked list, made of
+ * two mappings, so that both a hit and an eviction take constant time.
+ *
+ * This object never touches the disk itself. The objects inheriting
+ * /lib/cache read and save the files with their own rights and hand the
+ * data to this object, only after the read or save succeeded. A file is
+ * only returned from the cache to an object with the same effective user id
+ * as an object that read or saved the file itself, so the cache cannot be
+ * used to read files one has no access to, nor to hand others data that is
+ * not on disk. When others read the file while it did not change on disk,
+ * they are added to the readers of the entry; a save replaces the readers. Only /lib/cache may use the cache. Everyone may query the
+ * statistics.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <macros.h>
+
+/* The number of bytes the cached files may take, as measured on disk. */
+#define CACHE_BUDGET      (1048576)
+
+/* The library that may use the cache. */
+#define CACHE_CLIENT      ("lib/cache.c")
+
+/* Indices into the entries of the cache. */
+#define ENTRY_DATA        (0)
+#define ENTRY_SIZE        (1)
+#define ENTRY_READERS     (2)
+#define ENTRY_OWNER       (3)
+#define ENTRY_TIME        (4)
+
+/* Indices into the statistics of a client. */
+#define STAT_TRIES        (0)
+#define STAT_HITS         (1)
+#define STAT_MISSES       (2)
+#define STAT_EVICTIONS    (3)
+
+/*
+ * Global variables.
+ *
+ * entries - ([ filename : ({ data, size, ([ euid : client ]), client,
+ *                             time }) ]) where the readers map to the
+ *           client that read or saved the file for them.
+ * newer   - ([ filename : the next more recently used filename ])
+ * older   - ([ filename : the next less recently used filename ])
+ * newest  - the most recently used filename.
+ * oldest  - the least recently used filename.
+ * clients - ([ client : ({ tries, hits, misses, evictions }) ])
+ */
+private static mapping entries = ([ ]);
+private static mapping newer = ([ ]);
+private static mapping older = ([ ]);
+private static string  newest;
+private static string  oldest;
+private static int     bytes;
+private static mapping clients = ([ ]);
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+}
+
+/*
+ * Function name: unlink_entry
+ * Description  : Takes a file out of the list of recently used files.
+ * Arguments    : string filename - the file.
+ */
+static void
+unlink_entry(string filename)
+{
+    string prev = older[filename];
+    string next = newer[filename];
+
+    if (stringp(prev))
+    {
+        newer[prev] = next;
+    }
+    else
+    {
+        oldest = next;
+    }
+
+    if (stringp(next))
+    {
+        older[next] = prev;
+    }
+    else
+    {
+        newest = prev;
+    }
+
+    m_delkey(older, filename);
+    m_delkey(newer, filename);
+}
+
+/*
+ * Function name: link_newest
+ * Description  : Puts a file on top of the list of recently used files.
+ * Arguments    : string filename - the file.
+ */
+static void
+link_newest(string filename)
+{
+    if (stringp(newest))
+    {
+        newer[newest] = filename;
+        older[filename] = newest;
+    }
+    else
+    {
+        oldest = filename;
+    }
+
+    newest = filename;
+}
+
+/*
+ * Function name: client_stats
+ * Description  : Finds the statistics of a client, creating them if needed.
+ * Arguments    : string client - the filename of the client.
+ * Returns      : int * - the statistics, see STAT_*.
+ */
+static int *
+client_stats(string client)
+{
+    if (!pointerp(clients[client]))
+    {
+        clients[client] = ({ 0, 0, 0, 0 });
+    }
+
+    return clients[client];
+}
+
+/*
+ * Function name: drop_entry
+ * Description  : Removes a file from the cache.
+ * Arguments    : string filename - the file.
+ */
+static void
+drop_entry(string filename)
+{
+    bytes -= entries[filename][ENTRY_SIZE];
+    unlink_entry(filename);
+    m_delkey(entries, filename);
+}
+
+/*
+ * Function name: query_data
+ * Description  : Returns the data of a file in the cache. The data is not
+ *                copied, /lib/cache does that.
+ * Arguments    : string filename - the file, without ".o".
+ * Returns      : mapping - the data, or 0 when it is not in the cache.
+ */
+public mapping
+query_data(string filename)
+{
+    mixed entry = entries[filename];
+    int   *stats;
+
+    if (calling_program() != CACHE_CLIENT)
+    {
+        return 0;
+    }
+
+    stats = client_stats(MASTER_OB(previous_object()));
+    stats[STAT_TRIES]++;
+
+    if (!pointerp(entry) ||
+        !entry[ENTRY_READERS][geteuid(previous_object())])
+    {
+        stats[STAT_MISSES]++;
+        return 0;
+    }
+
+    stats[STAT_HITS]++;
+    if (filename != newest)
+    {
+        unlink_entry(filename);
+        link_newest(filename);
+    }
+
+    return entry[ENTRY_DATA];
+}
+
+/*
+ * Function name: store_data
+ * Description  : Puts a file in the cache after the caller read or saved it.
+ *                When the caller read a file that did not change on disk
+ *                since it was cached, the caller is only added to its
+ *                readers. Otherwise only the caller may read the data from
+ *                the cache, as the data of others is replaced. Files are
+ *                evicted from the cache until it is within its budget again.
+ * Arguments    : string filename - the file, without ".o".
+ *                mapping data - the data, already copied by /lib/cache.
+ *                int size - the size of the file on disk.
+ *                int time - the time the file was changed on disk.
+ *                int saved - true if the caller saved the file.
+ */
+public void
+store_data(string filename, mapping data, int size, int time, int saved)
+{
+    mixed entry = entries[filename];
+    string owner = MASTER_OB(previous_object());
+    mapping readers = ([ geteuid(previous_object()) : owner ]);
+
+    if (calling_program() != CACHE_CLIENT)
+    {
+        return;
+    }
+
+    /* Someone else read the same file. */
+    if (!saved && pointerp(entry) &&
+        (entry[ENTRY_SIZE] == size) && (entry[ENTRY_TIME] == time))
+    {
+        entry[ENTRY_READERS][geteuid(previous_object())] = owner;
+        if (filename != newest)
+        {
+            unlink_entry(filename);
+            link_newest(filename);
+        }
+        return;
+    }
+
+    /* A file larger than the whole cache is not cached at all. */
+    if (size > CACHE_BUDGET)
+    {
+        if (pointerp(entry))
+        {
+            drop_entry(filename);
+        }
+        return;
+    }
+
+    if (pointerp(entry))
+    {
+        drop_entry(filename);
+    }
+
+    while ((bytes + size > CACHE_BUDGET) &&
+        stringp(oldest))
+    {
+        client_stats(entries[oldest][ENTRY_OWNER])[STAT_EVICTIONS]++;
+        drop_entry(oldest);
+    }
+
+    entries[filename] = ({ data, size, readers, owner, time });
+    bytes += size;
+    link_newest(filename);
+}
+
+/*
+ * Function name: invalidate
+ * Description  : Removes a file from the cache, for instance because it was
+ *                removed or renamed.
+ * Arguments    : string filename - the file, without ".o".
+ */
+public void
+invalidate(string filename)
+{
+    if ((calling_program() == CACHE_CLIENT) &&
+        pointerp(entries[filename]))
+    {
+        drop_entry(filename);
+    }
+}
+
+/*
+ * Function name: query_cached
+ * Description  : Find out whether the caller would get a file from the
+ *                cache.
+ * Arguments    : string filename - the file, without ".o".
+ * Returns      : int 1/0 - true if the file is in the cache.
+ */
+public int
+query_cached(string filename)
+{
+    return (pointerp(entries[filename]) &&
+        entries[filename][ENTRY_READERS][geteuid(previous_object())]);
+}
+
+/*
+ * Function name: query_files
+ * Description  : Returns the files in the cache the caller may read, most
+ *                recently used first.
+ * Returns      : string * - the filenames.
+ */
+public string *
+query_files()
+{
+    string euid = geteuid(previous_object());
+    string *files = ({ });
+    string filename = newest;
+
+    while (stringp(filename))
+    {
+        if (entries[filename][ENTRY_READERS][euid])
+        {
+            files += ({ filename });
+        }
+        filename = older[filename];
+    }
+
+    return files;
+}
+
+/*
+ * Function name: forget_reader
+ * Description  : Flushes the files the program of the caller read or saved
+ *                for its effective user id. Files no one else may read are
+ *                removed from the cache.
+ */
+public void
+forget_reader()
+{
+    string euid = geteuid(previous_object());
+    string owner = MASTER_OB(previous_object());
+
+    if (calling_program() != CACHE_CLIENT)
+    {
+        return;
+    }
+
+    foreach(string filename: m_indexes(entries))
+    {
+        if (entries[filename][ENTRY_READERS][euid] != owner)
+        {
+            continue;
+        }
+
+        m_delkey(entries[filename][ENTRY_READERS], euid);
+        if (!m_sizeof(entries[filename][ENTRY_READERS]))
+        {
+            drop_entry(filename);
+        }
+    }
+}
+
+/*
+ * Function name: query_client_stats
+ * Description  : Returns the statistics of a client of the cache.
+ * Arguments    : mixed client - the client object or its filename.
+ * Returns      : int * - ({ tries, hits, misses, evictions }).
+ */
+public int *
+query_client_stats(mixed client)
+{
+    if (objectp(client))
+    {
+        client = MASTER_OB(client);
+    }
+
+    return (pointerp(clients[client]) ? (clients[client] + ({ })) :
+        ({ 0, 0, 0, 0 }));
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the statistics of the cache.
+ * Returns      : mapping - the statistics, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    int *totals = ({ 0, 0, 0, 0 });
+
+    foreach(string client, int *stats: clients)
+    {
+        for (int index = STAT_TRIES; index <= STAT_EVICTIONS; index++)
+        {
+            totals[index] += stats[index];
+        }
+    }
+
+    return ([
+        "files"     : m_sizeof(entries),
+        "bytes"     : bytes,
+        "budget"    : CACHE_BUDGET,
+        "clients"   : m_sizeof(clients),
+        "tries"     : totals[STAT_TRIES],
+        "hits"      : totals[STAT_HITS],
+        "misses"    : totals[STAT_MISSES],
+        "evictions" : totals[STAT_EVICTIONS],
+        ]);
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the use of the cache when a wizard stats it.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    mapping stats = query_stats();
+    string  str;
+
+    str = sprintf("Files      : %8d    Bytes : %d of %d\n", stats["files"],
+            stats["bytes"], stats["budget"]) +
+        sprintf("Tries      : %8d    Hits  : %d (%d%%)    Evictions : %d\n",
+            stats["tries"], stats["hits"],
+            (stats["tries"] ? ((stats["hits"] * 100) / stats["tries"]) : 0),
+            stats["evictions"]) +
+        sprintf("\n%-40s %8s %8s %8s %8s\n", "Client", "Tries", "Hits",
+            "Misses", "Evicted");
+
+    foreach(string client: sort_array(m_indexes(clients)))
+    {
+        str += sprintf("%-40s %8d %8d %8d %8d\n", client,
+            clients[client][STAT_TRIES], clients[client][STAT_HITS],
+            clients[client][STAT_MISSES], clients[client][STAT_EVICTIONS]);
+    }
+
+    return str;
+}
@@ -572,81 +572,11 @@ paralyze_cmd_is_allowed(string cmd)
     return IN_ARRAY(cmd, gParalyzeCommands);
 }
 
-/*
- * Function name: recurse_neighbours
- * Description  : This function will recursively search through the
- *                neighbouring rooms to a particular room to find the
- *                rooms a shout or scream will be heard in.
- * Arguments    : object *found  - the rooms already found.
- *                object *search - the rooms still to search.
- *                int    depth   - the depth still to search.
- * Returns      : object * - the neighbouring rooms (which will contain the
- *                    original rooms for depth > 1).
- */
-object *
-recurse_neighbours(object *found, object *search, int depth)
-{
-    int index;
-    int size;
-    int index2;
-    int size2;
-    mixed *exit_arr;
-    object *new_search, *rooms, troom, *doors;
-
-    if (!depth)
-    {
-        return found;
-    }
-
-    rooms = found;
-    new_search = ({ });
-
-    index = -1;
-    size = sizeof(search);
-    while(++index < size)
-    {
-        exit_arr = (mixed *)search[index]->query_exit();
-
-        index2 = -3;
-        size2 = sizeof(exit_arr);
-        while((index2 += 3) < size2)
-        {
-            if (functionp(exit_arr[index2]))
-                continue;
-            if (objectp(exit_arr[index2]))
-                troom = exit_arr[index2];
-            else
-                troom = find_object(exit_arr[index2]);
-            if (objectp(troom) &&
-                (member_array(troom, rooms) < 0))
-            {
-                rooms += ({ troom });
-                new_search += ({ troom });
-            }
-        }
-
-        doors = search[index]->query_prop(ROOM_AO_DOOROB);
-
-        index2 = -1;
-        size2 = sizeof(doors);
-        while (++index2 < size2)
-        {
-            if (objectp(troom = find_object(doors[index2]->query_other_room())) &&
-                member_array(troom, rooms) < 0)
-            {
-                rooms += ({ troom });
-            }
-        }
-    }
-
-    return recurse_neighbours(rooms, new_search, depth - 1);
-}
-
 /*
  * Function name: find_neighbours
- * Description  : This function will recursively search through the
- *                neighbouring rooms to a particular room to find the
- *                rooms a shout or scream will be heard in.
+ * Description  : This function will search through the neighbouring rooms
+ *                to a particular room to find the rooms a shout or scream
+ *                will be heard in. The search is done in the room graph.
  * Arguments    : object *search - the rooms still to search.
  *                int    depth   - the depth still to search.
  *                int with_seed  - if true, include the seed room(s).
@@ -659,7 +589,7 @@ find_neighbours(object *search, int depth = 1, int with_seed = 0)
 
     if (!pointerp(search)) { search = ({ search }); }
 
-    results = recurse_neighbours( ({ }), search, depth);
+    results = ROOM_GRAPH->query_neighbours(search, depth);
 
     return with_seed ? results : (results - search);
 }
@@ -0,0 +1,475 @@
+/*
+ * /sys/global/combat_scheduler.c
+ *
+ * This daemon runs the combat rounds of all fighting livings. Rather than
+ * every combat object keeping its own repeating alarm, the combat objects
+ * register themselves here and the scheduler executes all rounds that are
+ * due in batches from a single alarm.
+ *
+ * The rounds are kept in a timing wheel of WHEEL_SIZE slots, each slot
+ * covering WHEEL_TICK seconds. A combatant is stored in the slot of the
+ * tick at which its next round is due. Intervals longer than one rotation
+ * of the wheel simply stay in their slot until their tick comes around.
+ *
+ * The combat objects (/std/combat/cbase.c) use the following calls:
+ *
+ *    schedule_round(float speed)      - start the rounds of the caller.
+ *    update_round_speed(float old, float new)
+ *                                     - the speed of the caller changed.
+ *    unschedule_round()               - stop the rounds of the caller.
+ *
+ * Each round is executed by calling cb_combat_round() in the combat object.
+ * The alarm only runs as long as there is someone fighting.
+ *
+ * The wheel turns one tick with every call of the alarm rather than with the
+ * clock, so when the driver lags the rounds are spread out in time instead
+ * of being executed in a burst. The lag is the number of ticks a round was
+ * executed later than it was due, because the budget of a tick ran out.
+ *
+ * The wheel only lives in memory. When the scheduler is updated or
+ * destructed, remove_object() tells every combat object when its next round
+ * is due, and it registers again with the new scheduler right after, see
+ * cb_scheduler_handover() in /std/combat/cbase.c.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <macros.h>
+
+/* The granularity of the wheel in seconds, and the number of slots. */
+#define WHEEL_TICK          (0.5)
+#define WHEEL_SIZE          (128)
+
+/* The maximum number of rounds we run in a single tick. Rounds that do not
+ * fit are executed in the next tick and show up as lag.
+ */
+#define MAX_ROUNDS_PER_TICK (250)
+
+/* Indices into the combatant entries. */
+#define ENTRY_DUE           (0)
+#define ENTRY_INTERVAL      (1)
+
+/*
+ * Global variables.
+ */
+private static mixed   *wheel = allocate(WHEEL_SIZE);
+private static mapping entries = ([ ]);
+private static int     alarm_tick;
+private static int     last_tick;
+private static int     tick_alarm;
+
+/*
+ * Statistics.
+ */
+private static int     stat_start;
+private static int     stat_ticks;
+private static int     stat_rounds;
+private static int     stat_last_rounds;
+private static int     stat_max_rounds;
+private static int     stat_deferred;
+private static int     stat_errors;
+private static int     stat_lag;
+private static int     stat_last_lag;
+private static int     stat_max_lag;
+
+/*
+ * Prototypes.
+ */
+static void run_ticks();
+
+/*
+ * Function name: create
+ * Description  : Initialise the wheel.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    for (int index = 0; index < WHEEL_SIZE; index++)
+    {
+        wheel[index] = ([ ]);
+    }
+
+    stat_start = time();
+}
+
+/*
+ * Function name: remove_object
+ * Description  : Before we are destructed, the combat objects are told when
+ *                their next round is due, so they can register with the next
+ *                scheduler.
+ */
+public void
+remove_object()
+{
+    if (tick_alarm)
+    {
+        remove_alarm(tick_alarm);
+        tick_alarm = 0;
+    }
+
+    foreach(object ob, mixed entry: entries)
+    {
+        /* Overdue rounds are due in the first tick. */
+        if (objectp(ob) &&
+            catch(ob->cb_scheduler_handover(
+                itof(MAX(entry[ENTRY_DUE] - alarm_tick, 1)) * WHEEL_TICK)))
+        {
+            stat_errors++;
+        }
+    }
+
+    destruct();
+}
+
+/*
+ * Function name: speed_to_ticks
+ * Description  : Converts a combat speed in seconds to a number of ticks.
+ * Arguments    : float speed - the time between two rounds.
+ * Returns      : int - the number of ticks, at least one.
+ */
+static int
+speed_to_ticks(float speed)
+{
+    int ticks = ftoi((speed / WHEEL_TICK) + 0.5);
+
+    return ((ticks > 0) ? ticks : 1);
+}
+
+/*
+ * Function name: insert_entry
+ * Description  : Puts a combatant in the slot of the tick it is due.
+ * Arguments    : object ob - the combat object.
+ *                int due - the tick the next round is due.
+ *                int interval - the number of ticks between rounds.
+ */
+static void
+insert_entry(object ob, int due, int interval)
+{
+    entries[ob] = ({ due, interval });
+    wheel[due % WHEEL_SIZE][ob] = 1;
+}
+
+/*
+ * Function name: delete_entry
+ * Description  : Removes a combatant from the wheel.
+ * Arguments    : object ob - the combat object.
+ */
+static void
+delete_entry(object ob)
+{
+    mixed entry = entries[ob];
+
+    if (pointerp(entry))
+    {
+        m_delkey(wheel[entry[ENTRY_DUE] % WHEEL_SIZE], ob);
+        m_delkey(entries, ob);
+    }
+}
+
+/*
+ * Function name: start_ticking
+ * Description  : Makes sure the alarm runs when there are combatants.
+ */
+static void
+start_ticking()
+{
+    if (tick_alarm)
+    {
+        return;
+    }
+
+    last_tick = alarm_tick;
+    tick_alarm = set_alarm(WHEEL_TICK, WHEEL_TICK, run_ticks);
+}
+
+/*
+ * Function name: schedule_round
+ * Description  : Called from the combat object to start its combat rounds.
+ *                The first round is executed after one interval, or after
+ *                the delay if one is given. If the caller already is
+ *                scheduled, nothing happens.
+ * Arguments    : float speed - the time between two rounds.
+ *                float delay - optional, the time until the first round.
+ */
+public varargs void
+schedule_round(float speed, float delay)
+{
+    object ob = previous_object();
+    int interval;
+
+    if (pointerp(entries[ob]) ||
+        !function_exists("cb_combat_round", ob))
+    {
+        return;
+    }
+
+    start_ticking();
+    interval = speed_to_ticks(speed);
+    insert_entry(ob, last_tick + ((delay > 0.0) ? speed_to_ticks(delay) :
+        interval), interval);
+}
+
+/*
+ * Function name: update_round_speed
+ * Description  : Called from the combat object when its speed changes. The
+ *                part of the interval still to go is scaled to the new
+ *                speed, and the entry is moved to its new slot.
+ * Arguments    : float oldspeed - the previous time between rounds.
+ *                float newspeed - the new time between rounds.
+ */
+public void
+update_round_speed(float oldspeed, float newspeed)
+{
+    object ob = previous_object();
+    mixed entry = entries[ob];
+    int remaining;
+
+    if (!pointerp(entry) ||
+        (oldspeed <= 0.0))
+    {
+        return;
+    }
+
+    remaining = entry[ENTRY_DUE] - last_tick;
+    remaining = ftoi(itof(remaining) * (newspeed / oldspeed) + 0.5);
+
+    m_delkey(wheel[entry[ENTRY_DUE] % WHEEL_SIZE], ob);
+    insert_entry(ob, last_tick + ((remaining > 0) ? remaining : 1),
+        speed_to_ticks(newspeed));
+}
+
+/*
+ * Function name: unschedule_round
+ * Description  : Called from the combat object to stop its combat rounds.
+ */
+public void
+unschedule_round()
+{
+    delete_entry(previous_object());
+}
+
+/*
+ * Function name: run_slot
+ * Description  : Executes all rounds in the slot of a tick that are due.
+ * Arguments    : int tick - the tick to process.
+ *                int budget - the number of rounds we may still run.
+ * Returns      : int - the number of rounds executed, or -1 if we ran out
+ *                      of budget before the slot was done.
+ */
+static int
+run_slot(int tick, int budget)
+{
+    mapping slot = wheel[tick % WHEEL_SIZE];
+    object *obs = m_indexes(slot);
+    mixed entry;
+    int lag, rounds, deferred;
+
+    foreach(object ob: obs)
+    {
+        if (!objectp(ob))
+        {
+            m_delkey(slot, ob);
+            continue;
+        }
+
+        entry = entries[ob];
+        if (!pointerp(entry))
+        {
+            m_delkey(slot, ob);
+            continue;
+        }
+
+        /* Not due in this rotation of the wheel. */
+        if (entry[ENTRY_DUE] > tick)
+        {
+            continue;
+        }
+
+        /* Out of budget. Count what is left and try again next tick. */
+        if (rounds >= budget)
+        {
+            deferred++;
+            continue;
+        }
+
+        /* Reschedule before the round, so the round itself may stop or
+         * change the speed of the combatant.
+         */
+        m_delkey(slot, ob);
+        insert_entry(ob, tick + entry[ENTRY_INTERVAL],
+            entry[ENTRY_INTERVAL]);
+
+        lag = alarm_tick - entry[ENTRY_DUE];
+        stat_lag += lag;
+        if (lag > stat_max_lag)
+        {
+            stat_max_lag = lag;
+        }
+        stat_last_lag = lag;
+
+        if (catch(ob->cb_combat_round()))
+        {
+            stat_errors++;
+        }
+        rounds++;
+    }
+
+    if (deferred)
+    {
+        stat_deferred += deferred;
+        return -1;
+    }
+
+    return rounds;
+}
+
+/*
+ * Function name: run_ticks
+ * Description  : Called every tick from the alarm. It executes the slots
+ *                of all ticks that passed since the previous call.
+ */
+static void
+run_ticks()
+{
+    int now = ++alarm_tick;
+    int rounds, done;
+
+    /* When we lagged a full rotation, every slot is visited once anyway. */
+    if ((now - last_tick) > WHEEL_SIZE)
+    {
+        last_tick = now - WHEEL_SIZE;
+    }
+
+    while (last_tick < now)
+    {
+        done = run_slot(last_tick + 1, MAX_ROUNDS_PER_TICK - rounds);
+        if (done < 0)
+        {
+            rounds = MAX_ROUNDS_PER_TICK;
+            break;
+        }
+
+        rounds += done;
+        last_tick++;
+    }
+
+    stat_ticks++;
+    stat_rounds += rounds;
+    stat_last_rounds = rounds;
+    if (rounds > stat_max_rounds)
+    {
+        stat_max_rounds = rounds;
+    }
+
+    if (!m_sizeof(entries))
+    {
+        remove_alarm(tick_alarm);
+        tick_alarm = 0;
+    }
+}
+
+/*
+ * Function name: query_scheduled
+ * Description  : Find out whether a combat object has its rounds running.
+ * Arguments    : object ob - the combat object.
+ * Returns      : int - 1/0 - scheduled or not.
+ */
+public int
+query_scheduled(object ob)
+{
+    return pointerp(entries[ob]);
+}
+
+/*
+ * Function name: query_next_round
+ * Description  : Find out how long it takes before the next round of a
+ *                combat object is executed.
+ * Arguments    : object ob - the combat object.
+ * Returns      : float - the time in seconds, or -1.0 if not scheduled.
+ *                        When the driver lags it takes longer.
+ */
+public float
+query_next_round(object ob)
+{
+    mixed entry = entries[ob];
+
+    if (!pointerp(entry))
+    {
+        return -1.0;
+    }
+
+    return itof(entry[ENTRY_DUE] - alarm_tick) * WHEEL_TICK;
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the statistics of the scheduler.
+ * Returns      : mapping - the statistics, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    return ([
+        "combatants"      : m_sizeof(entries),
+        "ticks"           : stat_ticks,
+        "rounds"          : stat_rounds,
+        "rounds_last"     : stat_last_rounds,
+        "rounds_max"      : stat_max_rounds,
+        "rounds_per_tick" : (stat_ticks ? (itof(stat_rounds) / itof(stat_ticks)) : 0.0),
+        "deferred"        : stat_deferred,
+        "errors"          : stat_errors,
+        "lag_avg"         : (stat_rounds ? (itof(stat_lag) / itof(stat_rounds)) : 0.0),
+        "lag_last"        : stat_last_lag,
+        "lag_max"         : stat_max_lag,
+        "since"           : stat_start,
+        ]);
+}
+
+/*
+ * Function name: reset_stats
+ * Description  : Resets the statistics of the scheduler.
+ */
+public void
+reset_stats()
+{
+    stat_start = time();
+    stat_ticks = 0;
+    stat_rounds = 0;
+    stat_last_rounds = 0;
+    stat_max_rounds = 0;
+    stat_deferred = 0;
+    stat_errors = 0;
+    stat_lag = 0;
+    stat_last_lag = 0;
+    stat_max_lag = 0;
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Gives the combat load when a wizard stats the scheduler.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    mapping stats = query_stats();
+
+    return sprintf("Combat scheduler since %s\n", ctime(stats["since"])) +
+        sprintf("Combatants : %6d    Alarm  : %s\n", stats["combatants"],
+            (tick_alarm ? "running" : "idle")) +
+        sprintf("Ticks      : %6d    Rounds : %d\n", stats["ticks"],
+            stats["rounds"]) +
+        sprintf("Rounds/tick: %6.2f    Last   : %d    Max : %d\n",
+            stats["rounds_per_tick"], stats["rounds_last"],
+            stats["rounds_max"]) +
+        sprintf("Lag (ticks): %6.2f    Last   : %d    Max : %d\n",
+            stats["lag_avg"], stats["lag_last"], stats["lag_max"]) +
+        sprintf("Deferred   : %6d    Errors : %d\n", stats["deferred"],
+            stats["errors"]);
+}
@@ -4,6 +4,7 @@
 #pragma save_binary
 #pragma strict_types
 
+#include <files.h>
 #include <language.h>
 #include <options.h>
 #include <stdproperties.h>
@@ -346,6 +347,72 @@ lpc_describe(mixed *uarr, function dfun, object for_obj)
     return (sizeof(a) ? composite_words(a) : 0);
 }
 
+/*
+ * Function name: stable_short
+ * Description  : Find out whether the short description of an object is the
+ *                same for everyone who can see it, i.e. whether it is a
+ *                plain string from /std/object, /std/heap or /std/living.
+ * Arguments    : object ob - the object to test.
+ * Returns      : int 1/0 - stable or not.
+ */
+public int
+stable_short(object ob)
+{
+    string prog = function_exists("short", ob);
+
+    if (objectp(shadow(ob, 0)))
+    {
+        return 0;
+    }
+
+    if (living(ob))
+    {
+        if ((prog != LIVING_OBJECT) ||
+            (function_exists("query_nonmet_name", ob) != LIVING_OBJECT) ||
+            (function_exists("query_met_name", ob) != LIVING_OBJECT) ||
+            (function_exists("query_race_name", ob) != LIVING_OBJECT) ||
+            (function_exists("query_gender", ob) != LIVING_OBJECT))
+        {
+            return 0;
+        }
+    }
+    /* Large heaps show their count only to those clever enough. */
+    else if ((prog == HEAP_OBJECT) ? (ob->num_heap() > 12) :
+        (prog != OBJECT_OBJECT))
+    {
+        return 0;
+    }
+
+    prog = function_exists("plural_short", ob);
+    if ((prog != OBJECT_OBJECT) && (prog != HEAP_OBJECT))
+    {
+        return 0;
+    }
+
+    foreach(mixed str: ({ ob->query_short(), ob->query_plural_short() }))
+    {
+        if (str && (!stringp(str) || wildmatch("*@@*", str)))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Function name: filter_stable
+ * Description  : Find the objects whose short description is the same for
+ *                everyone who can see them. See COMPOSITE_STABLE.
+ * Arguments    : object *obs - the objects to test.
+ * Returns      : object * - the stable objects.
+ */
+public object *
+filter_stable(object *obs)
+{
+    return filter(obs, stable_short);
+}
+
 /*
  * Function name: composite_words
  * Description  : Concatenates a range of words with commas and a closer.
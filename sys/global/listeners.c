@@ -14,12 +14,19 @@
  * following routine for each newly cloned object.
  *
  *    (void) notify_new_object(object obj)
+ *
+ * A listener that is only interested in some objects registers with a
+ * filter, see LISTENER_ADD_FILTER in <files.h>. It is then only called for
+ * objects that match at least one of the criteria of the filter. The
+ * waiting objects are grouped by program, so the path and inheritance
+ * criteria are checked once for each program rather than for every object.
  */
 
 #pragma strict_types
 #pragma no_clone
 #pragma no_inherit
 
+#include <files.h>
 #include <macros.h>
 
 // Global Variables
@@ -27,6 +34,17 @@ public function *       listeners = ({ });
 public object *         waiting_objects = ({ });
 public int              process_alarm = 0;
 
+// Filtered listeners, ([ listener : ([ criterion : ({ values }) ]) ]), and
+// the listeners that match a program, ([ program : ({ listeners }) ]).
+public mapping          filtered = ([ ]);
+public mapping          program_matches = ([ ]);
+
+// Statistics
+public int              stat_objects = 0;
+public int              stat_programs = 0;
+public int              stat_calls = 0;
+public int              stat_avoided = 0;
+
 // Prototypes
 public void             process_objects();
 
@@ -41,14 +59,153 @@ create()
     seteuid(getuid());
 }
 
+/*
+ * Function Name: fix_path
+ * Description  : Make sure a program path has the same format as the
+ *                result of MASTER_OB(), with a leading / and without .c.
+ * Arguments    : string path - the path.
+ * Returns      : string - the normalised path.
+ */
+static string
+fix_path(string path)
+{
+    if (path[0] != '/')
+    {
+        path = "/" + path;
+    }
+    if (path[-2..] == ".c")
+    {
+        path = path[..-3];
+    }
+    return path;
+}
+
+/*
+ * Function Name: normalise_filter
+ * Description  : Make sure every criterion of a filter is an array, and
+ *                that the paths are normalised.
+ * Arguments    : mapping filter - the filter as given by the listener.
+ * Returns      : mapping - the normalised filter.
+ */
+static mapping
+normalise_filter(mapping filter)
+{
+    mapping result = ([ ]);
+    mixed values;
+
+    foreach(string criterion: ({ LISTEN_PATH, LISTEN_PREFIX, LISTEN_INHERIT,
+        LISTEN_PROP }))
+    {
+        values = filter[criterion];
+        if (!values)
+        {
+            continue;
+        }
+        if (!pointerp(values))
+        {
+            values = ({ values });
+        }
+        if (criterion != LISTEN_PROP)
+        {
+            values = map(values, fix_path);
+        }
+        result[criterion] = values;
+    }
+
+    return result;
+}
+
+/*
+ * Function Name: match_prefix
+ * Description  : Find out whether a program lies below a path prefix.
+ * Arguments    : string program - the program, as MASTER_OB().
+ *                string prefix - the prefix.
+ * Returns      : int 1/0 - true if the program starts with the prefix.
+ */
+static int
+match_prefix(string program, string prefix)
+{
+    return (program[..(strlen(prefix) - 1)] == prefix);
+}
+
+/*
+ * Function Name: match_program
+ * Description  : Find the filtered listeners that want all objects of a
+ *                program, and those that want some of them depending on
+ *                their properties. The result is cached per program.
+ * Arguments    : string program - the program, as MASTER_OB().
+ *                object obj - an object of the program.
+ * Returns      : mixed - ({ listeners matching the program,
+ *                           listeners with property criteria })
+ */
+static mixed
+match_program(string program, object obj)
+{
+    object *all = ({ });
+    object *props = ({ });
+    string *inherits = 0;
+    mapping criteria;
+
+    if (pointerp(program_matches[program]))
+    {
+        return program_matches[program];
+    }
+
+    foreach(object listener: m_indexes(filtered))
+    {
+        criteria = filtered[listener];
+        if (pointerp(criteria[LISTEN_PATH]) &&
+            IN_ARRAY(program, criteria[LISTEN_PATH]))
+        {
+            all += ({ listener });
+            continue;
+        }
+
+        if (pointerp(criteria[LISTEN_PREFIX]) &&
+            sizeof(filter(criteria[LISTEN_PREFIX], &match_prefix(program))))
+        {
+            all += ({ listener });
+            continue;
+        }
+
+        if (pointerp(criteria[LISTEN_INHERIT]))
+        {
+            if (!inherits)
+            {
+                inherits = map(inherit_list(obj), fix_path);
+            }
+            if (sizeof(criteria[LISTEN_INHERIT] & inherits))
+            {
+                all += ({ listener });
+                continue;
+            }
+        }
+
+        if (pointerp(criteria[LISTEN_PROP]))
+        {
+            props += ({ listener });
+        }
+    }
+
+    stat_programs++;
+    program_matches[program] = ({ all, props });
+    return program_matches[program];
+}
+
 /*
  * Function Name: register_listener
  * Description  : A listener who wants to be notified whenever a new
- *                object is cloned will register themselves here.
- * Macro call   : LISTENER_ADD(obj) in <files.h>
+ *                object is cloned will register themselves here. With a
+ *                filter, the listener is only notified of the objects
+ *                that match it.
+ * Arguments    : mixed listener - the listener object or its filename.
+ *                mapping filter - the optional filter, see <files.h>.
+ * Returns      : int 1/0 - registered or not.
+ * Macro call   : LISTENER_ADD(obj) or LISTENER_ADD_FILTER(obj, filter) in
+ *                <files.h>
  */
-public int
-register_listener(mixed listener)
+public varargs int
+register_listener(mixed listener, mapping filter)
 {
     object listener_obj;
     function listener_fun;
@@ -69,6 +226,15 @@ register_listener(mixed listener)
 
     listener_fun = listener_obj->notify_new_object;
     listeners -= ({ listener_fun, 0 });
+    m_delkey(filtered, listener_obj);
+    program_matches = ([ ]);
+
+    if (m_sizeof(filter))
+    {
+        filtered[listener_obj] = normalise_filter(filter);
+        return 1;
+    }
+
     listeners += ({ listener_fun });
     return 1;
 }
@@ -100,6 +266,8 @@ unregister_listener(mixed listener)
 
     listener_fun = listener_obj->notify_new_object;
     listeners -= ({ listener_fun, 0 });
+    m_delkey(filtered, listener_obj);
+    program_matches = ([ ]);
     return 1;    
 }
 
@@ -116,17 +284,27 @@ process_objects()
     // all the objects to be processed to a local variable. That
     // way there should be no race conditions.
     object * local_waiting_objects = waiting_objects + ({ });
+    mapping buckets = ([ ]);
+    mixed matches;
+    string program;
+    int index;
     
     waiting_objects = ({ });
     process_alarm = 0;
 
     // Validate the listeners first
     listeners -= ({ 0 }); // remove invalid listeners
+    if (member_array(0, m_indexes(filtered)) >= 0)
+    {
+        m_delkey(filtered, 0);
+        program_matches = ([ ]);
+    }
     // Validate the waiting objects
     local_waiting_objects -= ({ 0 }); // remove empty/invalid objects
 
     int nNumObjects = sizeof(local_waiting_objects);
     int nNumListeners = sizeof(listeners);
+    stat_objects += nNumObjects;
     for (int nCurrentListenerIndex = 0; nCurrentListenerIndex < nNumListeners; ++nCurrentListenerIndex)
     {
         function fListener = listeners[nCurrentListenerIndex];
@@ -135,17 +313,65 @@ process_objects()
             catch(fListener(local_waiting_objects[nCurrentObjIndex]));
         }
     }
-/*
-    // Removed foreach because there is a gamedriver bug with function refcounts
-    foreach (object obj: local_waiting_objects)
+    stat_calls += nNumListeners * nNumObjects;
+
+    if (!m_sizeof(filtered))
+    {
+        return;
+    }
+
+    // Group the objects by program, so the filters are checked once
+    // for every program.
+    for (index = 0; index < nNumObjects; index++)
     {
-        foreach (function listener_func : listeners)
+        program = MASTER_OB(local_waiting_objects[index]);
+        if (pointerp(buckets[program]))
         {
-            // We use catch te prevent runtimes from stopping the process.
-            catch(listener_func(obj));
+            buckets[program] += ({ local_waiting_objects[index] });
         }
-    }  
-*/  
+        else
+        {
+            buckets[program] = ({ local_waiting_objects[index] });
+        }
+    }
+
+    foreach(string path, object *objs: buckets)
+    {
+        matches = match_program(path, objs[0]);
+        stat_avoided += sizeof(objs) *
+            (m_sizeof(filtered) - sizeof(matches[0]) - sizeof(matches[1]));
+
+        foreach(object listener: matches[0])
+        {
+            foreach(object obj: objs)
+            {
+                if (objectp(listener) && objectp(obj))
+                {
+                    catch(listener->notify_new_object(obj));
+                    stat_calls++;
+                }
+            }
+        }
+
+        foreach(object listener: matches[1])
+        {
+            foreach(object obj: objs)
+            {
+                if (!objectp(listener) || !objectp(obj))
+                {
+                    continue;
+                }
+                if (!sizeof(filter(filtered[listener][LISTEN_PROP],
+                    &call_other(obj, "query_prop"))))
+                {
+                    stat_avoided++;
+                    continue;
+                }
+                catch(listener->notify_new_object(obj));
+                stat_calls++;
+            }
+        }
+    }
 }
 
 /*
@@ -175,3 +401,35 @@ register_new_object(object obj)
         process_alarm = set_alarm(1.0, 0.0, process_objects);
     }
 }
+
+/*
+ * Function Name: query_stats
+ * Description  : Returns the counters of the registry.
+ * Returns      : mapping - the counters, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    return ([ "listeners" : sizeof(listeners),
+              "filtered"  : m_sizeof(filtered),
+              "objects"   : stat_objects,
+              "programs"  : stat_programs,
+              "calls"     : stat_calls,
+              "avoided"   : stat_avoided ]);
+}
+
+/*
+ * Function Name: stat_object
+ * Description  : Shows the counters when a wizard stats the registry.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    return sprintf("Listeners  : %6d    Filtered : %d\n", sizeof(listeners),
+            m_sizeof(filtered)) +
+        sprintf("Objects    : %6d    Programs matched : %d\n", stat_objects,
+            stat_programs) +
+        sprintf("Calls made : %6d    Calls avoided by filters : %d\n",
+            stat_calls, stat_avoided);
+}
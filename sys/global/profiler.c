@@ -0,0 +1,684 @@
+/*
+ * /sys/global/profiler.c
+ *
+ * This is the profiler of the mudlib. A wizard starts a profile of a
+ * program, e.g. /std/combat/cbase, or of all programs in a directory, e.g.
+ * a domain, for a number of seconds. During the profile we measure:
+ *
+ * - all functions of the programs, through the profile the gamedriver keeps
+ *   of every program. We take the counters at the start and subtract them
+ *   at the end, which gives the number of calls and the evaluation cost of
+ *   every function during the profile. As the gamedriver keeps the profile
+ *   per program, all clones of a program are counted together.
+ *
+ * - the sections that are marked with PROFILE_ENTER() and PROFILE_LEAVE()
+ *   from <profile.h> in the programs. For every section we count the calls
+ *   and the evaluation cost, and we keep track of how the sections nest.
+ *   Wall time is not measured, as the clock of the gamedriver only advances
+ *   once per heartbeat.
+ *
+ * The results can be shown as a ranked report, or exported as CSV or in
+ * the folded stack format of the flame graph tools. The tracer command
+ * 'Profile' is the interface for wizards.
+ *
+ * Only one profile runs at a time. Outside a profile, the calls from the
+ * PROFILE macros return right away.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <files.h>
+#include <macros.h>
+#include <profile.h>
+#include <std.h>
+
+/* The default and maximum duration of a profile in seconds. */
+#define DEFAULT_DURATION  (60)
+#define MAX_DURATION      (3600)
+
+/* The maximum number of programs we profile in a directory. */
+#define MAX_PROGRAMS      (500)
+
+/* The maximum depth of nested sections. */
+#define MAX_DEPTH         (32)
+
+/* Indices into the frames on the stack. */
+#define FRAME_PROGRAM     (0)
+#define FRAME_NAME        (1)
+#define FRAME_EVAL        (2)
+#define FRAME_CHILD_COST  (3)
+
+/* Indices into the section counters. */
+#define SECT_CALLS        (0)
+#define SECT_COST         (1)
+
+/*
+ * Global variables.
+ *
+ * targets  - the programs and directories being profiled.
+ * programs - the loaded programs measured through the gamedriver.
+ * baseline - ([ program : ([ function : ({ calls, cost }) ]) ]) the
+ *            counters of the gamedriver at the start of the profile.
+ * result   - the same, with the counters during the profile, once it ended.
+ * sections - ([ program : ([ section : ({ calls, cost }) ]) ])
+ * folded   - ([ stack : cost ]) the exclusive cost of each nesting of
+ *            sections.
+ * stack    - the sections that are open right now.
+ * matches  - ([ program : 1/-1 ]) whether a calling program is profiled.
+ */
+private static string  *targets = ({ });
+private static string  *programs = ({ });
+private static mapping baseline = ([ ]);
+private static mapping result = 0;
+private static mapping sections = ([ ]);
+private static mapping folded = ([ ]);
+private static mixed   *stack = ({ });
+private static mapping matches = ([ ]);
+private static int     running;
+private static int     stop_alarm;
+private static int     duration;
+private static int     started;
+private static int     stopped;
+private static string  owner;
+
+/*
+ * Prototypes.
+ */
+public int stop_profile();
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+}
+
+/*
+ * Function name: allowed
+ * Description  : Only full wizards may run the profiler.
+ * Returns      : int 1/0 - allowed or not.
+ */
+static int
+allowed()
+{
+    return (objectp(this_interactive()) && (WIZ_CHECK >= WIZ_NORMAL));
+}
+
+/*
+ * Function name: fix_target
+ * Description  : Makes a program or directory into the form we use, that is
+ *                a program without ".c" and a directory with a trailing "/".
+ * Arguments    : string target - the program or directory.
+ * Returns      : string - the target, or 0 if it does not exist.
+ */
+static string
+fix_target(string target)
+{
+    if (!strlen(target))
+    {
+        return 0;
+    }
+    if (target[0] != '/')
+    {
+        target = "/" + target;
+    }
+    if (wildmatch("*.c", target))
+    {
+        target = target[..-3];
+    }
+
+    if (file_size(target) == -2)
+    {
+        return ((target[-1..] == "/") ? target : (target + "/"));
+    }
+    if ((target[-1..] == "/") && (file_size(target[..-2]) == -2))
+    {
+        return target;
+    }
+    if (file_size(target + ".c") > 0)
+    {
+        return target;
+    }
+    return 0;
+}
+
+/*
+ * Function name: scan_dir
+ * Description  : Finds the loaded programs in a directory and the
+ *                directories below it.
+ * Arguments    : string dir - the directory, with a trailing "/".
+ *                string *found - the programs found so far.
+ * Returns      : string * - the programs found.
+ */
+static string *
+scan_dir(string dir, string *found)
+{
+    string *files = get_dir(dir);
+
+    foreach(string file: (pointerp(files) ? files : ({ })))
+    {
+        if (sizeof(found) >= MAX_PROGRAMS)
+        {
+            break;
+        }
+        if ((file == ".") || (file == ".."))
+        {
+            continue;
+        }
+
+        if (file_size(dir + file) == -2)
+        {
+            found = scan_dir(dir + file + "/", found);
+        }
+        else if (wildmatch("*.c", file) &&
+            objectp(find_object(dir + file[..-3])))
+        {
+            found += ({ dir + file[..-3] });
+        }
+    }
+
+    return found;
+}
+
+/*
+ * Function name: snapshot
+ * Description  : Takes the counters the gamedriver keeps for the functions
+ *                of the profiled programs.
+ * Returns      : mapping - ([ program : ([ function : ({ calls, cost }) ]) ])
+ */
+static mapping
+snapshot()
+{
+    mapping shot = ([ ]);
+    mixed   profile;
+    object  ob;
+    string  func;
+    int     calls, cost;
+
+    foreach(string program: programs)
+    {
+        if (!objectp(ob = find_object(program)))
+        {
+            continue;
+        }
+
+        profile = SECURITY->do_debug("getprofile", ob);
+        if (!pointerp(profile))
+        {
+            continue;
+        }
+
+        shot[program] = ([ ]);
+        foreach(string line: profile)
+        {
+            if (sscanf(line, "%d:%d: %s", calls, cost, func) == 3)
+            {
+                shot[program][func] = ({ calls, cost });
+            }
+        }
+    }
+
+    return shot;
+}
+
+/*
+ * Function name: difference
+ * Description  : Subtracts the baseline from a snapshot of the counters.
+ * Arguments    : mapping shot - the snapshot, see snapshot().
+ * Returns      : mapping - the counters during the profile, without the
+ *                    functions that were not called.
+ */
+static mapping
+difference(mapping shot)
+{
+    mapping diff = ([ ]);
+    mixed   base;
+    int     calls, cost;
+
+    foreach(string program, mapping funcs: shot)
+    {
+        diff[program] = ([ ]);
+        foreach(string func, int *counters: funcs)
+        {
+            base = (mappingp(baseline[program]) ?
+                baseline[program][func] : 0);
+            calls = counters[0] - (pointerp(base) ? base[0] : 0);
+            cost = counters[1] - (pointerp(base) ? base[1] : 0);
+            if (calls > 0)
+            {
+                diff[program][func] = ({ calls, cost });
+            }
+        }
+    }
+
+    return diff;
+}
+
+/*
+ * Function name: start_profile
+ * Description  : Starts a profile of a program or a directory. A profile
+ *                that is running is stopped and its results are lost.
+ * Arguments    : string *what - the programs and directories.
+ *                int seconds - the duration, 0 for the default.
+ * Returns      : string - an error message, or 0 if the profile started.
+ */
+public string
+start_profile(string *what, int seconds)
+{
+    string target;
+
+    if (!allowed())
+    {
+        return "You are not allowed to profile.\n";
+    }
+
+    targets = ({ });
+    programs = ({ });
+    foreach(string item: what)
+    {
+        if (!stringp(target = fix_target(item)))
+        {
+            return "There is no program or directory " + item + ".\n";
+        }
+
+        targets += ({ target });
+        if (target[-1..] == "/")
+        {
+            programs = scan_dir(target, programs);
+        }
+        else if (objectp(find_object(target)))
+        {
+            programs += ({ target });
+        }
+    }
+
+    if (running)
+    {
+        stop_profile();
+    }
+
+    remove_alarm(stop_alarm);
+    duration = ((seconds > 0) ? min(seconds, MAX_DURATION) :
+        DEFAULT_DURATION);
+    owner = this_interactive()->query_real_name();
+    started = time();
+    stopped = 0;
+    baseline = snapshot();
+    result = 0;
+    sections = ([ ]);
+    folded = ([ ]);
+    stack = ({ });
+    matches = ([ ]);
+    running = 1;
+    stop_alarm = set_alarm(itof(duration), 0.0, stop_profile);
+    return 0;
+}
+
+/*
+ * Function name: stop_profile
+ * Description  : Stops the profile and keeps the results. When the profile
+ *                ran out, the wizard who started it is told.
+ * Returns      : int 1/0 - stopped or no profile running.
+ */
+public int
+stop_profile()
+{
+    object wizard;
+
+    if (!running ||
+        ((previous_object() != this_object()) && !allowed()))
+    {
+        return 0;
+    }
+
+    remove_alarm(stop_alarm);
+    stop_alarm = 0;
+    running = 0;
+    stopped = time();
+    result = difference(snapshot());
+    stack = ({ });
+
+    if (!objectp(this_interactive()) &&
+        objectp(wizard = find_player(owner)))
+    {
+        tell_object(wizard, "The profile of " + implode(targets, ", ") +
+            " has finished. Use 'Profile report' to see the results.\n");
+    }
+    return 1;
+}
+
+/*
+ * Function name: profiled
+ * Description  : Find out whether a program is profiled.
+ * Arguments    : string program - the program, as calling_program().
+ * Returns      : int 1/0 - profiled or not.
+ */
+static int
+profiled(string program)
+{
+    string path;
+    int    match = -1;
+
+    if (matches[program])
+    {
+        return (matches[program] > 0);
+    }
+
+    path = "/" + program[..-3];
+    foreach(string target: targets)
+    {
+        if ((path == target) ||
+            ((target[-1..] == "/") &&
+             (path[..(strlen(target) - 1)] == target)))
+        {
+            match = 1;
+            break;
+        }
+    }
+
+    matches[program] = match;
+    return (match > 0);
+}
+
+/*
+ * Function name: profile_enter
+ * Description  : Called through PROFILE_ENTER() at the start of a section.
+ * Arguments    : string name - the name of the section.
+ */
+public void
+profile_enter(string name)
+{
+    string program;
+    int    eval;
+
+    if (!running ||
+        !profiled(program = calling_program()))
+    {
+        return;
+    }
+
+    /* Forget the sections that were never left due to an error. The
+     * evaluation cost counter starts over with every execution, so a
+     * section entered at a higher count belongs to an earlier one.
+     */
+    eval = SECURITY->do_debug("get_eval_cost");
+    while (sizeof(stack) &&
+        ((stack[-1][FRAME_EVAL] > eval) ||
+         (sizeof(stack) >= MAX_DEPTH)))
+    {
+        stack = stack[..-2];
+    }
+
+    stack += ({ ({ program[..-3], name, eval, 0 }) });
+}
+
+/*
+ * Function name: profile_leave
+ * Description  : Called through PROFILE_LEAVE() at the end of a section.
+ * Arguments    : string name - the name of the section.
+ */
+public void
+profile_leave(string name)
+{
+    string program, key;
+    mixed  frame, counters;
+    int    index, cost;
+
+    if (!running ||
+        !profiled(program = calling_program()))
+    {
+        return;
+    }
+
+    program = program[..-3];
+
+    /* Find the section. Sections that were not left are dropped. */
+    index = sizeof(stack);
+    while (--index >= 0)
+    {
+        if ((stack[index][FRAME_NAME] == name) &&
+            (stack[index][FRAME_PROGRAM] == program))
+        {
+            break;
+        }
+    }
+    if (index < 0)
+    {
+        return;
+    }
+
+    frame = stack[index];
+    cost = abs(SECURITY->do_debug("get_eval_cost") - frame[FRAME_EVAL]);
+
+    key = "/" + program;
+    if (!mappingp(sections[key]))
+    {
+        sections[key] = ([ ]);
+    }
+    counters = sections[key][name];
+    if (!pointerp(counters))
+    {
+        counters = ({ 0, 0 });
+        sections[key][name] = counters;
+    }
+    counters[SECT_CALLS]++;
+    counters[SECT_COST] += cost;
+
+    /* The stack of the section, with the exclusive cost. */
+    key = "/" + frame[FRAME_PROGRAM];
+    foreach(mixed open: stack[..index])
+    {
+        key += ";" + open[FRAME_NAME];
+    }
+    folded[key] += max(0, cost - frame[FRAME_CHILD_COST]);
+
+    stack = stack[..(index - 1)];
+    if (index > 0)
+    {
+        stack[index - 1][FRAME_CHILD_COST] += cost;
+    }
+}
+
+/*
+ * Function name: profile_hit
+ * Description  : Called through PROFILE() to count a pass through a point.
+ * Arguments    : string name - the name of the point.
+ */
+public void
+profile_hit(string name)
+{
+    string program;
+
+    if (!running ||
+        !profiled(program = calling_program()))
+    {
+        return;
+    }
+
+    program = "/" + program[..-3];
+    if (!mappingp(sections[program]))
+    {
+        sections[program] = ([ ]);
+    }
+    if (!pointerp(sections[program][name]))
+    {
+        sections[program][name] = ({ 0, 0 });
+    }
+    sections[program][name][SECT_CALLS]++;
+}
+
+/*
+ * Function name: query_rows
+ * Description  : Collects the results of the profile, so far if it is
+ *                still running.
+ * Returns      : mixed * - the rows, see PROFILE_* in <profile.h>.
+ */
+static mixed *
+query_rows()
+{
+    mapping funcs = (running ? difference(snapshot()) : result);
+    mixed   *rows = ({ });
+
+    if (!mappingp(funcs))
+    {
+        funcs = ([ ]);
+    }
+
+    foreach(string program, mapping counters: funcs)
+    {
+        foreach(string func, int *values: counters)
+        {
+            rows += ({ ({ program, func, values[0], values[1],
+                "function" }) });
+        }
+    }
+
+    foreach(string program, mapping counters: sections)
+    {
+        foreach(string name, mixed values: counters)
+        {
+            rows += ({ ({ program, name, values[SECT_CALLS],
+                values[SECT_COST], "section" }) });
+        }
+    }
+
+    return rows;
+}
+
+/*
+ * Function name: sort_rows
+ * Description  : Sorts the rows of the report, the highest value first.
+ * Arguments    : string order - the order, see PROFILE_SORT_*.
+ *                mixed a, b - the rows to compare.
+ * Returns      : int - -1, 0 or 1.
+ */
+static int
+sort_rows(string order, mixed a, mixed b)
+{
+    float value_a, value_b;
+
+    switch(order)
+    {
+    case PROFILE_SORT_CALLS:
+        value_a = itof(a[PROFILE_CALLS]);
+        value_b = itof(b[PROFILE_CALLS]);
+        break;
+
+    case PROFILE_SORT_AVERAGE:
+        value_a = itof(a[PROFILE_COST]) / itof(max(1, a[PROFILE_CALLS]));
+        value_b = itof(b[PROFILE_COST]) / itof(max(1, b[PROFILE_CALLS]));
+        break;
+
+    default:
+        value_a = itof(a[PROFILE_COST]);
+        value_b = itof(b[PROFILE_COST]);
+    }
+
+    return ((value_a < value_b) ? 1 : ((value_a > value_b) ? -1 : 0));
+}
+
+/*
+ * Function name: query_report
+ * Description  : Returns the results of the profile, ranked.
+ * Arguments    : string order - the order, see PROFILE_SORT_*.
+ *                int num - the number of rows, 0 for all.
+ * Returns      : mixed * - the rows, see PROFILE_* in <profile.h>.
+ */
+public mixed *
+query_report(string order, int num)
+{
+    mixed *rows = sort_array(query_rows(), &sort_rows(order));
+
+    return ((num > 0) ? rows[..(num - 1)] : rows);
+}
+
+/*
+ * Function name: report_csv
+ * Description  : Exports the results of the profile as CSV.
+ * Returns      : string - the text, with a header line.
+ */
+public string
+report_csv()
+{
+    string text = "program,function,source,calls,cost\n";
+
+    foreach(mixed row: query_report(PROFILE_SORT_COST, 0))
+    {
+        text += sprintf("%s,%s,%s,%d,%d\n", row[PROFILE_PROGRAM],
+            row[PROFILE_FUNCTION], row[PROFILE_SOURCE], row[PROFILE_CALLS],
+            row[PROFILE_COST]);
+    }
+
+    return text;
+}
+
+/*
+ * Function name: report_folded
+ * Description  : Exports the results of the profile in the folded stack
+ *                format, one stack per line with its weight. The functions
+ *                are shown below "functions" and weigh their evaluation
+ *                cost. The sections are shown below "sections" with their
+ *                nesting, and weigh their exclusive cost.
+ * Returns      : string - the text.
+ */
+public string
+report_folded()
+{
+    string text = "";
+
+    foreach(mixed row: query_rows())
+    {
+        if ((row[PROFILE_SOURCE] == "function") && (row[PROFILE_COST] > 0))
+        {
+            text += sprintf("functions;%s;%s %d\n", row[PROFILE_PROGRAM],
+                row[PROFILE_FUNCTION], row[PROFILE_COST]);
+        }
+    }
+
+    foreach(string key, int cost: folded)
+    {
+        text += sprintf("sections;%s %d\n", key, cost);
+    }
+
+    return text;
+}
+
+/*
+ * Function name: query_status
+ * Description  : Describes the profile that runs or ran last.
+ * Returns      : string - the description.
+ */
+public string
+query_status()
+{
+    if (!started)
+    {
+        return "No profile has been made.\n";
+    }
+
+    return sprintf("Profile of %s by %s\n", implode(targets, ", "),
+            capitalize(owner)) +
+        sprintf("Started %s, %s.\n", ctime(started), (running ?
+            sprintf("%d of %d seconds done", time() - started, duration) :
+            sprintf("ran %d seconds", stopped - started))) +
+        sprintf("Programs measured: %d    Sections: %d\n", sizeof(programs),
+            m_sizeof(folded));
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the state of the profiler when a wizard stats it.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    return query_status();
+}
@@ -0,0 +1,171 @@
+/*
+ * /sys/global/prop_hooks.c
+ *
+ * This object hands out the tables /std/object.c uses to find out whether
+ * a program defines the add_prop<prop> and remove_prop<prop> hooks. Without
+ * the table, every add_prop() and remove_prop() would have to call the hook
+ * in order to find out that it does not exist.
+ *
+ * A table is shared between all objects with the same program and the same
+ * shadows. The objects fill the table themselves, as the hooks are found
+ * with function_exists() in the object and its shadows. The table maps the
+ * name of the hook to PROP_HOOK_DEFINED or PROP_HOOK_ABSENT, and also holds
+ * the counters of the hook calls that were made and skipped.
+ *
+ * When a program is updated, objects of the new program get a new table,
+ * since the new program may define other hooks.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <files.h>
+#include <macros.h>
+
+/* Indices into the entries of the tables. */
+#define ENTRY_TABLE   (0)
+#define ENTRY_MASTERS (1)
+
+/*
+ * Global variables.
+ *
+ * tables - ([ signature : ({ table, *master objects }) ]) where the
+ *          signature is the program of the object followed by the programs
+ *          of its shadows.
+ */
+private static mapping tables = ([ ]);
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+}
+
+/*
+ * Function name: query_hook_table
+ * Description  : Called from /std/object.c to get the hook table of an
+ *                object. The same table is returned to all objects with the
+ *                same program and shadows, so it must not be copied.
+ * Arguments    : object *obs - the object and its shadows.
+ * Returns      : mapping - the hook table.
+ */
+public mapping
+query_hook_table(object *obs)
+{
+    string *programs = ({ });
+    object *masters = ({ });
+    string signature;
+    mixed  entry;
+
+    if (calling_program() != "std/object.c")
+    {
+        return ([ ]);
+    }
+
+    foreach(object ob: obs)
+    {
+        programs += ({ MASTER_OB(ob) });
+        masters += ({ find_object(MASTER_OB(ob)) });
+    }
+    signature = implode(programs, ",");
+
+    /* Make a new table when one of the programs was updated. */
+    entry = tables[signature];
+    if (!pointerp(entry) ||
+        sizeof(entry[ENTRY_MASTERS] - masters))
+    {
+        entry = ({ ([ PROP_HOOK_CALLS : 0, PROP_HOOK_SKIPS : 0 ]), masters });
+        tables[signature] = entry;
+    }
+
+    return entry[ENTRY_TABLE];
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the calls made and skipped for every signature.
+ * Returns      : mapping - ([ signature : ({ calls, skips }) ])
+ */
+public mapping
+query_stats()
+{
+    mapping result = ([ ]);
+
+    foreach(string signature, mixed entry: tables)
+    {
+        result[signature] = ({ entry[ENTRY_TABLE][PROP_HOOK_CALLS],
+            entry[ENTRY_TABLE][PROP_HOOK_SKIPS] });
+    }
+
+    return result;
+}
+
+/*
+ * Function name: sort_calls
+ * Description  : Sorts the signatures with the most hook calls first.
+ * Arguments    : mapping stats - the statistics, see query_stats().
+ *                string a, b - the signatures to compare.
+ * Returns      : int - -1, 0 or 1.
+ */
+static int
+sort_calls(mapping stats, string a, string b)
+{
+    int diff = stats[b][0] - stats[a][0];
+
+    return ((diff > 0) ? 1 : ((diff < 0) ? -1 : 0));
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the number of hook calls made and skipped when a
+ *                wizard stats the object, with the programs that called
+ *                their hooks most often.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    mapping stats = query_stats();
+    string *signatures;
+    int calls, skips;
+    string str;
+
+    foreach(string signature, int *counts: stats)
+    {
+        calls += counts[0];
+        skips += counts[1];
+    }
+
+    str = sprintf("Tables : %8d\n", m_sizeof(tables)) +
+        sprintf("Calls  : %8d    Skipped : %d\n", calls, skips);
+
+    signatures = ({ });
+    foreach(string signature, int *counts: stats)
+    {
+        if (counts[0])
+        {
+            signatures += ({ signature });
+        }
+    }
+    if (!sizeof(signatures))
+    {
+        return str;
+    }
+
+    str += sprintf("\n%8s %8s  %s\n", "Calls", "Skipped", "Program");
+    signatures = sort_array(signatures, &sort_calls(stats));
+    foreach(string signature: signatures[..19])
+    {
+        str += sprintf("%8d %8d  %s\n", stats[signature][0],
+            stats[signature][1], signature);
+    }
+
+    return str;
+}
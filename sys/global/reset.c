@@ -0,0 +1,491 @@
+/*
+ * /sys/global/reset.c
+ *
+ * This daemon keeps the resets of all objects that have reset enabled.
+ * Rather than every room and item holding its own reset alarm, the objects
+ * register the time of their next reset here, and the daemon executes the
+ * resets that are due from a single alarm.
+ *
+ * The resets are kept in a queue of buckets, one for every RESET_TICK
+ * seconds. Every tick all buckets that became due are processed, up to a
+ * budget that grows with the size of the queue, so that even a queue that
+ * is due all at once is done within RESET_SPREAD ticks. The budget is never
+ * lower than MIN_RESETS_PER_TICK. Resets that do not fit remain in the
+ * queue and are shown as the backlog.
+ *
+ * A room that no interactive player visited since its previous reset is
+ * not reset when its time comes. It only remembers that the reset is
+ * pending, and performs it when the next player enters. See reset_due()
+ * and init() in /std/object.c.
+ *
+ * The queue only lives in memory. When the daemon is updated or destructed,
+ * remove_object() hands the queue over in chunks of HANDOVER_CHUNK. The
+ * first object of every chunk registers the whole chunk again with the new
+ * daemon right after, see reset_handover() in /std/object.c.
+ *
+ * The objects (/std/object.c) use the following calls:
+ *
+ *    schedule_reset(float delay) - reset the caller after the delay.
+ *    unschedule_reset()          - forget about the caller.
+ *    pending_reset()             - the caller deferred its reset.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <macros.h>
+
+/* The granularity of the queue in seconds. */
+#define RESET_TICK          (15)
+
+/* The lowest number of resets we may run in a single tick. */
+#define MIN_RESETS_PER_TICK (100)
+
+/* The number of ticks in which the budget allows the whole queue to reset. */
+#define RESET_SPREAD        (20)
+
+/* The number of objects handed over to the next daemon in one call. */
+#define HANDOVER_CHUNK      (100)
+
+/*
+ * Global variables.
+ *
+ * buckets - ([ bucket : ([ object : 1 ]) ]) the objects to reset.
+ * due     - ([ object : bucket ]) the bucket an object is in.
+ * pending - ([ object : time ]) the rooms waiting for a visitor.
+ */
+private static mapping buckets = ([ ]);
+private static mapping due = ([ ]);
+private static mapping pending = ([ ]);
+private static int     last_bucket;
+private static int     tick_alarm;
+
+/*
+ * Statistics.
+ */
+private static int     stat_start;
+private static int     stat_resets;
+private static int     stat_deferred;
+private static int     stat_lazy;
+private static int     stat_errors;
+private static int     stat_max_backlog;
+
+/*
+ * Prototypes.
+ */
+static void run_ticks();
+public object *query_backlog();
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    last_bucket = (time() / RESET_TICK) - 1;
+    stat_start = time();
+}
+
+/*
+ * Function name: remove_object
+ * Description  : Before we are destructed, the objects in the queue and the
+ *                rooms waiting for a visitor are told when their reset is
+ *                due, so they can register with the next daemon.
+ */
+public void
+remove_object()
+{
+    int now = time();
+    int size = m_sizeof(due) + m_sizeof(pending);
+    object *obs = allocate(size);
+    float *delays = allocate(size);
+    int index;
+
+    if (tick_alarm)
+    {
+        remove_alarm(tick_alarm);
+        tick_alarm = 0;
+    }
+
+    foreach(object ob, int bucket: due)
+    {
+        obs[index] = ob;
+        /* Overdue resets are due at once. */
+        delays[index] = itof(MAX((bucket * RESET_TICK) - now, 0));
+        index++;
+    }
+
+    foreach(object ob, int since: pending)
+    {
+        obs[index] = ob;
+        delays[index] = -1.0;
+        index++;
+    }
+
+    for (index = 0; index < size; index += HANDOVER_CHUNK)
+    {
+        if (objectp(obs[index]) &&
+            catch(obs[index]->reset_handover(
+                obs[index..(index + HANDOVER_CHUNK - 1)],
+                delays[index..(index + HANDOVER_CHUNK - 1)])))
+        {
+            stat_errors++;
+        }
+    }
+
+    destruct();
+}
+
+/*
+ * Function name: delete_entry
+ * Description  : Removes an object from the queue.
+ * Arguments    : object ob - the object.
+ */
+static void
+delete_entry(object ob)
+{
+    int bucket = due[ob];
+
+    if (!bucket)
+    {
+        return;
+    }
+
+    if (mappingp(buckets[bucket]))
+    {
+        m_delkey(buckets[bucket], ob);
+        if (!m_sizeof(buckets[bucket]))
+        {
+            m_delkey(buckets, bucket);
+        }
+    }
+    m_delkey(due, ob);
+}
+
+/*
+ * Function name: insert_entry
+ * Description  : Puts an object in the bucket its reset is due, and makes
+ *                sure the alarm runs. A reset that was already scheduled is
+ *                replaced.
+ * Arguments    : object ob - the object.
+ *                float delay - the time until the reset.
+ */
+static void
+insert_entry(object ob, float delay)
+{
+    int bucket;
+
+    delete_entry(ob);
+    m_delkey(pending, ob);
+
+    /* The queue was idle, start counting from now. */
+    if (!tick_alarm)
+    {
+        last_bucket = (time() / RESET_TICK) - 1;
+    }
+
+    bucket = (time() + ftoi(delay)) / RESET_TICK;
+    if (bucket <= last_bucket)
+    {
+        bucket = last_bucket + 1;
+    }
+
+    due[ob] = bucket;
+    if (mappingp(buckets[bucket]))
+    {
+        buckets[bucket][ob] = 1;
+    }
+    else
+    {
+        buckets[bucket] = ([ ob : 1 ]);
+    }
+
+    if (!tick_alarm)
+    {
+        tick_alarm = set_alarm(itof(RESET_TICK), itof(RESET_TICK), run_ticks);
+    }
+}
+
+/*
+ * Function name: schedule_reset
+ * Description  : Called from an object to be reset after a delay. A reset
+ *                that was already scheduled is replaced.
+ * Arguments    : float delay - the time until the reset, see random_reset()
+ *                    in /std/object.c.
+ */
+public void
+schedule_reset(float delay)
+{
+    insert_entry(previous_object(), delay);
+}
+
+/*
+ * Function name: rejoin_resets
+ * Description  : Called from an object with a chunk of objects that were in
+ *                the queue of the previous daemon when it was destructed.
+ * Arguments    : object *obs - the objects.
+ *                float *delays - the time until their reset, or < 0.0 if
+ *                    the reset waits for a visitor.
+ */
+public void
+rejoin_resets(object *obs, float *delays)
+{
+    int size = sizeof(obs);
+
+    if (sizeof(delays) != size)
+    {
+        return;
+    }
+
+    for (int index = 0; index < size; index++)
+    {
+        /* Resets may have been disabled in the meantime. */
+        if (!objectp(obs[index]) ||
+            !obs[index]->query_reset_active())
+        {
+            continue;
+        }
+
+        if (delays[index] < 0.0)
+        {
+            delete_entry(obs[index]);
+            pending[obs[index]] = time();
+        }
+        else
+        {
+            insert_entry(obs[index], delays[index]);
+        }
+    }
+}
+
+/*
+ * Function name: unschedule_reset
+ * Description  : Called from an object that no longer wants to be reset.
+ */
+public void
+unschedule_reset()
+{
+    object ob = previous_object();
+
+    delete_entry(ob);
+    m_delkey(pending, ob);
+}
+
+/*
+ * Function name: pending_reset
+ * Description  : Called from a room that deferred its reset until the next
+ *                visitor arrives.
+ */
+public void
+pending_reset()
+{
+    pending[previous_object()] = time();
+    stat_lazy++;
+}
+
+/*
+ * Function name: run_bucket
+ * Description  : Executes the resets in a bucket.
+ * Arguments    : int bucket - the bucket.
+ *                int budget - the number of resets we may still run.
+ * Returns      : int - the number of resets executed, or -1 if we ran out
+ *                      of budget before the bucket was done.
+ */
+static int
+run_bucket(int bucket, int budget)
+{
+    mapping obs = buckets[bucket];
+    int resets;
+
+    if (!mappingp(obs))
+    {
+        return 0;
+    }
+
+    foreach(object ob: m_indexes(obs))
+    {
+        if (resets >= budget)
+        {
+            return -1;
+        }
+
+        m_delkey(obs, ob);
+        m_delkey(due, ob);
+        if (!objectp(ob))
+        {
+            continue;
+        }
+
+        /* The object schedules its next reset itself. */
+        if (catch(ob->reset_due()))
+        {
+            stat_errors++;
+        }
+        resets++;
+    }
+
+    m_delkey(buckets, bucket);
+    return resets;
+}
+
+/*
+ * Function name: run_ticks
+ * Description  : Called every tick from the alarm. It executes the resets
+ *                of all buckets that became due since the previous call.
+ */
+static void
+run_ticks()
+{
+    int now = time() / RESET_TICK;
+    int budget = MAX(m_sizeof(due) / RESET_SPREAD, MIN_RESETS_PER_TICK);
+    int resets, done, backlog;
+
+    while (last_bucket < now)
+    {
+        done = run_bucket(last_bucket + 1, budget - resets);
+        if (done < 0)
+        {
+            resets = budget;
+            stat_deferred++;
+            break;
+        }
+
+        resets += done;
+        last_bucket++;
+    }
+
+    stat_resets += resets;
+
+    /* Forget the objects that were destructed. */
+    m_delkey(due, 0);
+    m_delkey(pending, 0);
+
+    if (last_bucket < now)
+    {
+        backlog = sizeof(query_backlog());
+        if (backlog > stat_max_backlog)
+        {
+            stat_max_backlog = backlog;
+        }
+    }
+
+    if (!m_sizeof(buckets))
+    {
+        remove_alarm(tick_alarm);
+        tick_alarm = 0;
+    }
+}
+
+/*
+ * Function name: query_backlog
+ * Description  : Find the objects whose reset is overdue.
+ * Returns      : object * - the objects.
+ */
+public object *
+query_backlog()
+{
+    int now = time() / RESET_TICK;
+    object *obs = ({ });
+
+    foreach(int bucket, mapping entries: buckets)
+    {
+        if (bucket <= now)
+        {
+            obs += m_indexes(entries);
+        }
+    }
+
+    return obs - ({ 0 });
+}
+
+/*
+ * Function name: query_pending
+ * Description  : Find the rooms that wait for a visitor to reset.
+ * Returns      : object * - the rooms.
+ */
+public object *
+query_pending()
+{
+    return m_indexes(pending) - ({ 0 });
+}
+
+/*
+ * Function name: query_next_reset
+ * Description  : Find out how long it takes before an object resets.
+ * Arguments    : object ob - the object.
+ * Returns      : int - the time in seconds, or -1 if it is not scheduled.
+ */
+public int
+query_next_reset(object ob)
+{
+    if (!due[ob])
+    {
+        return -1;
+    }
+
+    return (due[ob] * RESET_TICK) - time();
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the statistics of the daemon.
+ * Returns      : mapping - the statistics, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    return ([
+        "scheduled"   : m_sizeof(due),
+        "buckets"     : m_sizeof(buckets),
+        "backlog"     : sizeof(query_backlog()),
+        "backlog_max" : stat_max_backlog,
+        "pending"     : m_sizeof(pending),
+        "resets"      : stat_resets,
+        "lazy"        : stat_lazy,
+        "deferred"    : stat_deferred,
+        "errors"      : stat_errors,
+        "since"       : stat_start,
+        ]);
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the reset queue and its backlog when a wizard stats
+ *                the daemon. The oldest overdue objects are listed.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    mapping stats = query_stats();
+    object *backlog = query_backlog();
+    string str;
+
+    str = sprintf("Reset daemon since %s\n", ctime(stats["since"])) +
+        sprintf("Scheduled : %6d    Buckets  : %d    Alarm : %s\n",
+            stats["scheduled"], stats["buckets"],
+            (tick_alarm ? "running" : "idle")) +
+        sprintf("Resets    : %6d    Lazy     : %d    Waiting for visitor : %d\n",
+            stats["resets"], stats["lazy"], stats["pending"]) +
+        sprintf("Backlog   : %6d    Max      : %d    Ticks over budget : %d\n",
+            stats["backlog"], stats["backlog_max"], stats["deferred"]) +
+        sprintf("Errors    : %6d\n", stats["errors"]);
+
+    if (sizeof(backlog))
+    {
+        str += "\nOverdue:\n";
+        foreach(object ob: backlog[..9])
+        {
+            str += sprintf("%6d sec  %s\n", -query_next_reset(ob),
+                file_name(ob));
+        }
+    }
+
+    return str;
+}
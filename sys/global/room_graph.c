@@ -0,0 +1,343 @@
+/*
+ * /sys/global/room_graph.c
+ *
+ * This object keeps the graph of the rooms in the game, that is, which
+ * rooms are connected through exits and doors. The edges of a room are
+ * collected once from query_exit() and ROOM_AO_DOOROB, and are kept until
+ * the room changes them. Rooms tell us about changes from add_exit() and
+ * remove_exit() in /std/room/exits.c, and doors do so when they are added
+ * to or removed from a room.
+ *
+ * The graph answers the questions which rooms are near a room, e.g. for
+ * shouting (FIND_NEIGHBOURS in <cmdparse.h>), how far two rooms are apart,
+ * e.g. for the range of projectiles, and which way to walk from one room
+ * to another, e.g. for NPCs.
+ *
+ * Only loaded rooms are part of the results, as before. Exits that are
+ * functions are ignored.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <macros.h>
+#include <stdproperties.h>
+
+/* Indices into the edges of a room. */
+#define EDGE_PLACES  (0)
+#define EDGE_CMDS    (1)
+#define EDGE_DOORS   (2)
+
+/*
+ * Global variables.
+ *
+ * edges - ([ room : ({ *places, *commands, *door rooms }) ]) where places
+ *         are the destinations of the exits (filenames or objects), with
+ *         the command of each exit, and door rooms are the filenames of the
+ *         rooms on the other side of the doors.
+ */
+private static mapping edges = ([ ]);
+
+/*
+ * Statistics.
+ */
+private static int     stat_queries;
+private static int     stat_builds;
+private static int     stat_invalidations;
+private static int     stat_visited;
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+}
+
+/*
+ * Function name: query_edges
+ * Description  : Finds the edges of a room, collecting them if we do not
+ *                know them yet.
+ * Arguments    : object room - the room.
+ * Returns      : mixed - the edges, see the description of edges above.
+ */
+static mixed
+query_edges(object room)
+{
+    mixed exits, doors;
+    mixed *places = ({ });
+    string *cmds = ({ });
+    string *others = ({ });
+    int index, size;
+
+    if (pointerp(edges[room]))
+    {
+        return edges[room];
+    }
+
+    exits = room->query_exit();
+    size = sizeof(exits);
+    for (index = 0; index < size; index += 3)
+    {
+        if (functionp(exits[index]))
+        {
+            continue;
+        }
+        places += ({ exits[index] });
+        cmds += ({ exits[index + 1] });
+    }
+
+    doors = room->query_prop(ROOM_AO_DOOROB);
+    size = sizeof(doors);
+    for (index = 0; index < size; index++)
+    {
+        if (objectp(doors[index]))
+        {
+            others += ({ doors[index]->query_other_room() });
+        }
+    }
+
+    /* Forget the rooms that were destructed. */
+    m_delkey(edges, 0);
+
+    stat_builds++;
+    edges[room] = ({ places, cmds, others });
+    return edges[room];
+}
+
+/*
+ * Function name: invalidate_room
+ * Description  : Called when the exits or doors of a room change. The edges
+ *                are collected again the next time they are needed.
+ * Arguments    : object room - the room, defaults to the caller.
+ */
+public varargs void
+invalidate_room(object room)
+{
+    if (!objectp(room))
+    {
+        room = previous_object();
+    }
+
+    if (pointerp(edges[room]))
+    {
+        stat_invalidations++;
+        m_delkey(edges, room);
+    }
+}
+
+/*
+ * Function name: resolve
+ * Description  : Finds the room an exit leads to, if it is loaded.
+ * Arguments    : mixed place - the filename or the room.
+ * Returns      : object - the room, or 0.
+ */
+static object
+resolve(mixed place)
+{
+    return (objectp(place) ? place : find_object(place));
+}
+
+/*
+ * Function name: query_neighbours
+ * Description  : Finds the rooms within a number of steps from the seed
+ *                rooms. Rooms behind a door are found, but not searched
+ *                further. The seed rooms are only part of the result if
+ *                they are found as neighbour of another room.
+ * Arguments    : object *seeds - the rooms to start from.
+ *                int depth - the number of steps.
+ * Returns      : object * - the rooms found.
+ */
+public object *
+query_neighbours(object *seeds, int depth)
+{
+    mapping seen = ([ ]);
+    object *rooms = ({ });
+    object *search = seeds;
+    object *next;
+    object troom;
+    mixed  room_edges;
+
+    stat_queries++;
+    while ((depth-- > 0) &&
+        sizeof(search))
+    {
+        next = ({ });
+        foreach(object room: search)
+        {
+            if (!objectp(room))
+            {
+                continue;
+            }
+
+            stat_visited++;
+            room_edges = query_edges(room);
+            foreach(mixed place: room_edges[EDGE_PLACES])
+            {
+                troom = resolve(place);
+                if (objectp(troom) && !seen[troom])
+                {
+                    seen[troom] = 1;
+                    rooms += ({ troom });
+                    next += ({ troom });
+                }
+            }
+
+            foreach(string other: room_edges[EDGE_DOORS])
+            {
+                troom = find_object(other);
+                if (objectp(troom) && !seen[troom])
+                {
+                    seen[troom] = 1;
+                    rooms += ({ troom });
+                }
+            }
+        }
+        search = next;
+    }
+
+    return rooms;
+}
+
+/*
+ * Function name: search_path
+ * Description  : Searches breadth first from one room to another through the
+ *                exits of the loaded rooms.
+ * Arguments    : object from - the room to start in.
+ *                object to - the room to find.
+ *                int max_depth - the maximum number of steps.
+ * Returns      : mapping - ([ room : ({ previous room, command }) ]) for all
+ *                    rooms visited, or 0 if the room was not found.
+ */
+static mapping
+search_path(object from, object to, int max_depth)
+{
+    mapping previous = ([ from : 0 ]);
+    object *search = ({ from });
+    object *next;
+    object troom;
+    mixed  room_edges;
+    int    index, size;
+
+    stat_queries++;
+    if (from == to)
+    {
+        return previous;
+    }
+
+    while ((max_depth-- > 0) &&
+        sizeof(search))
+    {
+        next = ({ });
+        foreach(object room: search)
+        {
+            stat_visited++;
+            room_edges = query_edges(room);
+            size = sizeof(room_edges[EDGE_PLACES]);
+            for (index = 0; index < size; index++)
+            {
+                troom = resolve(room_edges[EDGE_PLACES][index]);
+                if (!objectp(troom) ||
+                    pointerp(previous[troom]) || (troom == from))
+                {
+                    continue;
+                }
+
+                previous[troom] = ({ room, room_edges[EDGE_CMDS][index] });
+                if (troom == to)
+                {
+                    return previous;
+                }
+                next += ({ troom });
+            }
+        }
+        search = next;
+    }
+
+    return 0;
+}
+
+/*
+ * Function name: query_path
+ * Description  : Finds the exit commands to walk from one room to another.
+ *                Only loaded rooms are searched.
+ * Arguments    : object from - the room to start in.
+ *                object to - the room to reach.
+ *                int max_depth - the maximum number of steps.
+ * Returns      : string * - the commands, or 0 if there is no path.
+ */
+public string *
+query_path(object from, object to, int max_depth)
+{
+    mapping previous;
+    string *path = ({ });
+
+    if (!objectp(from) || !objectp(to) ||
+        !mappingp(previous = search_path(from, to, max_depth)))
+    {
+        return 0;
+    }
+
+    while (to != from)
+    {
+        path = ({ previous[to][1] }) + path;
+        to = previous[to][0];
+    }
+
+    return path;
+}
+
+/*
+ * Function name: query_distance
+ * Description  : Finds the number of steps between two rooms.
+ * Arguments    : object from - the room to start in.
+ *                object to - the room to reach.
+ *                int max_depth - the maximum number of steps.
+ * Returns      : int - the number of steps, or -1 if the room is not within
+ *                    reach.
+ */
+public int
+query_distance(object from, object to, int max_depth)
+{
+    string *path = query_path(from, to, max_depth);
+
+    return (pointerp(path) ? sizeof(path) : -1);
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the statistics of the graph.
+ * Returns      : mapping - the statistics, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    return ([
+        "rooms"         : m_sizeof(edges),
+        "queries"       : stat_queries,
+        "builds"        : stat_builds,
+        "invalidations" : stat_invalidations,
+        "visited"       : stat_visited,
+        ]);
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the size and use of the graph when a wizard stats it.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    return sprintf("Rooms   : %8d    Builds        : %d\n", m_sizeof(edges),
+            stat_builds) +
+        sprintf("Queries : %8d    Invalidations : %d\n", stat_queries,
+            stat_invalidations) +
+        sprintf("Visited : %8d    (%.2f rooms per query)\n", stat_visited,
+            (stat_queries ? (itof(stat_visited) / itof(stat_queries)) : 0.0));
+}
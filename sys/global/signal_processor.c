@@ -2,9 +2,12 @@
    
 Functions
 ---------
-int start_listen(string channel, string func)
+int start_listen(string channel, string func, int batched)
     Start listening to "channel", messages will be sent to "func" in
     calling object. Returns 1 if successful, 0 if failed
+    If "batched" is true, "func" is called once with an array of all
+    messages that were queued for the channel, rather than once for
+    every message.
 
 int send_signal(string channel, mixed message)
     send "message" to "channel". Returns 1 if successful, 0 if failed
@@ -34,6 +37,22 @@ object *query_listeners(string channel)
 
 string *query_channels(object ob)
      Returns the channels that that object is listenning to.
+
+mapping query_channel_stats(string channel)
+     Returns the counters of a channel: the number of messages sent, the
+     number of deliveries and calls made, the messages still queued and
+     the largest queue seen, failed calls and listeners that were dropped
+     because they were destructed or kept failing.
+
+Delivery
+--------
+With USE_CALL_OUT, messages are not delivered when they are sent, but put
+in the outbound queue of their channel. A single alarm delivers all queued
+messages. Every call to a listener is made within catch(), so a listener
+that fails cannot stop the others from getting the message. A listener that
+fails MAX_FAILURES times in a row is removed from the channel. No more than
+MAX_CALLS calls are made in one alarm, counting every single message; the
+rest is delivered in the next.
      
 Data Structures
 ---------------
@@ -52,6 +71,18 @@ listeners[ob] = channels_list
 
 secured[channel] = ({object, func})
   see secure_channel above.
+
+batched[channel][ob] = 1
+  ob gets the messages of channel in an array.
+
+queues[channel] = ({ messages })
+  the messages sent to channel that are not delivered yet.
+
+deliveries = ({ ({ channel, ({ messages }), ({ listeners }) }) })
+  messages that are being delivered, and the listeners still to call.
+
+stats[channel] = ({ sent, delivered, calls, max queue, failures, dropped,
+                    since })
 */
 #define USE_CALL_OUT     
 #pragma save_binary
@@ -59,9 +90,29 @@ secured[channel] = ({object, func})
 #pragma no_clone
 #pragma no_inherit
 
+#define DELIVERY_DELAY  0.3  /* Delay before queued messages are delivered */
+#define MAX_CALLS       250  /* Maximum number of calls in one alarm       */
+#define MAX_FAILURES      3  /* Failures before a listener is removed      */
+
+#define STAT_SENT       0
+#define STAT_DELIVERED  1
+#define STAT_CALLS      2
+#define STAT_MAX_QUEUE  3
+#define STAT_FAILURES   4
+#define STAT_DROPPED    5
+#define STAT_SINCE      6
+
 mapping channels = ([]);
 mapping listeners = ([]);
 mapping secured = ([]);
+mapping batched = ([]);
+
+static mapping queues = ([]);
+static mixed   deliveries = ({});
+static mapping failures = ([]);
+static mapping stats = ([]);
+static int     delivery_alarm;
+static int     delivery_calls;
 
 static void restore_channels();
 
@@ -91,6 +142,8 @@ _stop_listen(string channel, object ob)
     
     if(channels[channel])
 	m_delkey(channels[channel], ob);
+    if(batched[channel])
+	m_delkey(batched[channel], ob);
     if (listeners[ob])
 	listeners[ob] -= ({channel});
 }
@@ -101,8 +154,8 @@ stop_listen(string channel)
     _stop_listen(channel, previous_object());
 }
 
-int
-start_listen(string channel, string func)
+varargs int
+start_listen(string channel, string func, int batch)
 {
     object ob = previous_object();
     
@@ -125,6 +178,13 @@ start_listen(string channel, string func)
 
     channels[channel] += ([ob:func]);
 
+    if (batch)
+    {
+	if (!batched[channel])
+	    batched[channel] = ([]);
+	batched[channel][ob] = 1;
+    }
+
     if (listeners[ob])
 	listeners[ob] += ({channel});
     else
@@ -142,8 +202,12 @@ _stop_listen_all(object ob)
     {
 	n = sizeof(listeners[ob]);
 	for(i = 0; i < n; ++i)
+	{
 	    if(channels[listeners[ob][i]])
 		m_delkey(channels[listeners[ob][i]], ob);
+	    if(batched[listeners[ob][i]])
+		m_delkey(batched[listeners[ob][i]], ob);
+	}
 	m_delkey(listeners, ob);
     }
     n = sizeof(chans = m_indexes(secured));
@@ -158,6 +222,177 @@ stop_listen_all()
     _stop_listen_all(previous_object());
 }
 
+/*
+ * Returns the counters of a channel, creating them if needed.
+ */
+static int *
+channel_stats(string channel)
+{
+    if (!stats[channel])
+	stats[channel] = ({ 0, 0, 0, 0, 0, 0, time() });
+    return stats[channel];
+}
+
+/*
+ * Removes the listeners of a channel that have been destructed.
+ */
+static void
+drop_dead(string channel)
+{
+    if (!channels[channel] ||
+	(member_array(0, m_indexes(channels[channel])) == -1))
+	return;
+
+    m_delkey(channels[channel], 0);
+    if (batched[channel])
+	m_delkey(batched[channel], 0);
+    m_delkey(listeners, 0);
+    channel_stats(channel)[STAT_DROPPED]++;
+}
+
+/*
+ * Calls a listener with the messages of a channel, as long as the budget of
+ * calls of this alarm lasts. Returns the number of messages that were
+ * dealt with; the rest must be delivered to the listener in the next alarm.
+ */
+static int
+deliver_to(string channel, mixed *messages, object ob)
+{
+    string func;
+    int    *counters = channel_stats(channel);
+    int    failed, done, calls;
+
+    if (!ob)
+    {
+	drop_dead(channel);
+	return sizeof(messages);
+    }
+
+    /* The listener stopped listening after the message was sent. */
+    if (!channels[channel] || !(func = channels[channel][ob]))
+	return sizeof(messages);
+
+    if (batched[channel] && batched[channel][ob])
+    {
+	failed = (catch(call_other(ob, func, messages)) ? 1 : 0);
+	calls = 1;
+	done = sizeof(messages);
+    }
+    else
+    {
+	foreach(mixed message: messages)
+	{
+	    if (delivery_calls + calls >= MAX_CALLS)
+		break;
+
+	    if (catch(call_other(ob, func, message)))
+		failed = 1;
+	    calls++;
+	    done++;
+	    if (!ob)
+	    {
+		done = sizeof(messages);
+		break;
+	    }
+	}
+    }
+
+    delivery_calls += calls;
+    counters[STAT_CALLS] += calls;
+    counters[STAT_DELIVERED] += done;
+
+    if (!failed)
+    {
+	m_delkey(failures, ob);
+	return done;
+    }
+
+    counters[STAT_FAILURES]++;
+    if (ob && (++failures[ob] >= MAX_FAILURES))
+    {
+	_stop_listen(channel, ob);
+	m_delkey(failures, ob);
+	counters[STAT_DROPPED]++;
+	return sizeof(messages);
+    }
+    return done;
+}
+
+/*
+ * Called from the alarm. Moves the queued messages of all channels into
+ * the deliveries and calls the listeners, until MAX_CALLS calls were made.
+ * The next alarm is set before any listener is called, so the deliveries
+ * that are left go out even when this one is aborted.
+ */
+static void
+deliver_signals()
+{
+    mixed  delivery;
+    object ob;
+    int    done;
+
+    foreach(string channel, mixed *messages: queues)
+    {
+	if (channels[channel] && m_sizeof(channels[channel]))
+	    deliveries += ({ ({ channel, messages,
+		m_indexes(channels[channel]) }) });
+    }
+    queues = ([]);
+
+    delivery_calls = 0;
+    delivery_alarm = set_alarm(DELIVERY_DELAY, 0.0, deliver_signals);
+
+    while (sizeof(deliveries))
+    {
+	delivery = deliveries[0];
+	while (sizeof(delivery[2]))
+	{
+	    if (delivery_calls >= MAX_CALLS)
+		return;
+
+	    /* Take the listener off first, so a listener that aborts the
+	     * alarm is not called again.
+	     */
+	    ob = delivery[2][0];
+	    delivery[2] = delivery[2][1..];
+
+	    done = deliver_to(delivery[0], delivery[1], ob);
+	    if (done < sizeof(delivery[1]))
+	    {
+		deliveries = ({ ({ delivery[0], delivery[1][done..],
+		    ({ ob }) }) }) + deliveries;
+		return;
+	    }
+	}
+	deliveries = deliveries[1..];
+    }
+
+    remove_alarm(delivery_alarm);
+    delivery_alarm = 0;
+}
+
+/*
+ * Puts a message in the outbound queue of a channel and makes sure the
+ * delivery alarm runs.
+ */
+static void
+queue_signal(string channel, mixed message)
+{
+    int *counters = channel_stats(channel);
+
+    if (queues[channel])
+	queues[channel] += ({ message });
+    else
+	queues[channel] = ({ message });
+
+    counters[STAT_SENT]++;
+    if (sizeof(queues[channel]) > counters[STAT_MAX_QUEUE])
+	counters[STAT_MAX_QUEUE] = sizeof(queues[channel]);
+
+    if (!delivery_alarm)
+	delivery_alarm = set_alarm(DELIVERY_DELAY, 0.0, deliver_signals);
+}
+
 int
 send_signal(string channel, mixed message)
 {
@@ -181,19 +416,17 @@ send_signal(string channel, mixed message)
 			     previous_object(), channel, 1))
 	    return 0;
   
+#ifdef USE_CALL_OUT
+    queue_signal(channel, message);
+#else
     n = m_sizeof(channels[channel]);
     obs = m_indexes(channels[channel]);
     for(i = 0; i < n; ++i) // send the message to all the listeners 
 	if (obs[i])
-	{
-#ifdef USE_CALL_OUT
-	    set_alarm(0.3, 0.0, &call_other(obs[i], channels[channel][obs[i]], message));
-#else
 	    call_other(obs[i], channels[channel][obs[i]], message);
-#endif
-	}
 	else // the object has been destructed (this should never happen)
-	    _stop_listen_all(obs[i]);
+	    drop_dead(channel);
+#endif
     return 1;
 }
 
@@ -269,3 +502,58 @@ query_channels(object ob)
 {
     return listeners[ob];
 }
+
+/*
+ * Returns the counters of a channel, see the header of this file.
+ */
+mapping
+query_channel_stats(string channel)
+{
+    int *counters = stats[channel];
+    int queued = sizeof(queues[channel]);
+    int age;
+
+    if (!counters)
+	return 0;
+
+    foreach(mixed delivery: deliveries)
+	if (delivery[0] == channel)
+	    queued += sizeof(delivery[1]);
+
+    age = time() - counters[STAT_SINCE];
+    return ([ "listeners" : m_sizeof(channels[channel]),
+	      "sent"      : counters[STAT_SENT],
+	      "delivered" : counters[STAT_DELIVERED],
+	      "calls"     : counters[STAT_CALLS],
+	      "queued"    : queued,
+	      "max_queue" : counters[STAT_MAX_QUEUE],
+	      "failures"  : counters[STAT_FAILURES],
+	      "dropped"   : counters[STAT_DROPPED],
+	      "per_minute": (age ? ((counters[STAT_SENT] * 60) / age) :
+			     counters[STAT_SENT]),
+	      "since"     : counters[STAT_SINCE] ]);
+}
+
+/*
+ * Shows the counters of all channels when a wizard stats the object.
+ */
+string
+stat_object()
+{
+    string str = sprintf("%-20s %5s %7s %7s %5s %5s %5s %5s %6s\n",
+	"Channel", "Lstn", "Sent", "Calls", "Queue", "Max", "Fail", "Drop",
+	"/min");
+    mapping data;
+
+    foreach(string channel: sort_array(m_indexes(stats)))
+    {
+	data = query_channel_stats(channel);
+	str += sprintf("%-20s %5d %7d %7d %5d %5d %5d %5d %6d\n", channel,
+	    data["listeners"], data["sent"], data["calls"], data["queued"],
+	    data["max_queue"], data["failures"], data["dropped"],
+	    data["per_minute"]);
+    }
+
+    return str + "Deliveries pending: " + sizeof(deliveries) +
+	(delivery_alarm ? ", alarm running.\n" : ".\n");
+}
@@ -0,0 +1,282 @@
+/*
+ * /sys/global/soul_index.c
+ *
+ * This object keeps the verb indices used by the command hooks of livings
+ * (/std/living/cmdhooks.c). Instead of asking every soul whether it knows a
+ * verb, a living looks up the verb in its index and only calls the souls
+ * that actually define it.
+ *
+ * An index is built from the query_cmdlist() of each soul and is shared
+ * between all livings that have the same wizard, tool and command souls.
+ * When a soul is loaded or calls update_commands(), all indices using that
+ * soul are marked stale and rebuilt shortly after. See <cmdparse.h> for the
+ * format of the index.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <cmdparse.h>
+#include <files.h>
+#include <macros.h>
+
+/*
+ * Global variables.
+ *
+ * indices  - ([ signature : ([ verb : ({ ({ soul, kind, pos }) }) ]) ])
+ * lists    - ([ signature : ({ *wiz souls, *tool souls, *command souls }) ])
+ * users    - ([ soul : ({ signatures using the soul }) ])
+ */
+private static mapping indices = ([ ]);
+private static mapping lists = ([ ]);
+private static mapping users = ([ ]);
+private static string  *dirty = ({ });
+private static int     rebuild_alarm;
+
+/*
+ * Statistics.
+ */
+private static int     stat_builds;
+private static int     stat_invalidations;
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+}
+
+/*
+ * Function name: fix_soul_name
+ * Description  : Make sure soul filenames have the same format as the
+ *                filenames returned by file_name().
+ * Arguments    : string soul - the filename of the soul.
+ * Returns      : string - the normalised filename.
+ */
+static string
+fix_soul_name(string soul)
+{
+    if (soul[0] != '/')
+    {
+        soul = "/" + soul;
+    }
+    if (soul[-2..] == ".c")
+    {
+        soul = soul[..-3];
+    }
+
+    return soul;
+}
+
+/*
+ * Function name: build_index
+ * Description  : (Re)builds the index of a signature. The mapping is
+ *                changed in place so all livings sharing it see the
+ *                update. If a soul cannot be loaded, the index remains
+ *                marked as stale so livings keep searching the old way.
+ * Arguments    : string signature - the signature of the soul lists.
+ */
+static void
+build_index(string signature)
+{
+    mapping index = indices[signature];
+    mixed   souls = lists[signature];
+    mapping cmdlist;
+    object  ob;
+    int     pos, complete = 1;
+
+    index[SOUL_INDEX_STALE] = 1;
+    foreach(string verb: m_indexes(index) - ({ SOUL_INDEX_STALE }))
+    {
+        m_delkey(index, verb);
+    }
+
+    for (int kind = SOUL_KIND_WIZ; kind <= SOUL_KIND_CMD; kind++)
+    {
+        foreach(string soul: souls[kind])
+        {
+            pos++;
+            if (!objectp(ob = find_object(soul)))
+            {
+                catch(soul->teleledningsanka());
+                if (!objectp(ob = find_object(soul)))
+                {
+                    complete = 0;
+                    continue;
+                }
+            }
+
+            if (!mappingp(cmdlist = ob->query_cmdlist()))
+            {
+                continue;
+            }
+
+            foreach(string verb, mixed func: cmdlist)
+            {
+                if (!stringp(func) || (verb == SOUL_INDEX_STALE))
+                {
+                    continue;
+                }
+
+                if (pointerp(index[verb]))
+                {
+                    index[verb] += ({ ({ soul, kind, pos }) });
+                }
+                else
+                {
+                    index[verb] = ({ ({ soul, kind, pos }) });
+                }
+            }
+        }
+    }
+
+    if (complete)
+    {
+        m_delkey(index, SOUL_INDEX_STALE);
+    }
+    stat_builds++;
+}
+
+/*
+ * Function name: query_verb_index
+ * Description  : Called from the command hooks of a living to get the verb
+ *                index for its souls. Only /std/living may call this, as the
+ *                index is shared and must not be tampered with.
+ * Arguments    : string *wiz_souls - the wizard souls.
+ *                string *tool_souls - the tool souls.
+ *                string *soul_souls - the command souls.
+ * Returns      : mapping - the verb index, see <cmdparse.h>.
+ */
+public mapping
+query_verb_index(string *wiz_souls, string *tool_souls, string *soul_souls)
+{
+    string signature;
+    mixed  souls;
+
+    if (calling_program() != "std/living.c")
+    {
+        return 0;
+    }
+
+    souls = ({ map(wiz_souls || ({ }), fix_soul_name),
+               map(tool_souls || ({ }), fix_soul_name),
+               map(soul_souls || ({ }), fix_soul_name) });
+    signature = implode(souls[SOUL_KIND_WIZ], ",") + "|" +
+        implode(souls[SOUL_KIND_TOOL], ",") + "|" +
+        implode(souls[SOUL_KIND_CMD], ",");
+
+    if (mappingp(indices[signature]))
+    {
+        if (indices[signature][SOUL_INDEX_STALE])
+        {
+            build_index(signature);
+        }
+        return indices[signature];
+    }
+
+    indices[signature] = ([ ]);
+    lists[signature] = souls;
+    foreach(string soul: souls[SOUL_KIND_WIZ] + souls[SOUL_KIND_TOOL] +
+        souls[SOUL_KIND_CMD])
+    {
+        if (pointerp(users[soul]))
+        {
+            users[soul] = (users[soul] - ({ signature })) + ({ signature });
+        }
+        else
+        {
+            users[soul] = ({ signature });
+        }
+    }
+
+    build_index(signature);
+    return indices[signature];
+}
+
+/*
+ * Function name: rebuild_dirty
+ * Description  : Rebuilds all indices that were marked as stale.
+ */
+static void
+rebuild_dirty()
+{
+    string *todo = dirty;
+
+    dirty = ({ });
+    rebuild_alarm = 0;
+
+    foreach(string signature: todo)
+    {
+        if (mappingp(indices[signature]))
+        {
+            build_index(signature);
+        }
+    }
+}
+
+/*
+ * Function name: invalidate_soul
+ * Description  : Called from /cmd/std/command_driver when a soul is loaded
+ *                or changes its commands. All indices using the soul are
+ *                marked stale at once and rebuilt from an alarm, since the
+ *                soul may still be loading.
+ * Arguments    : string soul - the filename of the soul.
+ */
+public void
+invalidate_soul(string soul)
+{
+    string *signatures = users[fix_soul_name(soul)];
+
+    if (!pointerp(signatures))
+    {
+        return;
+    }
+
+    stat_invalidations++;
+    foreach(string signature: signatures)
+    {
+        indices[signature][SOUL_INDEX_STALE] = 1;
+    }
+
+    dirty = (dirty - signatures) + signatures;
+    if (!rebuild_alarm)
+    {
+        rebuild_alarm = set_alarm(0.0, 0.0, rebuild_dirty);
+    }
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the state of the index, and the number of calls the
+ *                index saved for the players in the game.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    int commands, saved;
+    mixed stats;
+
+    foreach(object player: users())
+    {
+        if (pointerp(stats = player->query_cmd_index_stats()))
+        {
+            commands += stats[0];
+            saved += stats[1];
+        }
+    }
+
+    return sprintf("Indices     : %6d    Souls : %d\n", m_sizeof(indices),
+            m_sizeof(users)) +
+        sprintf("Builds      : %6d    Invalidations : %d\n", stat_builds,
+            stat_invalidations) +
+        sprintf("Commands    : %6d    Calls saved : %d (%.2f per command)\n",
+            commands, saved,
+            (commands ? (itof(saved) / itof(commands)) : 0.0));
+}
@@ -0,0 +1,557 @@
+/*
+ * /sys/global/telemetry.c
+ *
+ * This daemon keeps track of the use of memory and objects in the game, so
+ * that we can see trouble coming before Armageddon has to shut the game
+ * down because the memory is used up.
+ *
+ * Every SAMPLE_TIME seconds a sample is taken of the size of the heap, the
+ * number of objects and alarms and the number of interactive players. The
+ * last SERIES_SIZE samples are kept, from which we compute the trend of
+ * the heap and the time left until it reaches the memory limit. The master
+ * uses the samples in check_memory().
+ *
+ * In the background we run a census of the objects. The master tells us
+ * about every program that is loaded, and for every program we count its
+ * clones and their alarms, a few programs at a time. The counts of the last
+ * CENSUS_SIZE censuses are kept per program, so we can find the programs
+ * that grow the most, and the leak suspects: programs whose number of
+ * clones grew in every census. The counts are also added up per domain.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <files.h>
+#include <macros.h>
+#include <std.h>
+
+/* The time between two samples, and the number of samples we keep. */
+#define SAMPLE_TIME       (60.0)
+#define SERIES_SIZE       (120)
+
+/* The time between two steps of the census, and the number of objects we
+ * count in a step.
+ */
+#define CENSUS_TIME       (5.0)
+#define CENSUS_BUDGET     (2000)
+
+/* The number of censuses we keep per program. */
+#define CENSUS_SIZE       (8)
+
+/* A leak suspect grew in this many censuses in a row, by at least this
+ * many clones.
+ */
+#define SUSPECT_CENSUSES  (4)
+#define SUSPECT_GROWTH    (50)
+
+/* Indices into the samples. */
+#define SAMPLE_TIME_IDX   (0)
+#define SAMPLE_HEAP       (1)
+#define SAMPLE_OBJECTS    (2)
+#define SAMPLE_ALARMS     (3)
+#define SAMPLE_USERS      (4)
+
+/*
+ * Global variables.
+ *
+ * series   - the samples, a ring of SERIES_SIZE entries ({ time, heap,
+ *            objects, alarms, interactives }).
+ * programs - ([ program : ({ objects in the last censuses }) ]) the
+ *            programs we know of, the oldest count first. The objects of a
+ *            program are its master object and its clones.
+ * domains  - ([ domain : objects ]) the objects per domain in the last
+ *            census.
+ * todo     - the programs still to be counted in this census.
+ * counts   - ([ program : objects ]) the counts of this census so far.
+ */
+private static mixed   *series = allocate(SERIES_SIZE);
+private static int     series_next;
+private static int     series_count;
+private static mapping programs = ([ ]);
+private static mapping domains = ([ ]);
+private static string  *todo = ({ });
+private static mapping counts = ([ ]);
+private static mapping domain_counts = ([ ]);
+private static int     census_objects;
+private static int     census_alarms;
+private static int     last_objects;
+private static int     last_alarms;
+private static int     census_started;
+private static int     last_census;
+private static int     censuses;
+
+/*
+ * Prototypes.
+ */
+static void take_sample();
+static void census_step();
+
+/*
+ * Function name: seed_programs
+ * Description  : Finds the programs of the objects around the players, to
+ *                start with before the master tells us about new programs.
+ * Arguments    : object *obs - the objects to search.
+ */
+static void
+seed_programs(object *obs)
+{
+    foreach(object ob: obs)
+    {
+        if (!pointerp(programs[MASTER_OB(ob)]))
+        {
+            programs[MASTER_OB(ob)] = ({ });
+        }
+    }
+}
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    seed_programs(users());
+    foreach(object player: users())
+    {
+        if (objectp(environment(player)))
+        {
+            seed_programs(({ environment(player) }) +
+                deep_inventory(environment(player)));
+        }
+    }
+
+    set_alarm(1.0, SAMPLE_TIME, take_sample);
+    set_alarm(CENSUS_TIME, CENSUS_TIME, census_step);
+}
+
+/*
+ * Function name: loaded_program
+ * Description  : Called from the master when a program is loaded.
+ * Arguments    : object ob - the master object of the program.
+ */
+public void
+loaded_program(object ob)
+{
+    if ((previous_object() == find_object(SECURITY)) &&
+        !pointerp(programs[MASTER_OB(ob)]))
+    {
+        programs[MASTER_OB(ob)] = ({ });
+    }
+}
+
+/*
+ * Function name: parse_heap_size
+ * Description  : Finds the size of the heap in the output of the malloc
+ *                debug command.
+ * Returns      : int - the size in bytes.
+ */
+static int
+parse_heap_size()
+{
+    string data = SECURITY->do_debug("malloc");
+    string *rows;
+    int used;
+
+    if (!strlen(data))
+    {
+        return 0;
+    }
+
+    rows = explode(data, "\n");
+    if ((data[0] == '<') && (sizeof(rows) >= 5))
+    {
+        /* This might not be reliable across systems. We'll see */
+        sscanf(rows[-5], "<system type=\"current\" size=\"%d\"/>", used);
+    }
+    else if (sizeof(rows))
+    {
+        sscanf(rows[-1], "Total heap size: %d", used);
+    }
+
+    return used;
+}
+
+/*
+ * Function name: take_sample
+ * Description  : Adds a sample to the series.
+ */
+static void
+take_sample()
+{
+    series[series_next] = ({ time(), parse_heap_size(), last_objects,
+        last_alarms, sizeof(users()) });
+    series_next = (series_next + 1) % SERIES_SIZE;
+    series_count = min(series_count + 1, SERIES_SIZE);
+}
+
+/*
+ * Function name: query_series
+ * Description  : Returns the samples, the oldest first.
+ * Returns      : mixed * - the samples, ({ time, heap, objects, alarms,
+ *                    interactives }).
+ */
+public mixed *
+query_series()
+{
+    mixed *result = ({ });
+    int index;
+
+    for (index = series_count; index > 0; index--)
+    {
+        result += ({ series[(series_next - index + SERIES_SIZE) %
+            SERIES_SIZE] + ({ }) });
+    }
+
+    return result;
+}
+
+/*
+ * Function name: query_heap_size
+ * Description  : Returns the size of the heap of the last sample. The
+ *                master uses this for its memory checks.
+ * Returns      : int - the size in bytes.
+ */
+public int
+query_heap_size()
+{
+    mixed sample;
+
+    if (!series_count)
+    {
+        take_sample();
+    }
+
+    sample = series[(series_next - 1 + SERIES_SIZE) % SERIES_SIZE];
+    return sample[SAMPLE_HEAP];
+}
+
+/*
+ * Function name: query_trend
+ * Description  : Computes the trend of a value over the samples with the
+ *                least squares method.
+ * Arguments    : int what - the index in the samples, e.g. SAMPLE_HEAP.
+ * Returns      : float - the growth per minute.
+ */
+public float
+query_trend(int what)
+{
+    mixed *samples = query_series();
+    float sum_t = 0.0, sum_v = 0.0, sum_tt = 0.0, sum_tv = 0.0;
+    float t, v, n;
+
+    if (sizeof(samples) < 2)
+    {
+        return 0.0;
+    }
+
+    foreach(mixed sample: samples)
+    {
+        t = itof(sample[SAMPLE_TIME_IDX] - samples[0][SAMPLE_TIME_IDX]) / 60.0;
+        v = itof(sample[what]);
+        sum_t += t;
+        sum_v += v;
+        sum_tt += t * t;
+        sum_tv += t * v;
+    }
+
+    n = itof(sizeof(samples));
+    if ((n * sum_tt - sum_t * sum_t) == 0.0)
+    {
+        return 0.0;
+    }
+    return (n * sum_tv - sum_t * sum_v) / (n * sum_tt - sum_t * sum_t);
+}
+
+/*
+ * Function name: query_minutes_to
+ * Description  : Estimates when the heap reaches a size, from its trend.
+ * Arguments    : int limit - the size in bytes.
+ * Returns      : int - the minutes, or -1 if the heap does not grow.
+ */
+public int
+query_minutes_to(int limit)
+{
+    float trend = query_trend(SAMPLE_HEAP);
+    int heap = query_heap_size();
+
+    if (trend <= 0.0)
+    {
+        return -1;
+    }
+
+    return max(0, ftoi(itof(limit - heap) / trend));
+}
+
+/*
+ * Function name: finish_census
+ * Description  : Stores the counts of a census that is complete.
+ */
+static void
+finish_census()
+{
+    foreach(string program: m_indexes(programs))
+    {
+        /* Forget the programs that are no longer loaded. */
+        if (!objectp(find_object(program)))
+        {
+            m_delkey(programs, program);
+            continue;
+        }
+
+        /* Programs loaded during the census were not counted. */
+        if (counts[program])
+        {
+            programs[program] = (programs[program] +
+                ({ counts[program] }))[-CENSUS_SIZE..];
+        }
+    }
+
+    domains = domain_counts;
+    last_objects = census_objects;
+    last_alarms = census_alarms;
+    last_census = time();
+    censuses++;
+}
+
+/*
+ * Function name: census_step
+ * Description  : Counts the clones and alarms of the next programs in the
+ *                census, and starts a new census when the last one is done.
+ */
+static void
+census_step()
+{
+    object master;
+    object *clones;
+    string domain;
+    int    budget = CENSUS_BUDGET;
+    int    alarms;
+
+    if (!sizeof(todo))
+    {
+        if (census_started)
+        {
+            finish_census();
+        }
+
+        todo = m_indexes(programs);
+        counts = ([ ]);
+        domain_counts = ([ ]);
+        census_objects = 0;
+        census_alarms = 0;
+        census_started = time();
+    }
+
+    while ((budget > 0) && sizeof(todo))
+    {
+        master = find_object(todo[0]);
+        if (objectp(master))
+        {
+            clones = object_clones(master);
+            alarms = sizeof(master->query_alarms());
+            foreach(object clone: clones)
+            {
+                alarms += sizeof(clone->query_alarms());
+            }
+
+            counts[todo[0]] = sizeof(clones) + 1;
+            census_objects += sizeof(clones) + 1;
+            census_alarms += alarms;
+            domain = SECURITY->creator_file(todo[0]);
+            domain_counts[domain] += sizeof(clones) + 1;
+            budget -= sizeof(clones) + 1;
+        }
+        todo = todo[1..];
+    }
+}
+
+/*
+ * Function name: sort_growth
+ * Description  : Sorts the programs with the largest growth first.
+ * Arguments    : mapping growth - ([ program : growth ]).
+ *                string a, b - the programs to compare.
+ * Returns      : int - -1, 0 or 1.
+ */
+static int
+sort_growth(mapping growth, string a, string b)
+{
+    int diff = growth[b] - growth[a];
+
+    return ((diff > 0) ? 1 : ((diff < 0) ? -1 : 0));
+}
+
+/*
+ * Function name: query_top_growers
+ * Description  : Finds the programs whose number of clones grew the most
+ *                over the censuses we keep.
+ * Arguments    : int num - the number of programs.
+ * Returns      : mixed * - ({ ({ program, oldest count, last count }) }),
+ *                    where the counts include the master object.
+ */
+public mixed *
+query_top_growers(int num)
+{
+    mapping growth = ([ ]);
+    string *list;
+    mixed  *result;
+
+    foreach(string program, int *history: programs)
+    {
+        if ((sizeof(history) >= 2) &&
+            (history[-1] > history[0]))
+        {
+            growth[program] = history[-1] - history[0];
+        }
+    }
+
+    list = sort_array(m_indexes(growth), &sort_growth(growth))[..(num - 1)];
+    result = ({ });
+    foreach(string program: list)
+    {
+        result += ({ ({ program, programs[program][0],
+            programs[program][-1] }) });
+    }
+
+    return result;
+}
+
+/*
+ * Function name: query_leak_suspects
+ * Description  : Finds the programs whose number of clones grew steadily,
+ *                that is, never dropped in the last SUSPECT_CENSUSES
+ *                censuses and grew by at least SUSPECT_GROWTH.
+ * Returns      : string * - the programs.
+ */
+public string *
+query_leak_suspects()
+{
+    string *suspects = ({ });
+    int *recent;
+    int index, steady;
+
+    foreach(string program, int *history: programs)
+    {
+        if (sizeof(history) < SUSPECT_CENSUSES)
+        {
+            continue;
+        }
+
+        recent = history[-SUSPECT_CENSUSES..];
+        steady = 1;
+        for (index = 1; index < sizeof(recent); index++)
+        {
+            if (recent[index] < recent[index - 1])
+            {
+                steady = 0;
+                break;
+            }
+        }
+
+        if (steady &&
+            ((recent[-1] - recent[0]) >= SUSPECT_GROWTH))
+        {
+            suspects += ({ program });
+        }
+    }
+
+    return suspects;
+}
+
+/*
+ * Function name: query_domains
+ * Description  : Returns the number of objects per domain in the last
+ *                census. Objects of wizards are counted by wizard.
+ * Returns      : mapping - ([ domain : objects ])
+ */
+public mapping
+query_domains()
+{
+    return domains + ([ ]);
+}
+
+/*
+ * Function name: query_clones
+ * Description  : Returns the number of objects of a program, the master
+ *                object and its clones, in the last censuses.
+ * Arguments    : string program - the program.
+ * Returns      : int * - the counts, the oldest first, or 0.
+ */
+public int *
+query_clones(string program)
+{
+    return (pointerp(programs[program]) ? (programs[program] + ({ })) : 0);
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Returns the latest figures.
+ * Returns      : mapping - the figures, indexed by name.
+ */
+public mapping
+query_stats()
+{
+    return ([
+        "heap"        : query_heap_size(),
+        "heap_trend"  : query_trend(SAMPLE_HEAP),
+        "objects"     : last_objects,
+        "alarms"      : last_alarms,
+        "users"       : sizeof(users()),
+        "programs"    : m_sizeof(programs),
+        "censuses"    : censuses,
+        "last_census" : last_census,
+        "samples"     : series_count,
+        ]);
+}
+
+/*
+ * Function name: stat_object
+ * Description  : Shows the figures, the trends, the top growers and the
+ *                leak suspects when a wizard stats the daemon.
+ * Returns      : string - the description.
+ */
+public string
+stat_object()
+{
+    mapping stats = query_stats();
+    int minutes = query_minutes_to(SECURITY->query_memory_limit());
+    string str;
+    mixed *growers;
+
+    str = sprintf("Heap      : %10d bytes   Trend : %+.0f bytes/minute\n",
+            stats["heap"], stats["heap_trend"]) +
+        sprintf("Limit in  : %s\n", ((minutes < 0) ? "not growing" :
+            (minutes + " minutes"))) +
+        sprintf("Objects   : %10d   Trend : %+.1f/minute\n", stats["objects"],
+            query_trend(SAMPLE_OBJECTS)) +
+        sprintf("Alarms    : %10d   Interactives : %d\n", stats["alarms"],
+            stats["users"]) +
+        sprintf("Programs  : %10d   Censuses : %d, last %s\n",
+            stats["programs"], stats["censuses"], (stats["last_census"] ?
+            ctime(stats["last_census"]) : "never"));
+
+    growers = query_top_growers(10);
+    if (sizeof(growers))
+    {
+        str += "\nTop growers:\n";
+        foreach(mixed grower: growers)
+        {
+            str += sprintf("%8d -> %8d  %s\n", grower[1], grower[2],
+                grower[0]);
+        }
+    }
+
+    if (sizeof(growers = query_leak_suspects()))
+    {
+        str += "\nLeak suspects:\n    " +
+            implode(sort_array(growers), "\n    ") + "\n";
+    }
+
+    return str;
+}
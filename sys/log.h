@@ -67,6 +67,14 @@
  */
 #define LOG_SHUTDOWN "SHUTDOWN"
 
+/*
+ * Define this flag if you want to log the evaluation cost of booting the
+ * game, once all preload files are loaded.
+ *
+ * Used in: /secure/master.c
+ */
+#define LOG_BOOT "BOOT"
+
 /*
  * Log of the saved recovery string when a player (auto)saves.
  *
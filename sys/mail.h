@@ -51,6 +51,20 @@
  *    "body"     : (string)  message_body
  * ])
  *
+ * Messages are stored in segments by /secure/mail_store, each segment
+ * holding the messages of MAIL_SEGMENT_TIME seconds. The bodies are
+ * appended to the data file and the other fields are kept in the index:
+ * data:  /data/messages/s{message-date / MAIL_SEGMENT_TIME}
+ * index: /data/messages/i{message-date / MAIL_SEGMENT_TIME}.o
+ *
+ * ([ "messages" : ([ message-date : ({ offset, length, message_to,
+ *                       message_cc, message_addressees }) ]),
+ *    "dead"     : (int) number of unused bytes in the data file
+ * ])
+ *
+ * Message-files in the old format above are still read and are moved into
+ * the segments when they are saved again or by "mailadmin convert".
+ *
  * Alias_names, message_to, message_cc and message_addressees are a
  * single string with the (player-)names, separated by commas.
  * The names in message_from, message_to and message_cc and
@@ -178,6 +192,22 @@
 #define FILE_NAME_MESSAGE(t, h) \
     (MSG_DIR + "d" + ((t) % (h)) + "/m" + (t))
 
+/*
+ * Definitions related to the segments of the mail store.
+ */
+#define MAIL_SEGMENT_TIME (604800) /* One week per segment              */
+#define MAIL_SEGMENT(t)   ((t) / MAIL_SEGMENT_TIME)
+#define FILE_NAME_SEGMENT_DATA(s)  (MSG_DIR + "s" + (s))
+#define FILE_NAME_SEGMENT_INDEX(s) (MSG_DIR + "i" + (s))
+#define SEGMENT_MESSAGES  "messages"
+#define SEGMENT_DEAD      "dead"
+
+#define SEG_OFFSET    0          /* Index for the offset of the body        */
+#define SEG_LENGTH    1          /* Index for the length of the body        */
+#define SEG_TO        2          /* Index for to in a segment entry         */
+#define SEG_CC        3          /* Index for cc in a segment entry         */
+#define SEG_ADDRESS   4          /* Index for addressees in a segment entry */
+
 /*
  * Definitions related to export of mail to the web portal.
  */
@@ -114,6 +114,21 @@
 #define BOB_W		2
 #define BOB_D		3
 
+/* The files of the indexed board store, relative to the board save path.
+ * The index is a save_map() file with the mapping:
+ * ([ BOARD_STORE_NOTES : ([ "b<time>" : ({ header, offset, length }) ]),
+ *    BOARD_STORE_DEAD  : number of unused bytes in the data file ])
+ */
+#define BOARD_STORE_DATA	"notes"
+#define BOARD_STORE_INDEX	"index"
+#define BOARD_STORE_NOTES	"notes"
+#define BOARD_STORE_DEAD	"dead"
+
+/* Indexes for the entries in the board store */
+#define BSN_HEADER	0
+#define BSN_OFFSET	1
+#define BSN_LENGTH	2
+
 /* Days To Seconds */
 #define DTS(days)	((days) * 86400)
 
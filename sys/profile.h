@@ -0,0 +1,43 @@
+/*
+ * profile.h
+ *
+ * Macros to measure parts of the code with the profiler. The profiler
+ * measures all functions of a program through the gamedriver, but with
+ * these macros you can also measure a part of a function, with its
+ * evaluation cost, and see how the parts nest. Measurements are
+ * only made while a wizard profiles the program, e.g. with the tracer
+ * command 'Profile'. See /sys/global/profiler.c.
+ *
+ * PROFILE_ENTER(name) - start measuring a section called name.
+ * PROFILE_LEAVE(name) - stop measuring the section. Every PROFILE_ENTER()
+ *                       must be matched by a PROFILE_LEAVE() with the same
+ *                       name, also when the function returns early.
+ * PROFILE(name)       - count a pass through this point, like the macro
+ *                       of the old /lib/profile.c.
+ */
+
+#ifndef PROFILE_DEF
+#define PROFILE_DEF
+
+#ifndef FILES_DEFINED
+#include "/sys/files.h"
+#endif  FILES_DEFINED
+
+#define PROFILE_ENTER(name) (PROFILER->profile_enter(name))
+#define PROFILE_LEAVE(name) (PROFILER->profile_leave(name))
+#define PROFILE(name)       (PROFILER->profile_hit(name))
+
+/* The orders in which the profiler can rank its report. */
+#define PROFILE_SORT_COST    "cost"
+#define PROFILE_SORT_CALLS   "calls"
+#define PROFILE_SORT_AVERAGE "average"
+
+/* Indices into the rows of the report. */
+#define PROFILE_PROGRAM   (0)
+#define PROFILE_FUNCTION  (1)
+#define PROFILE_CALLS     (2)
+#define PROFILE_COST      (3)
+#define PROFILE_SOURCE    (4)
+
+/* No definitions beyond this line. */
+#endif PROFILE_DEF